@@ -1,5 +1,7 @@
 #include "dx_blue.h"
 
+#include <algorithm>
+
 using Microsoft::WRL::ComPtr;
 
 DXBlue::DXBlue(uint32_t width, uint32_t height, HWND hwnd) : g_ScreenWidth(width), g_ScreenHeight(height), g_hWnd(hwnd){};
@@ -13,6 +15,7 @@ void DXBlue::Init()
 	CreateSwapChain();
 	CreateDescriptorHeaps();
 	CreateBuffers();
+	CreateScene();
 }
 
 void DXBlue::CreateDevice()
@@ -55,6 +58,36 @@ void DXBlue::CreateCommandObjects()
 
 	// command lists are created in the recording state. our main loop will set it up for recording again so close it now
 	g_pCommandList->Close();
+
+	// one allocator per slice and frame, a slice list is only ever recorded by one worker at a time
+	for (int i = 0; i < g_FrameCount; i++)
+	{
+		for (uint32_t slice = 0; slice < g_MaxRecordSlices; ++slice)
+			ThrowIfFailed(g_pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&g_pSliceAllocator[i][slice])));
+	}
+	for (uint32_t slice = 0; slice < g_MaxRecordSlices; ++slice)
+	{
+		ThrowIfFailed(g_pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_pSliceAllocator[0][slice].Get(), nullptr, IID_PPV_ARGS(&g_pSliceCommandList[slice])));
+		g_pSliceCommandList[slice]->Close();
+	}
+	// the end list shares the frame allocator, it is recorded after g_pCommandList was closed
+	ThrowIfFailed(g_pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_pCommandAllocator[0].Get(), nullptr, IID_PPV_ARGS(&g_pEndCommandList)));
+	g_pEndCommandList->Close();
+	// the main thread records a slice too
+	g_pRecordPool.reset(new SoftThreadPool(g_MaxRecordSlices - 1));
+	g_pBackgroundPool.reset(new SoftThreadPool(1));
+	g_hWakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (g_hWakeEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+	// Control CPU and GPU sync
+	// one timeline fence for the queue, frame n signals n + 1
+	g_Fence.Init(g_pDevice.Get());
+	g_FrameScheduler.Init(&g_Fence, g_FrameCount);
+	g_UploadRing.Init(g_pDevice.Get(), &g_Fence, g_UploadRingSize);
+	g_FrameArenas.Init(g_FrameCount);
+	g_GraphResources.g_pPool = &g_TargetPool;
+	g_frameSlot = 0;
 }
 
 void DXBlue::CreateSwapChain()
@@ -87,51 +120,37 @@ void DXBlue::CreateSwapChain()
 
 void DXBlue::CreateDescriptorHeaps()
 {
-	// Control CPU and GPU sync
-	// Create the fences
-	for (int i = 0; i < g_FrameCount; i++)
-	{
-		ThrowIfFailed(g_pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_pFence[i])));
-		g_pFenceValue[i] = 0; // set the initial fence value to 0
-	}
-	// create a handle to a fence event
-	g_pFenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-
-	// Describe and create a render target view (RTV) descriptor heap.
-	D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-	rtvHeapDesc.NumDescriptors = g_FrameCount; 
-	rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-	// This heap will not be directly referenced by the shaders (not shader visible), as this will store the output from the pipeline
-	// otherwise we would set the heap's flag to D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
-	rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	rtvHeapDesc.NodeMask = 0;
-	ThrowIfFailed(g_pDevice->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&g_pRtvHeap)));
-	// get the size of a descriptor in this heap (this is a rtv heap, so only rtv descriptors should be stored in it.
-	// descriptor sizes may vary from device to device, which is why there is no set size and we must ask the 
-	// device to give us the size. we will use this size to increment a descriptor handle offset
-	g_rtvDescriptorSize = g_pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-
-	// Describe and create a  depth - stencil View descriptor heap.
-	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc;
-	dsvHeapDesc.NumDescriptors = 1;
-	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-	dsvHeapDesc.NodeMask = 0;
-	ThrowIfFailed(g_pDevice->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&g_pDsvHeap)));
-
+	// render target and depth stencil heaps are not shader visible, they store the output of the pipeline.
+	// Their views are tied to resources, so they only have a persistent part
+	g_RtvHeap.Init(g_pDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, g_RtvPersistentCount, 0, g_FrameCount, false);
+	g_DsvHeap.Init(g_pDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, g_DsvPersistentCount, 0, g_FrameCount, false);
 	// The descriptor heap for the combination of constant-buffer, shader-resource, and unordered-access views.
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.NumDescriptors = 1;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(g_pDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&g_pSrvHeap)));
+	g_SrvHeap.Init(g_pDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, g_SrvPersistentCount, g_SrvPerFrameCount, g_FrameCount, true);
+
+	// the views are written again on every resize, the handles stay
+	for (uint32_t i = 0; i < g_FrameCount; ++i)
+		g_BackBufferRtv[i] = g_RtvHeap.AllocatePersistent();
+	g_DepthStencilDsv = g_DsvHeap.AllocatePersistent();
 }
 
 void DXBlue::CreateBuffers()
 {
-	// Release buffers
+	CreateSwapChainBuffers();
+
+	// Create DSV
+	// a pooled depth buffer of the same size is reused
+	g_DepthStencilKey = { g_ScreenWidth, g_ScreenHeight, static_cast<uint32_t>(DXGI_FORMAT_R24G8_TYPELESS) };
+	if (g_DepthStencilBuffer)
+		g_TargetPool.Release(g_DepthStencilKey, std::move(g_DepthStencilBuffer));
+	if (!g_TargetPool.Acquire(g_DepthStencilKey, g_DepthStencilBuffer))
+		g_DepthStencilBuffer = CreateDepthStencilBuffer(g_ScreenWidth, g_ScreenHeight);
+	CreateDepthStencilView();
+}
+
+void DXBlue::CreateSwapChainBuffers()
+{
+	// Release buffers, the swap chain owns them
 	for (int i = 0; i < g_FrameCount; ++i) g_SwapChainBuffer[i].Reset();
-	g_DepthStencilBuffer.Reset();
 
 	// Reallocate buffer according to window size
 	ThrowIfFailed(g_pSwapChain->ResizeBuffers(g_FrameCount,g_ScreenWidth, g_ScreenHeight, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
@@ -139,24 +158,25 @@ void DXBlue::CreateBuffers()
 	g_currentBackBuffer = 0;
 
 	// Create RTV
-	// get a handle to the first descriptor in the descriptor heap.
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle(g_pRtvHeap->GetCPUDescriptorHandleForHeapStart());
 	// Create a RTV for each buffer.
 	for (int i = 0; i < g_FrameCount; ++i) 
 	{
 		ThrowIfFailed(g_pSwapChain->GetBuffer(i, IID_PPV_ARGS(&g_SwapChainBuffer[i])));
 		// we "create" a render target view which binds the swap chain buffer (Render targets) (ID3D12Resource[n]) to the rtv handle
-		g_pDevice->CreateRenderTargetView(g_SwapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
-		// Next desc
-		rtvHeapHandle.Offset(1, g_rtvDescriptorSize);
+		g_pDevice->CreateRenderTargetView(g_SwapChainBuffer[i].Get(), nullptr, g_BackBufferRtv[i].cpu);
 	}
 
-	// Create DSV
+	g_ScreenViewport = { 0.0f, 0.0f, static_cast<float>(g_ScreenWidth), static_cast<float>(g_ScreenHeight), 0.0f, 1.0f };
+	g_ScissorRect = { 0, 0, static_cast<LONG>(g_ScreenWidth), static_cast<LONG>(g_ScreenHeight) };
+}
+
+ComPtr<ID3D12Resource> DXBlue::CreateDepthStencilBuffer(uint32_t width, uint32_t height)
+{
 	D3D12_RESOURCE_DESC depthStencilDesc;
 	depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	depthStencilDesc.Alignment = 0;
-	depthStencilDesc.Width = g_ScreenWidth;
-	depthStencilDesc.Height = g_ScreenHeight;
+	depthStencilDesc.Width = width;
+	depthStencilDesc.Height = height;
 	depthStencilDesc.DepthOrArraySize = 1;
 	depthStencilDesc.MipLevels = 1;
 	depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
@@ -170,39 +190,138 @@ void DXBlue::CreateBuffers()
 	optClear.DepthStencil.Depth = 1.0f;
 	optClear.DepthStencil.Stencil = 0;
 	CD3DX12_HEAP_PROPERTIES tempHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	// created straight in depth write, so no transition has to be recorded for it
+	ComPtr<ID3D12Resource> depthStencilBuffer;
 	ThrowIfFailed(g_pDevice->CreateCommittedResource(
 		&tempHeapProperties,
 		D3D12_HEAP_FLAG_NONE,
 		&depthStencilDesc,
-		D3D12_RESOURCE_STATE_COMMON,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
 		&optClear,
-		IID_PPV_ARGS(&g_DepthStencilBuffer)));
+		IID_PPV_ARGS(&depthStencilBuffer)));
+	return depthStencilBuffer;
+}
 
+void DXBlue::CreateDepthStencilView()
+{
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
 	dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
 	dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
 	dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	dsvDesc.Texture2D.MipSlice = 0;
-	g_pDevice->CreateDepthStencilView(g_DepthStencilBuffer.Get(), &dsvDesc, g_pDsvHeap->GetCPUDescriptorHandleForHeapStart());
-
-	// Transition to depth write
-	CD3DX12_RESOURCE_BARRIER tempResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
-		g_DepthStencilBuffer.Get(),
-		D3D12_RESOURCE_STATE_COMMON,
-		D3D12_RESOURCE_STATE_DEPTH_WRITE);
-	g_pCommandList->ResourceBarrier(
-		1,
-		&tempResourceBarrier);
+	g_pDevice->CreateDepthStencilView(g_DepthStencilBuffer.Get(), &dsvDesc, g_DepthStencilDsv.cpu);
 }
 
-void DXBlue::UpdatePipeline()
+void DXBlue::CreateScene()
+{
+	g_Scene.Init(g_ScenePipelines);
+	g_SceneRenderer.Init(g_pDevice.Get(), g_Scene, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_D24_UNORM_S8_UINT);
+	g_StartTime = std::chrono::steady_clock::now();
+	g_PendingSceneUploads = true;
+
+	// slices record contiguous ranges of the frame's draw items, the order of the items is kept by the submission
+	g_RecordSlice = [this](ID3D12GraphicsCommandList* commandList, uint32_t slice, uint32_t sliceCount)
+	{
+		size_t begin = g_DrawItems.size() * slice / sliceCount;
+		size_t end = g_DrawItems.size() * (slice + 1) / sliceCount;
+		g_SceneRenderer.RecordDrawItems(commandList, g_DrawItems.data() + begin, end - begin);
+	};
+}
+
+void DXBlue::RequestResize(uint32_t width, uint32_t height)
 {
-	// We have to wait for the gpu to finish with the command allocator before we reset it
-	WaitForPreviousFrame();
+	// minimized windows report 0x0, keep the targets we have
+	if (width == 0 || height == 0)
+		return;
+	g_ResizeDebouncer.Request(width, height);
+}
 
-	// we can only reset an allocator once the gpu is done with it
+void DXBlue::ApplyPendingResize()
+{
+	uint32_t width = 0, height = 0;
+	if (!g_ResizeInFlight && g_ResizeDebouncer.Poll(width, height))
+	{
+		if (width == g_ScreenWidth && height == g_ScreenHeight)
+			return;
+
+		g_ResizeInFlight = true;
+		g_PendingWidth = width;
+		g_PendingHeight = height;
+		g_ResizeReady = g_TargetPool.Acquire({ width, height, static_cast<uint32_t>(DXGI_FORMAT_R24G8_TYPELESS) }, g_PendingDepthStencilBuffer);
+		if (!g_ResizeReady)
+		{
+			// resource creation is free threaded, the frames keep rendering at the old size meanwhile
+			g_pBackgroundPool->Submit([this, width, height]
+			{
+				try
+				{
+					g_PendingDepthStencilBuffer = CreateDepthStencilBuffer(width, height);
+				}
+				catch (...)
+				{
+					g_ResizeError = std::current_exception();
+				}
+				g_ResizeReady.store(true, std::memory_order_release);
+				SetEvent(g_hWakeEvent);
+			});
+		}
+	}
+
+	if (!g_ResizeInFlight || !g_ResizeReady.load(std::memory_order_acquire))
+		return;
+	g_ResizeInFlight = false;
+	if (g_ResizeError)
+	{
+		std::exception_ptr error = g_ResizeError;
+		g_ResizeError = nullptr;
+		std::rethrow_exception(error);
+	}
+
+	// ResizeBuffers needs every reference to the back buffers released, this is the only wait of a resize
+	WaitForGpuIdle();
+	g_ScreenWidth = g_PendingWidth;
+	g_ScreenHeight = g_PendingHeight;
+	CreateSwapChainBuffers();
+
+	g_TargetPool.Release(g_DepthStencilKey, std::move(g_DepthStencilBuffer));
+	g_DepthStencilBuffer = std::move(g_PendingDepthStencilBuffer);
+	g_DepthStencilKey = { g_ScreenWidth, g_ScreenHeight, static_cast<uint32_t>(DXGI_FORMAT_R24G8_TYPELESS) };
+	CreateDepthStencilView();
+}
+
+uint32_t DXBlue::BeginFrame()
+{
+	// the cpu only blocks here when it is g_FrameCount frames ahead of the gpu
+	g_frameSlot = g_FrameScheduler.BeginFrame();
+	// the back buffer comes from the swap chain and is not tied to the frame slot
+	g_pFrameIndex = g_pSwapChain->GetCurrentBackBufferIndex();
+	g_UploadRing.BeginFrame();
+	g_SrvHeap.BeginFrame(g_frameSlot, g_Fence.GetCompletedValue());
+	g_FrameArenas.BeginFrame(g_frameSlot, g_Fence.GetCompletedValue());
+	return g_frameSlot;
+}
+
+void DXBlue::EndFrame()
+{
+	// this command goes in at the end of our command queue. once the gpu reaches it the fence takes the frame's value
+	uint64_t fenceValue = g_FrameScheduler.EndFrame();
+	g_Fence.Signal(g_pCommandQueue.Get(), fenceValue);
+	g_UploadRing.EndFrame(fenceValue);
+	g_SrvHeap.EndFrame(fenceValue);
+	g_FrameArenas.EndFrame(fenceValue);
+	g_TargetPool.EndFrame();
+}
+
+void DXBlue::WaitForGpuIdle()
+{
+	g_FrameScheduler.WaitIdle();
+}
+
+void DXBlue::UpdatePipeline()
+{
+	// we can only reset an allocator once the gpu is done with it, BeginFrame made sure of that
 	// resetting an allocator frees the memory that the command list was stored in
-	ThrowIfFailed(g_pCommandAllocator[g_pFrameIndex]->Reset());
+	ThrowIfFailed(g_pCommandAllocator[g_frameSlot]->Reset());
 
 	// reset the command list. by resetting the command list we are putting it into
 	// a recording state so we can start recording commands into the command allocator.
@@ -214,119 +333,165 @@ void DXBlue::UpdatePipeline()
 	// but in this tutorial we are only clearing the rtv, and do not actually need
 	// anything but an initial default pipeline, which is what we get by setting
 	// the second parameter to NULL
-	ThrowIfFailed(g_pCommandList->Reset(g_pCommandAllocator[g_pFrameIndex].Get(), nullptr));
+	ThrowIfFailed(g_pCommandList->Reset(g_pCommandAllocator[g_frameSlot].Get(), nullptr));
 
-	// here we start recording commands into the commandList (which all the commands will be stored in the commandAllocator)
-	// transition the "frameIndex" render target from the present state to the render target state so the command list draws to it starting from here
-	CD3DX12_RESOURCE_BARRIER tempResourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(g_SwapChainBuffer[g_pFrameIndex].Get(), 
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-	g_pCommandList->ResourceBarrier(1, &tempResourceBarrier);
+	g_submitCount = 0;
+	g_pSubmitLists[g_submitCount++] = g_pCommandList.Get();
+	g_pCurrentList = g_pCommandList.Get();
+
+	// the graph transitions the back buffer from present to render target before the first pass
+	// and back to present after the last one. If the debug layer is enabled, you will receive a
+	// warning if present is called on the render target when it's not in the present state
+	g_Graph.Reset(&g_FrameArenas.Current());
+	RenderGraphResource backBuffer = g_Graph.Import("back buffer", SoftResourceState::Present, SoftResourceState::Present);
+	g_GraphResources.Bind(backBuffer, g_SwapChainBuffer[g_pFrameIndex].Get());
+	// the depth buffer is created in depth write and never leaves it
+	RenderGraphResource depth = g_Graph.Import("depth", SoftResourceState::DepthWrite, SoftResourceState::DepthWrite);
+	g_GraphResources.Bind(depth, g_DepthStencilBuffer.Get());
 
 	// here we again get the handle to our current render target view so we can set it as the render target in the output merger stage of the pipeline
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(g_pRtvHeap->GetCPUDescriptorHandleForHeapStart(), g_pFrameIndex, g_rtvDescriptorSize);
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_BackBufferRtv[g_pFrameIndex].cpu;
+	D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = g_DepthStencilDsv.cpu;
 
-	// set the render target for the output merger stage (the output of the pipeline)
-	g_pCommandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+	uint32_t clearPass = g_Graph.AddPass("clear", [this, rtvHandle, dsvHandle]
+	{
+		// set the render target for the output merger stage (the output of the pipeline)
+		g_pCommandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+
+		// Clear the render target by using the ClearRenderTargetView command
+		const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+		g_pCommandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+		g_pCommandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+	});
+	g_Graph.Write(clearPass, backBuffer, SoftResourceState::RenderTarget);
+	g_Graph.Write(clearPass, depth, SoftResourceState::DepthWrite);
+
+	// the scene texture is copied in once, before the first frame samples it
+	if (g_PendingSceneUploads)
+	{
+		uint32_t uploadPass = g_Graph.AddPass("uploads", [this]
+		{
+			g_SceneRenderer.RecordUploads(g_pCommandList.Get(), g_UploadRing, g_Scene);
+		});
+		g_Graph.KeepAlive(uploadPass);
+		g_PendingSceneUploads = false;
+	}
 
-	// Clear the render target by using the ClearRenderTargetView command
-	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-	g_pCommandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+	// the draw items live in the frame arena, the slices read them while the workers record
+	float aspect = g_ScreenHeight ? static_cast<float>(g_ScreenWidth) / static_cast<float>(g_ScreenHeight) : 1.0f;
+	float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - g_StartTime).count();
+	g_DrawItems = ArenaVector<SoftDrawItem>(ArenaAllocator<SoftDrawItem>(&g_FrameArenas.Current()));
+	g_Scene.BuildDrawItems(g_SceneId, g_Camera.ViewProj(aspect), time, g_DrawItems);
+	g_SceneRenderer.Prepare(g_pDevice.Get(), g_UploadRing, g_SrvHeap, g_Scene, g_DrawItems.data(), g_DrawItems.size());
+	g_RecordSliceCount = 0;
+	if (!g_DrawItems.empty())
+		g_RecordSliceCount = (std::max)(1u, (std::min)(static_cast<uint32_t>(g_DrawItems.size() / g_MinDrawsPerSlice), g_MaxRecordSlices));
+
+	if (g_RecordSlice && g_RecordSliceCount > 0)
+	{
+		uint32_t scenePass = g_Graph.AddPass("scene", [this, rtvHandle, dsvHandle]
+		{
+			ThrowIfFailed(g_pCommandList->Close());
+			RecordSlices(rtvHandle, dsvHandle);
+
+			// the transition back to present goes into the end list, after the slices
+			ThrowIfFailed(g_pEndCommandList->Reset(g_pCommandAllocator[g_frameSlot].Get(), nullptr));
+			g_pCurrentList = g_pEndCommandList.Get();
+		});
+		g_Graph.Write(scenePass, backBuffer, SoftResourceState::RenderTarget);
+		g_Graph.Write(scenePass, depth, SoftResourceState::DepthWrite);
+	}
 
-	// transition the "frameIndex" render target from the render target state to the present state. If the debug layer is enabled, you will receive a
-	// warning if present is called on the render target when it's not in the present state
-	CD3DX12_RESOURCE_BARRIER tempResourceBarrier_2 = CD3DX12_RESOURCE_BARRIER::Transition(g_SwapChainBuffer[g_pFrameIndex].Get(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-	g_pCommandList->ResourceBarrier(1, &tempResourceBarrier_2);
+	g_Graph.Compile();
+	g_GraphResources.Realize(g_pDevice.Get(), g_Graph);
+	g_Graph.Execute([this](const RenderGraphBarrier* barriers, size_t count)
+	{
+		g_GraphResources.RecordBarriers(g_pCurrentList, barriers, count);
+	});
 
-	ThrowIfFailed(g_pCommandList->Close());
+	ThrowIfFailed(g_pCurrentList->Close());
+	if (g_pCurrentList == g_pEndCommandList.Get())
+		g_pSubmitLists[g_submitCount++] = g_pEndCommandList.Get();
+}
+
+void DXBlue::RecordSlices(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle)
+{
+	uint32_t sliceCount = (std::min)(g_RecordSliceCount, g_MaxRecordSlices);
+	// command list state does not carry over between lists, every slice binds the targets again
+	g_pRecordPool->ParallelFor(sliceCount, [this, rtvHandle, dsvHandle, sliceCount](uint32_t slice)
+	{
+		ID3D12GraphicsCommandList* list = g_pSliceCommandList[slice].Get();
+		ThrowIfFailed(g_pSliceAllocator[g_frameSlot][slice]->Reset());
+		ThrowIfFailed(list->Reset(g_pSliceAllocator[g_frameSlot][slice].Get(), nullptr));
+		list->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+		list->RSSetViewports(1, &g_ScreenViewport);
+		list->RSSetScissorRects(1, &g_ScissorRect);
+		g_RecordSlice(list, slice, sliceCount);
+		ThrowIfFailed(list->Close());
+	});
+
+	// submission follows the slice order, not the order the workers finished in
+	for (uint32_t slice = 0; slice < sliceCount; ++slice)
+		g_pSubmitLists[g_submitCount++] = g_pSliceCommandList[slice].Get();
 }
 
 void DXBlue::Render()
 {
+	ApplyPendingResize();
+	BeginFrame();
 	UpdatePipeline(); // update the pipeline by sending commands to the commandqueue
 
-	// create an array of command lists (only one command list here)
-	ID3D12CommandList* ppCommandLists[] = { g_pCommandList.Get() };
-
-	// execute the array of command lists
-	g_pCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	// execute the command lists UpdatePipeline recorded, in their recording order
+	g_pCommandQueue->ExecuteCommandLists(g_submitCount, g_pSubmitLists);
 
-	// this command goes in at the end of our command queue. we will know when our command queue 
-	// has finished because the fence value will be set to "fenceValue" from the GPU since the command
-	// queue is being executed on the GPU
-	ThrowIfFailed(g_pCommandQueue->Signal(g_pFence[g_pFrameIndex].Get(), g_pFenceValue[g_pFrameIndex]));
+	EndFrame();
 	// present the current backbuffer
-	ThrowIfFailed(g_pSwapChain->Present(1, 0));
+	Present();
+}
 
+void DXBlue::Present()
+{
+	UINT syncInterval = g_PresentMode == SoftPresentMode::Fifo ? 1 : 0;
+	ThrowIfFailed(g_pSwapChain->Present(syncInterval, 0));
 }
 
 void DXBlue::Cleanup()
 {
-	// wait for the gpu to finish all frames
-	for (int i = 0; i < g_FrameCount; ++i)
+	// a depth buffer may still be created in the background
+	g_pBackgroundPool.reset();
+	if (g_hWakeEvent)
 	{
-		g_pFrameIndex = i;
-		WaitForPreviousFrame();
+		CloseHandle(g_hWakeEvent);
+		g_hWakeEvent = nullptr;
 	}
+	// wait for the gpu to finish all frames
+	WaitForGpuIdle();
+	g_UploadRing.Release();
+	g_Fence.Release();
+	g_GraphResources.Release();
+	g_Graph.Reset();
+	g_RecordSlice = nullptr;
+	g_DrawItems = ArenaVector<SoftDrawItem>();
+	g_SceneRenderer.Release();
+	g_TargetPool.Clear();
 
 	SAFE_RELEASE(g_pDevice);
 	SAFE_RELEASE(g_pSwapChain);
 	SAFE_RELEASE(g_pCommandQueue);
-	SAFE_RELEASE(g_pRtvHeap);
-	SAFE_RELEASE(g_pDsvHeap);
-	SAFE_RELEASE(g_pSrvHeap);
+	g_RtvHeap.Release();
+	g_DsvHeap.Release();
+	g_SrvHeap.Release();
 	SAFE_RELEASE(g_pCommandList);
+	g_pEndCommandList.Reset();
+	g_pRecordPool.reset();
 
 	for (int i = 0; i < g_FrameCount; ++i)
 	{
 		SAFE_RELEASE(g_SwapChainBuffer[i]);
 		SAFE_RELEASE(g_pCommandAllocator[i]);
-		SAFE_RELEASE(g_pFence[i]);
+		for (uint32_t slice = 0; slice < g_MaxRecordSlices; ++slice)
+			g_pSliceAllocator[i][slice].Reset();
 	};
+	for (uint32_t slice = 0; slice < g_MaxRecordSlices; ++slice)
+		g_pSliceCommandList[slice].Reset();
 }
-
-void DXBlue::WaitForPreviousFrame()
-{
-	// if the current fence value is still less than "g_pFenceValue", then we know the GPU has not finished executing
-	// the command queue since it has not reached the "commandQueue->Signal(fence, fenceValue)" command
-	if (g_pFence[g_pFrameIndex]->GetCompletedValue() < g_pFenceValue[g_pFrameIndex])
-	{
-		// we have the fence create an event which is signaled once the fence's current value is "g_pFenceValue"
-		ThrowIfFailed(g_pFence[g_pFrameIndex]->SetEventOnCompletion(g_pFenceValue[g_pFrameIndex], g_pFenceEvent));
-
-		// We will wait until the fence has triggered the event that it's current value has reached "fenceValue". once it's value
-		// has reached "fenceValue", we know the command queue has finished executing
-		WaitForSingleObject(g_pFenceEvent, INFINITE);
-	}
-
-	// increment fenceValue for next frame
-	g_pFenceValue[g_pFrameIndex]++;
-
-	// swap the current rtv buffer index so we draw on the correct buffer
-	g_pFrameIndex = g_pSwapChain->GetCurrentBackBufferIndex();
-}
-
-uint32_t DXBlue::WaitForNextFrameResources()
-{
-	uint32_t nextFrameIndex = g_pFrameIndex + 1;
-	g_pFrameIndex = nextFrameIndex;
-
-	HANDLE waitableObjects[] = { g_pSwapChainWaitableObject, nullptr };
-	DWORD numWaitableObjects = 1;
-	uint32_t index = nextFrameIndex % g_FrameCount;
-
-	ID3D12CommandAllocator* tempCommandAllocator = g_pCommandAllocator[index].Get();
-	uint64_t fenceValue = g_pFenceValue[index];
-
-	if (fenceValue != 0) // means no fence was signaled
-	{
-		g_pFenceValue[index] = 0;
-		g_pFence[index]->SetEventOnCompletion(fenceValue, g_pFenceEvent);
-		waitableObjects[1] = g_pFenceEvent;
-		numWaitableObjects = 2;
-	}
-
-	WaitForMultipleObjects(numWaitableObjects, waitableObjects, TRUE, INFINITE);
-
-	return nextFrameIndex;
-}
\ No newline at end of file
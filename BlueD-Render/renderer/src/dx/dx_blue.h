@@ -1,12 +1,26 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <d3d12.h>
 #include <dxgi1_6.h>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <wrl/client.h>
 #include <windows.h> 
 
 #include "d3dx12.h"
+#include "dx_descriptors.h"
+#include "dx_fence.h"
+#include "dx_graph.h"
 #include "dx_helper.h"
+#include "dx_ring.h"
+#include "dx_scene.h"
+#include "soft/soft_arena.h"
+#include "soft/soft_jobs.h"
+#include "soft/soft_resize.h"
+#include "soft/soft_swapchain.h"
 
 class DXBlue
 {
@@ -22,25 +36,82 @@ public:
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue>	        g_pCommandQueue;
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>		g_pCommandAllocator[g_FrameCount];
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	g_pCommandList;		// Send to GPU
+
+	// the scene is recorded in up to g_MaxRecordSlices command lists on worker threads,
+	// they run between g_pCommandList (barrier and clear) and g_pEndCommandList (barrier to present)
+	static const uint32_t								g_MaxRecordSlices = 4;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>		g_pSliceAllocator[g_FrameCount][g_MaxRecordSlices];
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	g_pSliceCommandList[g_MaxRecordSlices];
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>	g_pEndCommandList;
+	std::unique_ptr<SoftThreadPool>						g_pRecordPool;
+	// records slice `slice` of `sliceCount`, called on a worker with the targets, viewport and scissor already set
+	std::function<void(ID3D12GraphicsCommandList*, uint32_t, uint32_t)>	g_RecordSlice;
+	uint32_t											g_RecordSliceCount = 0; // 0 when nothing is recorded into slices
+	uint32_t											g_MinDrawsPerSlice = 64;
+	// the scenes of the software path, their draw items are recorded with d3d
+	SoftPipelineCache									g_ScenePipelines;
+	SoftScene											g_Scene;
+	SoftSceneId											g_SceneId = SoftSceneId::Crowd;
+	SoftCamera											g_Camera;
+	DXScene												g_SceneRenderer;
+	bool												g_PendingSceneUploads = true;
+	ArenaVector<SoftDrawItem>							g_DrawItems;
+	std::chrono::steady_clock::time_point				g_StartTime;
+	ID3D12CommandList*									g_pSubmitLists[g_MaxRecordSlices + 2];
+	uint32_t											g_submitCount = 0;
+	// transient cpu data of a frame, like the graph, reset once the fence passed the frame slot
+	FrameArenas											g_FrameArenas;
+	// the frame is declared as a render graph, it derives the back buffer transitions
+	RenderGraph											g_Graph;
+	DXGraphResources									g_GraphResources;
+	ID3D12GraphicsCommandList*							g_pCurrentList = nullptr; // where the graph records its barriers
 	Microsoft::WRL::ComPtr<IDXGISwapChain3>				g_pSwapChain;
 	HANDLE												g_pSwapChainWaitableObject;
+	// fifo waits for vblank, mailbox and immediate present right away and let the flip model show the newest frame.
+	// Tearing would need DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING, which the swap chain is not created with
+	SoftPresentMode										g_PresentMode = SoftPresentMode::Fifo;
 	uint32_t											g_pFrameIndex; // current rtv we are on
+	uint32_t											g_frameSlot; // per frame resources (command allocator) of the frame being recorded
 
-	Microsoft::WRL::ComPtr<ID3D12Fence>					g_pFence[g_FrameCount];
-	uint64_t											g_pFenceValue[g_FrameCount];
-	uint64_t											g_fenceLastSignaledValue[g_FrameCount];
-	HANDLE												g_pFenceEvent; // a handle to an event when our fence is unlocked by the gpu
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>		g_pRtvHeap;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>		g_pDsvHeap;
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>		g_pSrvHeap;
-	uint32_t											g_rtvDescriptorSize;
+	DXTimelineFence										g_Fence; // signaled with the frame number once the gpu finished a frame
+	FrameScheduler										g_FrameScheduler; // keeps g_FrameCount frames in flight
+	// per frame dynamic data, reclaimed through g_Fence
+	static const uint64_t								g_UploadRingSize = 4ull << 20;
+	DXUploadRing										g_UploadRing;
+	// views that live as long as their resource come from the persistent part of a heap, bindings that
+	// only last a frame from the frame slot's part, which is reused once g_Fence passed it
+	static const uint32_t								g_RtvPersistentCount = 64;
+	static const uint32_t								g_DsvPersistentCount = 16;
+	static const uint32_t								g_SrvPersistentCount = 1024;
+	static const uint32_t								g_SrvPerFrameCount = 256;
+	DXDescriptorHeap									g_RtvHeap;
+	DXDescriptorHeap									g_DsvHeap;
+	DXDescriptorHeap									g_SrvHeap;
+	DXDescriptor										g_BackBufferRtv[g_FrameCount];
+	DXDescriptor										g_DepthStencilDsv;
 	uint32_t											g_currentBackBuffer;
 	Microsoft::WRL::ComPtr<ID3D12Resource>				g_SwapChainBuffer[g_FrameCount];
 	Microsoft::WRL::ComPtr<ID3D12Resource>				g_DepthStencilBuffer;
+	RenderTargetKey										g_DepthStencilKey;
+	// depth buffers and graph targets given up by resizes, handed out again once no frame in flight can use them
+	RenderTargetPool<Microsoft::WRL::ComPtr<ID3D12Resource>>	g_TargetPool{ g_FrameCount, 8 };
 
 	D3D12_VIEWPORT										g_ScreenViewport;
 	D3D12_RECT											g_ScissorRect;
 
+	// resizes are debounced, the new depth buffer is created on a background thread while frames keep
+	// going into the old targets, which the swap chain stretches to the window
+	ResizeDebouncer										g_ResizeDebouncer;
+	std::unique_ptr<SoftThreadPool>						g_pBackgroundPool;
+	// set when background work finished that the next frame picks up, so an idle main loop wakes for it
+	HANDLE												g_hWakeEvent = nullptr;
+	bool												g_ResizeInFlight = false;
+	std::atomic<bool>									g_ResizeReady{ false };
+	std::exception_ptr									g_ResizeError;
+	uint32_t											g_PendingWidth = 0;
+	uint32_t											g_PendingHeight = 0;
+	Microsoft::WRL::ComPtr<ID3D12Resource>				g_PendingDepthStencilBuffer;
+
 	void Init();
 	
 	void CreateDevice();
@@ -49,11 +120,27 @@ public:
 	// Buffers are abstracted as resources
 	void CreateDescriptorHeaps();
 	void CreateBuffers();
+	void CreateSwapChainBuffers();
+	// created in the depth write state, safe to call from a background thread
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDepthStencilBuffer(uint32_t width, uint32_t height);
+	void CreateDepthStencilView();
+	void CreateScene();
+
+	// from WM_SIZE, cheap enough to call for every event of a drag
+	void RequestResize(uint32_t width, uint32_t height);
+	// call before BeginFrame, swaps in the new targets once they are ready
+	void ApplyPendingResize();
 
+	// waits until the frame slot is free again and picks up the current back buffer, returns the slot
+	uint32_t BeginFrame();
+	// signals the fence for the frame after its command lists were executed
+	void EndFrame();
+	void WaitForGpuIdle();
 	void UpdatePipeline();
-	void WaitForPreviousFrame();
-	uint32_t WaitForNextFrameResources();
+	void RecordSlices(D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle);
 
+	// presents the current back buffer in g_PresentMode
+	void Present();
 	void Render();
 	void Cleanup();
 
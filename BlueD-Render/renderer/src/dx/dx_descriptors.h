@@ -0,0 +1,66 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "dx_helper.h"
+#include "soft/soft_descriptors.h"
+
+struct DXDescriptor
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE		cpu = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE		gpu = {};		// only set in shader visible heaps
+	uint32_t						index = 0;
+};
+
+// A descriptor heap managed by a DescriptorAllocator, persistent views plus per frame bindings
+class DXDescriptorHeap
+{
+public:
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>	g_pHeap;
+	uint32_t										g_DescriptorSize = 0;
+	bool											g_ShaderVisible = false;
+	DescriptorAllocator								g_Allocator;
+
+	void Init(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t persistentCount, uint32_t perFrameCount, uint32_t frameCount, bool shaderVisible)
+	{
+		g_Allocator.Init(persistentCount, perFrameCount, frameCount);
+		g_ShaderVisible = shaderVisible;
+
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.Type = type;
+		heapDesc.NumDescriptors = g_Allocator.Capacity();
+		// only cbv/srv/uav and sampler heaps can be shader visible, rtv and dsv heaps hold the output of the pipeline
+		heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&g_pHeap)));
+		// descriptor sizes vary from device to device, so the offset of a handle has to be asked for
+		g_DescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+	}
+
+	void Release()
+	{
+		g_pHeap.Reset();
+	}
+
+	DXDescriptor Get(uint32_t index) const
+	{
+		DXDescriptor descriptor;
+		descriptor.index = index;
+		descriptor.cpu = g_pHeap->GetCPUDescriptorHandleForHeapStart();
+		descriptor.cpu.ptr += static_cast<SIZE_T>(index) * g_DescriptorSize;
+		if (g_ShaderVisible)
+		{
+			descriptor.gpu = g_pHeap->GetGPUDescriptorHandleForHeapStart();
+			descriptor.gpu.ptr += static_cast<UINT64>(index) * g_DescriptorSize;
+		}
+		return descriptor;
+	}
+
+	DXDescriptor AllocatePersistent() { return Get(g_Allocator.AllocatePersistent()); }
+	void FreePersistent(const DXDescriptor& descriptor) { g_Allocator.FreePersistent(descriptor.index); }
+	// the first of count contiguous descriptors, valid until the gpu finished the current frame
+	DXDescriptor AllocateFrame(uint32_t count) { return Get(g_Allocator.AllocateFrame(count)); }
+
+	void BeginFrame(uint32_t slot, uint64_t completedFenceValue) { g_Allocator.BeginFrame(slot, completedFenceValue); }
+	void EndFrame(uint64_t fenceValue) { g_Allocator.EndFrame(fenceValue); }
+};
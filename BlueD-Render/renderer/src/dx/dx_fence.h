@@ -0,0 +1,50 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <windows.h>
+
+#include "dx_helper.h"
+#include "soft/soft_fence.h"
+
+// ID3D12Fence used as a timeline, waits go through one auto reset event
+class DXTimelineFence : public TimelineFence
+{
+public:
+	Microsoft::WRL::ComPtr<ID3D12Fence>		g_pFence;
+	HANDLE									g_hEvent = nullptr;
+
+	void Init(ID3D12Device* device)
+	{
+		ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_pFence)));
+		g_hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (!g_hEvent)
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	void Release()
+	{
+		g_pFence.Reset();
+		if (g_hEvent)
+			CloseHandle(g_hEvent);
+		g_hEvent = nullptr;
+	}
+
+	void Signal(ID3D12CommandQueue* queue, uint64_t value)
+	{
+		ThrowIfFailed(queue->Signal(g_pFence.Get(), value));
+	}
+
+	uint64_t GetCompletedValue() const override
+	{
+		return g_pFence->GetCompletedValue();
+	}
+
+	void Wait(uint64_t value) override
+	{
+		if (g_pFence->GetCompletedValue() >= value)
+			return;
+		ThrowIfFailed(g_pFence->SetEventOnCompletion(value, g_hEvent));
+		WaitForSingleObject(g_hEvent, INFINITE);
+	}
+};
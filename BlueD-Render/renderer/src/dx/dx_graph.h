@@ -0,0 +1,116 @@
+#pragma once
+
+#include <d3d12.h>
+#include <vector>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "dx_helper.h"
+#include "soft/soft_graph.h"
+#include "soft/soft_pool.h"
+
+inline D3D12_RESOURCE_STATES ToD3D12State(SoftResourceState state)
+{
+	switch (state)
+	{
+	case SoftResourceState::RenderTarget: return D3D12_RESOURCE_STATE_RENDER_TARGET;
+	case SoftResourceState::DepthWrite: return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	case SoftResourceState::ShaderResource: return D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	case SoftResourceState::CopyDest: return D3D12_RESOURCE_STATE_COPY_DEST;
+	case SoftResourceState::Present: return D3D12_RESOURCE_STATE_PRESENT;
+	default: return D3D12_RESOURCE_STATE_COMMON;
+	}
+}
+
+inline DXGI_FORMAT ToDXGIFormat(SoftFormat format)
+{
+	return format == SoftFormat::D32_FLOAT ? DXGI_FORMAT_D32_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+}
+
+// Backs the resources of a compiled graph with d3d resources. Transients in one alias slot share
+// a committed resource, the graph only aliases identical descs.
+class DXGraphResources
+{
+public:
+	// when set, slot resources come from and go back to this pool as the graph changes shape
+	// pooled by DXGI format
+	RenderTargetPool<Microsoft::WRL::ComPtr<ID3D12Resource>>*	g_pPool = nullptr;
+
+	void Bind(RenderGraphResource resource, ID3D12Resource* d3dResource)
+	{
+		if (g_Bound.size() <= resource)
+			g_Bound.resize(resource + 1, nullptr);
+		g_Bound[resource] = d3dResource;
+	}
+
+	void Realize(ID3D12Device* device, const RenderGraph& graph)
+	{
+		uint32_t slotCount = graph.GetAliasSlotCount();
+		if (g_Slots.size() < slotCount)
+		{
+			g_Slots.resize(slotCount);
+			g_SlotDescs.resize(slotCount);
+		}
+		for (uint32_t slot = 0; slot < slotCount; ++slot)
+		{
+			const RenderGraphTextureDesc& desc = graph.GetAliasSlotDesc(slot);
+			RenderGraphTextureDesc& current = g_SlotDescs[slot];
+			if (g_Slots[slot] && current.width == desc.width && current.height == desc.height && current.format == desc.format)
+				continue;
+
+			// slots are in common between frames, so that is the state they go into the pool and come out in
+			if (g_pPool && g_Slots[slot])
+				g_pPool->Release({ current.width, current.height, static_cast<uint32_t>(ToDXGIFormat(current.format)) }, std::move(g_Slots[slot]));
+			g_Slots[slot].Reset();
+			current = desc;
+			if (g_pPool && g_pPool->Acquire({ desc.width, desc.height, static_cast<uint32_t>(ToDXGIFormat(desc.format)) }, g_Slots[slot]))
+				continue;
+
+			bool depth = desc.format == SoftFormat::D32_FLOAT;
+			CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(ToDXGIFormat(desc.format),
+				desc.width, desc.height, 1, 1, 1, 0, depth ? D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL : D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+			CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+			// slots rest in common between frames, the graph transitions them from there
+			ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+				D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&g_Slots[slot])));
+		}
+
+		if (g_Bound.size() < graph.GetResourceCount())
+			g_Bound.resize(graph.GetResourceCount(), nullptr);
+		for (RenderGraphResource resource = 0; resource < graph.GetResourceCount(); ++resource)
+		{
+			if (graph.IsTransient(resource))
+				g_Bound[resource] = graph.GetAliasSlot(resource) != kInvalidGraphResource ? g_Slots[graph.GetAliasSlot(resource)].Get() : nullptr;
+		}
+	}
+
+	ID3D12Resource* Get(RenderGraphResource resource) const { return g_Bound[resource]; }
+
+	void RecordBarriers(ID3D12GraphicsCommandList* commandList, const RenderGraphBarrier* barriers, size_t count)
+	{
+		g_Barriers.clear();
+		for (size_t i = 0; i < count; ++i)
+		{
+			// a transient taking over a slot sees the previous contents, the pass that writes it clears or overwrites them
+			if (barriers[i].before != barriers[i].after)
+				g_Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(g_Bound[barriers[i].resource],
+					ToD3D12State(barriers[i].before), ToD3D12State(barriers[i].after)));
+		}
+		// one call for all transitions of a pass
+		if (!g_Barriers.empty())
+			commandList->ResourceBarrier(static_cast<UINT>(g_Barriers.size()), g_Barriers.data());
+	}
+
+	void Release()
+	{
+		g_Slots.clear();
+		g_SlotDescs.clear();
+		g_Bound.clear();
+	}
+
+private:
+	std::vector<ID3D12Resource*>							g_Bound;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>		g_Slots;
+	std::vector<RenderGraphTextureDesc>						g_SlotDescs;
+	std::vector<D3D12_RESOURCE_BARRIER>						g_Barriers;
+};
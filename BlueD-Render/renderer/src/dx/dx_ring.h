@@ -0,0 +1,86 @@
+#pragma once
+
+#include <d3d12.h>
+#include <stdexcept>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "dx_helper.h"
+#include "soft/soft_fence.h"
+#include "soft/soft_ring.h"
+
+struct DXUploadAllocation
+{
+	void*						cpuAddress = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS	gpuAddress = 0;
+	uint64_t					size = 0;
+};
+
+// One persistently mapped upload buffer shared by all per frame dynamic data, ui geometry, constants, instances.
+// An allocation is a pointer bump, the space comes back once the fence passes the frame that used it.
+class DXUploadRing
+{
+public:
+	Microsoft::WRL::ComPtr<ID3D12Resource>	g_pBuffer;
+	uint8_t*								g_pMapped = nullptr;
+	RingAllocator							g_Ring;
+	TimelineFence*							g_pFence = nullptr;
+	uint64_t								g_Stalls = 0;		// allocations that had to wait for the gpu
+
+	void Init(ID3D12Device* device, TimelineFence* fence, uint64_t capacity)
+	{
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+		ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&g_pBuffer)));
+		// upload heaps may stay mapped for their whole lifetime, the cpu never reads them back
+		D3D12_RANGE readRange = { 0, 0 };
+		ThrowIfFailed(g_pBuffer->Map(0, &readRange, reinterpret_cast<void**>(&g_pMapped)));
+		g_Ring.Init(capacity);
+		g_pFence = fence;
+		g_Stalls = 0;
+	}
+
+	void Release()
+	{
+		if (g_pBuffer && g_pMapped)
+			g_pBuffer->Unmap(0, nullptr);
+		g_pMapped = nullptr;
+		g_pBuffer.Reset();
+	}
+
+	// reclaims the frames the gpu has finished, call when a frame starts
+	void BeginFrame()
+	{
+		g_Ring.Retire(g_pFence->GetCompletedValue());
+	}
+
+	// everything allocated since the last call is in use until the fence reaches fenceValue
+	void EndFrame(uint64_t fenceValue)
+	{
+		g_Ring.EndFrame(fenceValue);
+	}
+
+	DXUploadAllocation Allocate(uint64_t size, uint64_t alignment = 256)
+	{
+		uint64_t offset = g_Ring.Allocate(size, alignment);
+		// a full ring waits for the oldest frame, size the ring from the high water mark to keep this rare
+		while (offset == RingAllocator::kInvalidOffset && g_Ring.HasPendingFrames())
+		{
+			++g_Stalls;
+			g_pFence->Wait(g_Ring.OldestPendingFence());
+			g_Ring.Retire(g_pFence->GetCompletedValue());
+			offset = g_Ring.Allocate(size, alignment);
+		}
+		if (offset == RingAllocator::kInvalidOffset)
+			throw std::runtime_error("upload ring is too small for the data of one frame");
+
+		DXUploadAllocation allocation;
+		allocation.cpuAddress = g_pMapped + offset;
+		allocation.gpuAddress = g_pBuffer->GetGPUVirtualAddress() + offset;
+		allocation.size = size;
+		return allocation;
+	}
+
+	const RingAllocatorStats& GetStats() const { return g_Ring.GetStats(); }
+};
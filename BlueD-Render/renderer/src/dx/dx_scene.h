@@ -0,0 +1,267 @@
+#pragma once
+
+#include <d3d12.h>
+#include <d3dcompiler.h>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "dx_descriptors.h"
+#include "dx_helper.h"
+#include "dx_ring.h"
+#include "soft/soft_scene.h"
+
+#pragma comment(lib, "d3dcompiler")
+
+// Draws the draw items of a SoftScene with d3d, so the window shows the same scenes as the software path.
+// Shading rates are ignored, the warp adapter has no variable rate shading.
+class DXScene
+{
+public:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature>		g_pRootSignature;
+	Microsoft::WRL::ComPtr<ID3DBlob>				g_pVertexShader[2];		// by layout, PosColor and PosColorUV
+	Microsoft::WRL::ComPtr<ID3DBlob>				g_pPixelShader[static_cast<size_t>(SoftShader::Count)];
+	DXGI_FORMAT										g_RtvFormat = DXGI_FORMAT_UNKNOWN;
+	DXGI_FORMAT										g_DsvFormat = DXGI_FORMAT_UNKNOWN;
+	// one d3d state per soft state. Created by Prepare on the main thread, the recording workers only look them up
+	std::unordered_map<const SoftPipelineState*, Microsoft::WRL::ComPtr<ID3D12PipelineState>>	g_States;
+	// the meshes of the frame, in the upload ring
+	D3D12_VERTEX_BUFFER_VIEW						g_VertexViews[static_cast<size_t>(SoftMesh::Count)] = {};
+	D3D12_INDEX_BUFFER_VIEW							g_IndexViews[static_cast<size_t>(SoftMesh::Count)] = {};
+	uint32_t										g_IndexCounts[static_cast<size_t>(SoftMesh::Count)] = {};
+	// the texture view is written into the frame's part of the srv heap every frame it is drawn with
+	Microsoft::WRL::ComPtr<ID3D12Resource>			g_pTexture;
+	ID3D12DescriptorHeap*							g_pSrvHeap = nullptr;
+	DXDescriptor									g_TextureSrv;
+
+	void Init(ID3D12Device* device, const SoftScene& scene, DXGI_FORMAT rtvFormat, DXGI_FORMAT dsvFormat)
+	{
+		g_RtvFormat = rtvFormat;
+		g_DsvFormat = dsvFormat;
+
+		// filled by RecordUploads, which leaves it in the pixel shader resource state
+		SoftTextureData texture = scene.GetTexture();
+		CD3DX12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, texture.width, texture.height, 1, 1);
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &textureDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&g_pTexture)));
+
+		// the world view projection matrix as root constants and the texture as a table of one srv
+		CD3DX12_DESCRIPTOR_RANGE textureRange;
+		textureRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+		CD3DX12_ROOT_PARAMETER parameters[2];
+		parameters[0].InitAsConstants(16, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+		parameters[1].InitAsDescriptorTable(1, &textureRange, D3D12_SHADER_VISIBILITY_PIXEL);
+		// nearest and wrap, like the software sampler
+		CD3DX12_STATIC_SAMPLER_DESC sampler(0, D3D12_FILTER_MIN_MAG_MIP_POINT);
+		CD3DX12_ROOT_SIGNATURE_DESC rootDesc(2, parameters, 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+		Microsoft::WRL::ComPtr<ID3DBlob> signature;
+		ThrowIfFailed(D3D12SerializeRootSignature(&rootDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, nullptr));
+		ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&g_pRootSignature)));
+
+		// Mat4 is row major and transforms row vectors, like the software vertex fetch
+		static const char* shader =
+			"cbuffer DrawConstants : register(b0) { row_major float4x4 WorldViewProj; };\n"
+			"Texture2D Texture : register(t0);\n"
+			"SamplerState Sampler : register(s0);\n"
+			"struct VSInput { float3 pos : POSITION; float4 col : COLOR0; float2 uv : TEXCOORD0; };\n"
+			"struct PSInput { float4 pos : SV_POSITION; float4 col : COLOR0; float2 uv : TEXCOORD0; };\n"
+			"PSInput VSMain(VSInput input)\n"
+			"{\n"
+			"    PSInput output;\n"
+			"    output.pos = mul(float4(input.pos, 1.0f), WorldViewProj);\n"
+			"    output.col = input.col;\n"
+			"    output.uv = input.uv;\n"
+			"    return output;\n"
+			"}\n"
+			"struct VSInputColor { float3 pos : POSITION; float4 col : COLOR0; };\n"
+			"PSInput VSMainColor(VSInputColor input)\n"
+			"{\n"
+			"    VSInput full = { input.pos, input.col, float2(0.0f, 0.0f) };\n"
+			"    return VSMain(full);\n"
+			"}\n"
+			"float4 PSVertexColor(PSInput input) : SV_Target { return input.col; }\n"
+			"float4 PSTexture(PSInput input) : SV_Target { return Texture.Sample(Sampler, input.uv); }\n"
+			"float4 PSTextureModulate(PSInput input) : SV_Target { return Texture.Sample(Sampler, input.uv) * input.col; }\n";
+		const char* vertexEntries[2] = { "VSMainColor", "VSMain" };
+		for (int i = 0; i < 2; ++i)
+			ThrowIfFailed(D3DCompile(shader, strlen(shader), nullptr, nullptr, nullptr, vertexEntries[i], "vs_5_0", 0, 0, &g_pVertexShader[i], nullptr));
+		const char* pixelEntries[static_cast<size_t>(SoftShader::Count)] = { "PSVertexColor", "PSTexture", "PSTextureModulate" };
+		for (size_t i = 0; i < static_cast<size_t>(SoftShader::Count); ++i)
+			ThrowIfFailed(D3DCompile(shader, strlen(shader), nullptr, nullptr, nullptr, pixelEntries[i], "ps_5_0", 0, 0, &g_pPixelShader[i], nullptr));
+	}
+
+	// records the copy of the texture, once before the first frame that draws the scene
+	void RecordUploads(ID3D12GraphicsCommandList* commandList, DXUploadRing& ring, const SoftScene& scene)
+	{
+		SoftTextureData texture = scene.GetTexture();
+		// rows of a texture copy are aligned to 256 bytes
+		uint32_t rowBytes = texture.width * static_cast<uint32_t>(sizeof(uint32_t));
+		uint32_t rowPitch = (rowBytes + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+		DXUploadAllocation upload = ring.Allocate(static_cast<uint64_t>(rowPitch) * texture.height, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		for (uint32_t y = 0; y < texture.height; ++y)
+			memcpy(static_cast<uint8_t*>(upload.cpuAddress) + static_cast<size_t>(y) * rowPitch, texture.texels + static_cast<size_t>(y) * texture.width, rowBytes);
+
+		D3D12_TEXTURE_COPY_LOCATION source = {};
+		source.pResource = ring.g_pBuffer.Get();
+		source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		source.PlacedFootprint.Offset = upload.gpuAddress - ring.g_pBuffer->GetGPUVirtualAddress();
+		source.PlacedFootprint.Footprint = { DXGI_FORMAT_R8G8B8A8_UNORM, texture.width, texture.height, 1, rowPitch };
+		D3D12_TEXTURE_COPY_LOCATION destination = {};
+		destination.pResource = g_pTexture.Get();
+		destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		destination.SubresourceIndex = 0;
+		commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+
+		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(g_pTexture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		commandList->ResourceBarrier(1, &barrier);
+	}
+
+	// creates the states of new items, uploads the meshes and binds the texture for the frame, call before the items are recorded
+	void Prepare(ID3D12Device* device, DXUploadRing& ring, DXDescriptorHeap& srvHeap, const SoftScene& scene, const SoftDrawItem* items, size_t count)
+	{
+		bool textured = false;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (g_States.find(items[i].state) == g_States.end())
+				g_States[items[i].state] = CreatePipelineState(device, items[i].state->desc);
+			textured = textured || items[i].state->desc.shader != SoftShader::VertexColor;
+		}
+
+		for (uint32_t mesh = 0; mesh < static_cast<uint32_t>(SoftMesh::Count); ++mesh)
+		{
+			SoftMeshData data = scene.GetMesh(static_cast<SoftMesh>(mesh));
+			uint32_t indexBytes = data.indexCount * static_cast<uint32_t>(sizeof(uint32_t));
+			DXUploadAllocation vertices = ring.Allocate(data.vertexBytes, 16);
+			DXUploadAllocation indices = ring.Allocate(indexBytes, 16);
+			memcpy(vertices.cpuAddress, data.vertices, data.vertexBytes);
+			memcpy(indices.cpuAddress, data.indices, indexBytes);
+			g_VertexViews[mesh] = { vertices.gpuAddress, data.vertexBytes, data.stride };
+			g_IndexViews[mesh] = { indices.gpuAddress, indexBytes, DXGI_FORMAT_R32_UINT };
+			g_IndexCounts[mesh] = data.indexCount;
+		}
+
+		// a view that only lives for the frame, the region is reused once the fence passed the frame
+		g_pSrvHeap = srvHeap.g_pHeap.Get();
+		g_TextureSrv = DXDescriptor();
+		if (textured)
+		{
+			g_TextureSrv = srvHeap.AllocateFrame(1);
+			device->CreateShaderResourceView(g_pTexture.Get(), nullptr, g_TextureSrv.cpu);
+		}
+	}
+
+	// records a contiguous range of draw items, into a list with the targets, viewport and scissor already set
+	void RecordDrawItems(ID3D12GraphicsCommandList* commandList, const SoftDrawItem* items, size_t count) const
+	{
+		commandList->SetGraphicsRootSignature(g_pRootSignature.Get());
+		commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		if (g_TextureSrv.gpu.ptr != 0)
+		{
+			ID3D12DescriptorHeap* heaps[] = { g_pSrvHeap };
+			commandList->SetDescriptorHeaps(1, heaps);
+			commandList->SetGraphicsRootDescriptorTable(1, g_TextureSrv.gpu);
+		}
+		const SoftPipelineState* boundState = nullptr;
+		SoftMesh boundMesh = SoftMesh::Count;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const SoftDrawItem& item = items[i];
+			if (item.state != boundState)
+			{
+				commandList->SetPipelineState(g_States.find(item.state)->second.Get());
+				boundState = item.state;
+			}
+			size_t mesh = static_cast<size_t>(item.mesh);
+			if (item.mesh != boundMesh)
+			{
+				commandList->IASetVertexBuffers(0, 1, &g_VertexViews[mesh]);
+				commandList->IASetIndexBuffer(&g_IndexViews[mesh]);
+				boundMesh = item.mesh;
+			}
+			commandList->SetGraphicsRoot32BitConstants(0, 16, &item.worldViewProj, 0);
+			INT baseVertex = item.mesh == SoftMesh::Quad ? static_cast<INT>(item.colorIndex * 4) : 0;
+			commandList->DrawIndexedInstanced(g_IndexCounts[mesh], 1, 0, baseVertex, 0);
+		}
+	}
+
+	void Release()
+	{
+		g_States.clear();
+		g_pTexture.Reset();
+		g_pSrvHeap = nullptr;
+		g_pRootSignature.Reset();
+		for (Microsoft::WRL::ComPtr<ID3DBlob>& blob : g_pVertexShader)
+			blob.Reset();
+		for (Microsoft::WRL::ComPtr<ID3DBlob>& blob : g_pPixelShader)
+			blob.Reset();
+	}
+
+private:
+	static D3D12_COMPARISON_FUNC ToD3D12Compare(SoftCompare compare)
+	{
+		switch (compare)
+		{
+		case SoftCompare::LessEqual: return D3D12_COMPARISON_FUNC_LESS_EQUAL;
+		case SoftCompare::Greater: return D3D12_COMPARISON_FUNC_GREATER;
+		case SoftCompare::Always: return D3D12_COMPARISON_FUNC_ALWAYS;
+		default: return D3D12_COMPARISON_FUNC_LESS;
+		}
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> CreatePipelineState(ID3D12Device* device, const SoftPipelineDesc& desc) const
+	{
+		const D3D12_INPUT_ELEMENT_DESC colorLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(SoftVertexPosColor, pos), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(SoftVertexPosColor, color), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		const D3D12_INPUT_ELEMENT_DESC texturedLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(SoftVertexPosColorUV, pos), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(SoftVertexPosColorUV, color), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(SoftVertexPosColorUV, uv), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		bool textured = desc.layout == SoftVertexLayout::PosColorUV;
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+		psoDesc.InputLayout = textured ? D3D12_INPUT_LAYOUT_DESC{ texturedLayout, _countof(texturedLayout) } : D3D12_INPUT_LAYOUT_DESC{ colorLayout, _countof(colorLayout) };
+		psoDesc.pRootSignature = g_pRootSignature.Get();
+		psoDesc.VS = CD3DX12_SHADER_BYTECODE(g_pVertexShader[textured ? 1 : 0].Get());
+		psoDesc.PS = CD3DX12_SHADER_BYTECODE(g_pPixelShader[static_cast<size_t>(desc.shader)].Get());
+		psoDesc.SampleMask = UINT_MAX;
+		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		psoDesc.NumRenderTargets = 1;
+		psoDesc.RTVFormats[0] = g_RtvFormat;
+		psoDesc.DSVFormat = g_DsvFormat;
+		psoDesc.SampleDesc.Count = 1;
+
+		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+		psoDesc.RasterizerState.CullMode = desc.cull == SoftCull::Front ? D3D12_CULL_MODE_FRONT : desc.cull == SoftCull::Back ? D3D12_CULL_MODE_BACK : D3D12_CULL_MODE_NONE;
+		psoDesc.RasterizerState.FrontCounterClockwise = desc.frontCounterClockwise;
+
+		psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+		psoDesc.DepthStencilState.DepthEnable = desc.depthEnable;
+		psoDesc.DepthStencilState.DepthWriteMask = desc.depthWrite ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+		psoDesc.DepthStencilState.DepthFunc = ToD3D12Compare(desc.depthFunc);
+
+		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+		D3D12_RENDER_TARGET_BLEND_DESC& blend = psoDesc.BlendState.RenderTarget[0];
+		if (desc.blend != SoftBlend::Opaque)
+		{
+			blend.BlendEnable = TRUE;
+			blend.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+			blend.DestBlend = desc.blend == SoftBlend::Additive ? D3D12_BLEND_ONE : D3D12_BLEND_INV_SRC_ALPHA;
+			blend.BlendOp = D3D12_BLEND_OP_ADD;
+			blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+			blend.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+			blend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+		}
+
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> state;
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&state)));
+		return state;
+	}
+};
@@ -1,12 +1,20 @@
 #include "gui.h"
 
+#include "gui_font_cache.h"
+
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+// drives frames while windows runs its modal loop for a border drag
+const UINT_PTR kLiveResizeTimer = 1;
+
 // handle window event
 LRESULT WINAPI WindowProcess(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
 	if (ImGui_ImplWin32_WndProcHandler(hwnd, msg, wParam, lParam)) return true;
 
+	// set by the owner of the window once the device exists
+	DXBlue* dx = reinterpret_cast<DXBlue*>(::GetWindowLongPtr(hwnd, GWLP_USERDATA));
+
 	switch (msg)
 	{
 	case WM_SYSCOMMAND:
@@ -14,6 +22,32 @@ LRESULT WINAPI WindowProcess(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		if ((wParam & 0xfff0) == SC_KEYMENU) return 0;
 	} break;
 
+	case WM_SIZE:
+	{
+		// only recorded here, the renderer reallocates once the size settles
+		if (dx && wParam != SIZE_MINIMIZED)
+			dx->RequestResize(LOWORD(lParam), HIWORD(lParam));
+	} return 0;
+
+	case WM_ENTERSIZEMOVE:
+	{
+		::SetTimer(hwnd, kLiveResizeTimer, USER_TIMER_MINIMUM, nullptr);
+	} return 0;
+
+	case WM_EXITSIZEMOVE:
+	{
+		::KillTimer(hwnd, kLiveResizeTimer);
+		// the drag is over, no need to wait out the debounce
+		if (dx)
+			dx->g_ResizeDebouncer.Flush();
+	} return 0;
+
+	case WM_TIMER:
+	{
+		if (wParam == kLiveResizeTimer && dx)
+			dx->Render();
+	} return 0;
+
 	case WM_DESTROY:
 	{
 		::PostQuitMessage(0);
@@ -28,6 +62,40 @@ LRESULT WINAPI WindowProcess(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 // Window data
 bool		show_demo_window = false;
 
+// imgui geometry goes into the renderer's upload ring instead of buffers the backend grows itself
+static bool AllocateImGuiUpload(void* userData, size_t size, size_t alignment, void** cpuAddress, ImU64* gpuAddress)
+{
+	DXUploadAllocation allocation = static_cast<DXBlue*>(userData)->g_UploadRing.Allocate(size, alignment);
+	*cpuAddress = allocation.cpuAddress;
+	*gpuAddress = allocation.gpuAddress;
+	return true;
+}
+
+// imgui keeps its buffers from frame to frame, so its allocations cannot come out of a frame arena.
+// They are counted instead, once the ui has settled a frame should not make any.
+// Atomic as the font atlas allocates from the record pool while it rasterizes glyphs
+static std::atomic<ImU64>	imguiAllocations{ 0 };
+
+static void* AllocateImGuiMemory(size_t size, void*)
+{
+	++imguiAllocations;
+	return malloc(size);
+}
+
+static void FreeImGuiMemory(void* ptr, void*)
+{
+	free(ptr);
+}
+
+// glyphs of the font atlas are rasterized on the record pool, the atlas is the same as a serial build
+static void BuildFontAtlasParallel(void* userData, int jobsCount, void (*jobFunc)(void* jobData, int jobIndex), void* jobData)
+{
+	static_cast<SoftThreadPool*>(userData)->ParallelFor(static_cast<uint32_t>(jobsCount), [jobFunc, jobData](uint32_t job)
+	{
+		jobFunc(jobData, static_cast<int>(job));
+	});
+}
+
 Gui::Gui()
 {
 }
@@ -85,6 +153,7 @@ void Gui::CreateGui()
 {
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
+	ImGui::SetAllocatorFunctions(AllocateImGuiMemory, FreeImGuiMemory);
 	ImGui::CreateContext();
 	io = ImGui::GetIO(); (void)io;
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
@@ -95,10 +164,11 @@ void Gui::CreateGui()
 	ImGui::StyleColorsDark();
 	//ImGui::StyleColorsLight();
 	// Load Fonts
+	io.Fonts->BuildParallelFor = BuildFontAtlasParallel;
+	io.Fonts->BuildParallelForUserData = dx->g_pRecordPool.get();
 	//io.Fonts->AddFontFromFileTTF("D:\\Programming\\CG\B\lueD-Software-Renderer\\BlueD-Render\\renderer\\resource\\font\\Roboto-Regular.ttf", 15.0f);
-	//int width, height;
-	//unsigned char* pixels = nullptr;
-	//io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	// the atlas comes out of the cache next to imgui.ini, it is built and written again when the fonts above change
+	BuildFontAtlasCached(io.Fonts, "imgui_fonts.cache");
 
 	// When viewports are enabled we tweak WindowRounding/WindowBg so platform windows can look identical to regular ones.
 	ImGuiStyle& style = ImGui::GetStyle();
@@ -110,18 +180,20 @@ void Gui::CreateGui()
 
 	// Setup Platform/Renderer backends
 	ImGui_ImplWin32_Init(window);
+	fontSrv = dx->g_SrvHeap.AllocatePersistent();
 	ImGui_ImplDX12_Init(dx->g_pDevice.Get(), dx->g_FrameCount,
-		DXGI_FORMAT_R8G8B8A8_UNORM, dx->g_pSrvHeap.Get(),
-		dx->g_pSrvHeap->GetCPUDescriptorHandleForHeapStart(),
-		dx->g_pSrvHeap->GetGPUDescriptorHandleForHeapStart());
+		DXGI_FORMAT_R8G8B8A8_UNORM, dx->g_SrvHeap.g_pHeap.Get(),
+		fontSrv.cpu, fontSrv.gpu);
+	ImGui_ImplDX12_SetUploadAllocator(AllocateImGuiUpload, dx);
 }
 
 void Gui::CleanUpGui()
 {
-	dx->WaitForPreviousFrame();
+	dx->WaitForGpuIdle();
 
 	// Cleanup
 	ImGui_ImplDX12_Shutdown();
+	dx->g_SrvHeap.FreePersistent(fontSrv);
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 }
@@ -237,6 +309,19 @@ void Gui::RenderGui()
 		ImGui::Checkbox("Demo Window", &show_demo_window);      
 
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+		const RingAllocatorStats& ringStats = dx->g_UploadRing.GetStats();
+		const DescriptorAllocatorStats& srvStats = dx->g_SrvHeap.g_Allocator.GetStats();
+		ImGui::Text("Srv heap %u / %u persistent, largest frame %u / %u", srvStats.persistentInUse, dx->g_SrvPersistentCount,
+			srvStats.frameHighWater, dx->g_SrvPerFrameCount);
+		static ImU64 lastImGuiAllocations = 0;
+		const FrameArenaStats& arenaStats = dx->g_FrameArenas.Current().GetStats();
+		ImGui::Text("Frame arena %.1f / %.1f KB, high water %.1f KB, %llu system allocations, imgui allocations %llu",
+			arenaStats.used / 1024.0, arenaStats.capacity / 1024.0, arenaStats.highWater / 1024.0,
+			static_cast<unsigned long long>(arenaStats.systemAllocations), static_cast<unsigned long long>(imguiAllocations - lastImGuiAllocations));
+		lastImGuiAllocations = imguiAllocations;
+		ImGui::Text("Upload ring %.1f / %.1f KB, high water %.1f KB, largest frame %.1f KB, %llu stalls",
+			ringStats.used / 1024.0, ringStats.capacity / 1024.0, ringStats.highWater / 1024.0, ringStats.frameHighWater / 1024.0,
+			static_cast<unsigned long long>(dx->g_UploadRing.g_Stalls));
 		ImGui::End();
 	}
 
@@ -244,10 +329,10 @@ void Gui::RenderGui()
 	ImGui::Render();
 
 	// DX12
-	uint32_t nextFrameIndex = dx->WaitForNextFrameResources();
-	ID3D12CommandAllocator* tempCommandAllocator = dx->g_pCommandAllocator[nextFrameIndex].Get();
-	uint64_t tempFenceValue = dx->g_pFenceValue[nextFrameIndex];
-	uint32_t backBufferIdx = dx->g_pSwapChain->GetCurrentBackBufferIndex();
+	dx->ApplyPendingResize();
+	uint32_t frameSlot = dx->BeginFrame();
+	ID3D12CommandAllocator* tempCommandAllocator = dx->g_pCommandAllocator[frameSlot].Get();
+	uint32_t backBufferIdx = dx->g_pFrameIndex;
 	tempCommandAllocator->Reset();
 
 	D3D12_RESOURCE_BARRIER barrier = {};
@@ -262,11 +347,12 @@ void Gui::RenderGui()
 
 	// Render Dear ImGui graphics
 	// here we again get the handle to our current render target view so we can set it as the render target in the output merger stage of the pipeline
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(dx->g_pRtvHeap->GetCPUDescriptorHandleForHeapStart(), dx->g_pFrameIndex, dx->g_rtvDescriptorSize);
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = dx->g_BackBufferRtv[dx->g_pFrameIndex].cpu;
 	const float clear_color_with_alpha[4] = { clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w };
 	dx->g_pCommandList->ClearRenderTargetView(rtvHandle, clear_color_with_alpha, 0, nullptr);
 	dx->g_pCommandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
-	dx->g_pCommandList->SetDescriptorHeaps(1, &dx->g_pSrvHeap);
+	ID3D12DescriptorHeap* descriptorHeaps[] = { dx->g_SrvHeap.g_pHeap.Get() };
+	dx->g_pCommandList->SetDescriptorHeaps(1, descriptorHeaps);
 	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), dx->g_pCommandList.Get());
 	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
 	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
@@ -282,11 +368,7 @@ void Gui::RenderGui()
 		ImGui::RenderPlatformWindowsDefault(nullptr, (void*)dx->g_pCommandList.Get());
 	}
 
-	dx->g_pSwapChain->Present(1, 0); // Present with vsync
-	//g_pSwapChain->Present(0, 0); // Present without vsync
+	dx->Present();
 
-	UINT64 fenceValue = dx->g_fenceLastSignaledValue[dx->g_pFrameIndex] + 1;
-	dx->g_pCommandQueue->Signal(dx->g_pFence[dx->g_pFrameIndex].Get(), fenceValue);
-	dx->g_fenceLastSignaledValue[dx->g_pFrameIndex] = fenceValue;
-	dx->g_pFenceValue[dx->g_pFrameIndex] = fenceValue;
+	dx->EndFrame();
 }
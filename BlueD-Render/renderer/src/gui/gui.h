@@ -30,6 +30,8 @@ public:
 	ImGuiIO					io;
 	// DX12 object
 	DXBlue*					dx;
+	// the font texture view, from the persistent part of the srv heap
+	DXDescriptor			fontSrv;
 
 	void InitWindow();
 	void InitGui();
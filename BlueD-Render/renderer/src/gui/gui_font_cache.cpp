@@ -0,0 +1,515 @@
+#include "gui_font_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char kFontAtlasCacheMagic[4] = { 'B', 'D', 'F', 'A' };
+
+	// 64 bit FNV-1a
+	class KeyHash
+	{
+	public:
+		void Add(const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; ++i)
+				value = (value ^ bytes[i]) * 1099511628211ull;
+		}
+		template <class T> void Add(const T& v) { Add(&v, sizeof(T)); }
+		uint64_t Value() const { return value; }
+
+	private:
+		uint64_t value = 14695981039346656037ull;
+	};
+
+	// read only view of a whole file, empty when it cannot be opened
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const char* path)
+		{
+#ifdef _WIN32
+			file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+				return;
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr)
+				return;
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (data != nullptr)
+				size = static_cast<size_t>(fileSize.QuadPart);
+#else
+			fd = open(path, O_RDONLY);
+			if (fd < 0)
+				return;
+			struct stat fileStat;
+			if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+				return;
+			void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (view == MAP_FAILED)
+				return;
+			data = static_cast<const uint8_t*>(view);
+			size = static_cast<size_t>(fileStat.st_size);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (data != nullptr)
+				UnmapViewOfFile(data);
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+#else
+			if (data != nullptr)
+				munmap(const_cast<uint8_t*>(data), size);
+			if (fd >= 0)
+				close(fd);
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* Data() const { return data; }
+		size_t Size() const { return size; }
+
+	private:
+#ifdef _WIN32
+		HANDLE			file = INVALID_HANDLE_VALUE;
+		HANDLE			mapping = nullptr;
+#else
+		int				fd = -1;
+#endif
+		const uint8_t*	data = nullptr;
+		size_t			size = 0;
+	};
+
+	class Writer
+	{
+	public:
+		std::vector<uint8_t> bytes;
+
+		void Write(const void* data, size_t size)
+		{
+			const uint8_t* begin = static_cast<const uint8_t*>(data);
+			bytes.insert(bytes.end(), begin, begin + size);
+		}
+		template <class T> void Write(const T& value) { Write(&value, sizeof(T)); }
+		template <class T> void WriteVector(const ImVector<T>& v)
+		{
+			Write(static_cast<uint32_t>(v.Size));
+			Write(v.Data, sizeof(T) * static_cast<size_t>(v.Size));
+		}
+	};
+
+	// reads from the mapping, a read past the end leaves ok false and zeroes
+	class Reader
+	{
+	public:
+		Reader(const uint8_t* data, size_t size) : cursor(data), end(data + size) {}
+
+		bool ok = true;
+
+		const uint8_t* Read(size_t size)
+		{
+			if (!ok || static_cast<size_t>(end - cursor) < size)
+			{
+				ok = false;
+				return nullptr;
+			}
+			const uint8_t* data = cursor;
+			cursor += size;
+			return data;
+		}
+		template <class T> T Read()
+		{
+			T value = T();
+			const uint8_t* data = Read(sizeof(T));
+			if (data != nullptr)
+				memcpy(&value, data, sizeof(T));
+			return value;
+		}
+		template <class T> void ReadVector(ImVector<T>& v)
+		{
+			const uint32_t count = Read<uint32_t>();
+			const uint8_t* data = Read(sizeof(T) * static_cast<size_t>(count));
+			if (data == nullptr)
+				return;
+			v.resize(static_cast<int>(count));
+			memcpy(v.Data, data, sizeof(T) * static_cast<size_t>(count));
+		}
+		bool AtEnd() const { return ok && cursor == end; }
+
+	private:
+		const uint8_t*	cursor;
+		const uint8_t*	end;
+	};
+
+	int FontIndex(const ImFontAtlas* atlas, const ImFont* font)
+	{
+		for (int i = 0; i < atlas->Fonts.Size; ++i)
+		{
+			if (atlas->Fonts[i] == font)
+				return i;
+		}
+		return -1;
+	}
+
+	// a font's output state, read completely before any of it goes into the atlas
+	struct CachedFont
+	{
+		float					FontSize, Ascent, Descent, FallbackAdvanceX, EllipsisWidth, EllipsisCharStep;
+		int32_t					MetricsTotalSurface, FallbackGlyph;
+		int16_t					ConfigDataCount, EllipsisCharCount;
+		ImWchar					FallbackChar, EllipsisChar;
+		bool					SDF;
+		ImU8					Used4kPagesMap[sizeof(ImFont::Used4kPagesMap)];
+		ImVector<ImFontGlyph>	Glyphs;
+		ImVector<float>			IndexAdvanceX;
+		ImVector<ImWchar>		IndexLookup;
+	};
+
+	// glyphs rasterized on demand are runtime state, such an atlas is always built
+	bool HasGlyphsOnDemand(const ImFontAtlas* atlas)
+	{
+		for (const ImFontConfig& cfg : atlas->ConfigData)
+		{
+			if (cfg.GlyphRangesOnDemand != nullptr)
+				return true;
+		}
+		return false;
+	}
+}
+
+uint64_t FontAtlasCacheKey(const ImFontAtlas* atlas)
+{
+	KeyHash hash;
+	// what the layout of the file depends on
+	hash.Add(kFontAtlasCacheVersion);
+	hash.Add(static_cast<int32_t>(IMGUI_VERSION_NUM));
+	hash.Add(static_cast<uint32_t>(sizeof(ImWchar)));
+	hash.Add(static_cast<uint32_t>(sizeof(ImFontGlyph)));
+	hash.Add(static_cast<uint32_t>(IM_DRAWLIST_TEX_LINES_WIDTH_MAX));
+
+	hash.Add(atlas->Flags);
+	hash.Add(atlas->TexDesiredWidth);
+	hash.Add(atlas->TexGlyphPadding);
+	hash.Add(atlas->FontBuilderFlags);
+	// a custom builder is not known by more than being set
+	hash.Add(atlas->FontBuilderIO != nullptr);
+	hash.Add(atlas->Fonts.Size);
+	for (const ImFontConfig& cfg : atlas->ConfigData)
+	{
+		hash.Add(cfg.FontDataSize);
+		hash.Add(cfg.FontData, static_cast<size_t>(cfg.FontDataSize));
+		hash.Add(cfg.FontNo);
+		hash.Add(cfg.SizePixels);
+		hash.Add(cfg.OversampleH);
+		hash.Add(cfg.OversampleV);
+		hash.Add(cfg.PixelSnapH);
+		hash.Add(cfg.GlyphExtraSpacing.x);
+		hash.Add(cfg.GlyphExtraSpacing.y);
+		hash.Add(cfg.GlyphOffset.x);
+		hash.Add(cfg.GlyphOffset.y);
+		// no ranges are the default ones, which come with the ImGui version
+		hash.Add(cfg.GlyphRanges != nullptr);
+		for (const ImWchar* range = cfg.GlyphRanges; range != nullptr && range[0] != 0; ++range)
+			hash.Add(range[0]);
+		hash.Add(cfg.GlyphMinAdvanceX);
+		hash.Add(cfg.GlyphMaxAdvanceX);
+		hash.Add(cfg.MergeMode);
+		hash.Add(cfg.FontBuilderFlags);
+		hash.Add(cfg.RasterizerMultiply);
+		hash.Add(cfg.EllipsisChar);
+		hash.Add(cfg.SDF);
+		hash.Add(cfg.SDFPadding);
+		hash.Add(FontIndex(atlas, cfg.DstFont));
+	}
+	hash.Add(atlas->PackIdMouseCursors);
+	hash.Add(atlas->PackIdLines);
+	hash.Add(atlas->CustomRects.Size);
+	for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+	{
+		hash.Add(rect.Width);
+		hash.Add(rect.Height);
+		hash.Add(rect.GlyphID);
+		hash.Add(rect.GlyphAdvanceX);
+		hash.Add(rect.GlyphOffset.x);
+		hash.Add(rect.GlyphOffset.y);
+		hash.Add(FontIndex(atlas, rect.Font));
+	}
+	return hash.Value();
+}
+
+bool LoadFontAtlasCache(ImFontAtlas* atlas, const char* path, uint64_t key)
+{
+	IM_ASSERT(!atlas->Locked && "Cannot modify a locked ImFontAtlas between NewFrame() and EndFrame/Render()!");
+	if (HasGlyphsOnDemand(atlas))
+		return false;
+	MappedFile file(path);
+	if (file.Data() == nullptr)
+		return false;
+
+	Reader reader(file.Data(), file.Size());
+	const uint8_t* magic = reader.Read(sizeof(kFontAtlasCacheMagic));
+	if (magic == nullptr || memcmp(magic, kFontAtlasCacheMagic, sizeof(kFontAtlasCacheMagic)) != 0)
+		return false;
+	if (reader.Read<uint32_t>() != kFontAtlasCacheVersion || reader.Read<uint64_t>() != key)
+		return false;
+	// a file cut short while it was written
+	const uint64_t payloadSize = reader.Read<uint64_t>();
+	if (!reader.ok || payloadSize != file.Size() - sizeof(kFontAtlasCacheMagic) - sizeof(uint32_t) - 2 * sizeof(uint64_t))
+		return false;
+
+	const int32_t texWidth = reader.Read<int32_t>();
+	const int32_t texHeight = reader.Read<int32_t>();
+	const ImVec2 texUvScale = reader.Read<ImVec2>();
+	const ImVec2 texUvWhitePixel = reader.Read<ImVec2>();
+	ImVec4 texUvLines[IM_ARRAYSIZE(atlas->TexUvLines)];
+	for (ImVec4& uv : texUvLines)
+		uv = reader.Read<ImVec4>();
+	const bool texPixelsUseColors = reader.Read<uint8_t>() != 0;
+	const bool hasAlpha8 = reader.Read<uint8_t>() != 0;
+	const bool hasRGBA32 = reader.Read<uint8_t>() != 0;
+	if (!reader.ok || texWidth <= 0 || texHeight <= 0 || texWidth > 0x10000 || texHeight > 0x10000 || (!hasAlpha8 && !hasRGBA32))
+		return false;
+	const size_t texelCount = static_cast<size_t>(texWidth) * static_cast<size_t>(texHeight);
+	const uint8_t* alpha8 = hasAlpha8 ? reader.Read(texelCount) : nullptr;
+	const uint8_t* rgba32 = hasRGBA32 ? reader.Read(texelCount * 4) : nullptr;
+
+	// the file holds the rects of the atlas itself behind the ones the application added
+	const int32_t packIdMouseCursors = reader.Read<int32_t>();
+	const int32_t packIdLines = reader.Read<int32_t>();
+	const uint32_t customRectCount = reader.Read<uint32_t>();
+	if (!reader.ok || customRectCount < static_cast<uint32_t>(atlas->CustomRects.Size) || customRectCount > 0x10000)
+		return false;
+	ImVector<ImFontAtlasCustomRect> customRects;
+	customRects.resize(static_cast<int>(customRectCount));
+	for (ImFontAtlasCustomRect& rect : customRects)
+	{
+		rect.Width = reader.Read<unsigned short>();
+		rect.Height = reader.Read<unsigned short>();
+		rect.X = reader.Read<unsigned short>();
+		rect.Y = reader.Read<unsigned short>();
+		rect.GlyphID = reader.Read<unsigned int>();
+		rect.GlyphAdvanceX = reader.Read<float>();
+		rect.GlyphOffset = reader.Read<ImVec2>();
+		const int32_t fontIndex = reader.Read<int32_t>();
+		if (fontIndex < -1 || fontIndex >= atlas->Fonts.Size)
+			return false;
+		rect.Font = fontIndex >= 0 ? atlas->Fonts[fontIndex] : nullptr;
+	}
+	if (packIdMouseCursors < -1 || packIdMouseCursors >= static_cast<int32_t>(customRectCount) || packIdLines < -1 || packIdLines >= static_cast<int32_t>(customRectCount))
+		return false;
+
+	if (reader.Read<uint32_t>() != static_cast<uint32_t>(atlas->Fonts.Size))
+		return false;
+	std::vector<CachedFont> fonts(static_cast<size_t>(atlas->Fonts.Size));
+	for (CachedFont& font : fonts)
+	{
+		font.FontSize = reader.Read<float>();
+		font.Ascent = reader.Read<float>();
+		font.Descent = reader.Read<float>();
+		font.FallbackAdvanceX = reader.Read<float>();
+		font.EllipsisWidth = reader.Read<float>();
+		font.EllipsisCharStep = reader.Read<float>();
+		font.MetricsTotalSurface = reader.Read<int32_t>();
+		font.FallbackGlyph = reader.Read<int32_t>();
+		font.ConfigDataCount = reader.Read<int16_t>();
+		font.EllipsisCharCount = reader.Read<int16_t>();
+		font.FallbackChar = reader.Read<ImWchar>();
+		font.EllipsisChar = reader.Read<ImWchar>();
+		font.SDF = reader.Read<uint8_t>() != 0;
+		const uint8_t* pages = reader.Read(sizeof(font.Used4kPagesMap));
+		if (pages != nullptr)
+			memcpy(font.Used4kPagesMap, pages, sizeof(font.Used4kPagesMap));
+		reader.ReadVector(font.Glyphs);
+		reader.ReadVector(font.IndexAdvanceX);
+		reader.ReadVector(font.IndexLookup);
+
+		bool valid = reader.ok && font.FallbackGlyph >= -1 && font.FallbackGlyph < font.Glyphs.Size && font.IndexAdvanceX.Size == font.IndexLookup.Size;
+		for (int i = 0; valid && i < font.IndexLookup.Size; ++i)
+			valid = font.IndexLookup[i] == static_cast<ImWchar>(-1) || font.IndexLookup[i] < font.Glyphs.Size;
+		if (!valid)
+			return false;
+	}
+	if (!reader.AtEnd())
+		return false;
+
+	// everything checked out, from here on the atlas is replaced
+	atlas->ClearTexData();
+	atlas->TexID = (ImTextureID)NULL;
+	atlas->TexWidth = texWidth;
+	atlas->TexHeight = texHeight;
+	atlas->TexUvScale = texUvScale;
+	atlas->TexUvWhitePixel = texUvWhitePixel;
+	memcpy(atlas->TexUvLines, texUvLines, sizeof(texUvLines));
+	if (alpha8 != nullptr)
+	{
+		atlas->TexPixelsAlpha8 = static_cast<unsigned char*>(IM_ALLOC(texelCount));
+		memcpy(atlas->TexPixelsAlpha8, alpha8, texelCount);
+	}
+	if (rgba32 != nullptr)
+	{
+		atlas->TexPixelsRGBA32 = static_cast<unsigned int*>(IM_ALLOC(texelCount * 4));
+		memcpy(atlas->TexPixelsRGBA32, rgba32, texelCount * 4);
+	}
+	atlas->TexPixelsUseColors = texPixelsUseColors;
+	atlas->CustomRects.swap(customRects);
+	atlas->PackIdMouseCursors = packIdMouseCursors;
+	atlas->PackIdLines = packIdLines;
+
+	for (int i = 0; i < atlas->Fonts.Size; ++i)
+	{
+		ImFont* font = atlas->Fonts[i];
+		CachedFont& cached = fonts[static_cast<size_t>(i)];
+		font->ClearOutputData();
+		font->ContainerAtlas = atlas;
+		// the config that created the font, as ImFontAtlasBuildSetupFont sets it
+		font->ConfigData = nullptr;
+		for (const ImFontConfig& cfg : atlas->ConfigData)
+		{
+			if (cfg.DstFont == font && !cfg.MergeMode)
+			{
+				font->ConfigData = &cfg;
+				break;
+			}
+		}
+		font->ConfigDataCount = cached.ConfigDataCount;
+		font->FontSize = cached.FontSize;
+		font->Ascent = cached.Ascent;
+		font->Descent = cached.Descent;
+		font->FallbackAdvanceX = cached.FallbackAdvanceX;
+		font->EllipsisWidth = cached.EllipsisWidth;
+		font->EllipsisCharStep = cached.EllipsisCharStep;
+		font->MetricsTotalSurface = cached.MetricsTotalSurface;
+		font->EllipsisCharCount = cached.EllipsisCharCount;
+		font->FallbackChar = cached.FallbackChar;
+		font->EllipsisChar = cached.EllipsisChar;
+		font->SDF = cached.SDF;
+		memcpy(font->Used4kPagesMap, cached.Used4kPagesMap, sizeof(font->Used4kPagesMap));
+		font->Glyphs.swap(cached.Glyphs);
+		font->IndexAdvanceX.swap(cached.IndexAdvanceX);
+		font->IndexLookup.swap(cached.IndexLookup);
+		font->FallbackGlyph = cached.FallbackGlyph >= 0 ? &font->Glyphs[cached.FallbackGlyph] : nullptr;
+		font->DirtyLookupTables = false;
+	}
+	atlas->TexReady = true;
+	return true;
+}
+
+bool SaveFontAtlasCache(const ImFontAtlas* atlas, const char* path, uint64_t key)
+{
+	IM_ASSERT(atlas->TexReady && (atlas->TexPixelsAlpha8 != nullptr || atlas->TexPixelsRGBA32 != nullptr) && "Save a built atlas");
+	if (HasGlyphsOnDemand(atlas))
+		return false;
+
+	Writer payload;
+	payload.Write(static_cast<int32_t>(atlas->TexWidth));
+	payload.Write(static_cast<int32_t>(atlas->TexHeight));
+	payload.Write(atlas->TexUvScale);
+	payload.Write(atlas->TexUvWhitePixel);
+	for (const ImVec4& uv : atlas->TexUvLines)
+		payload.Write(uv);
+	payload.Write(static_cast<uint8_t>(atlas->TexPixelsUseColors));
+	payload.Write(static_cast<uint8_t>(atlas->TexPixelsAlpha8 != nullptr));
+	payload.Write(static_cast<uint8_t>(atlas->TexPixelsRGBA32 != nullptr));
+	const size_t texelCount = static_cast<size_t>(atlas->TexWidth) * static_cast<size_t>(atlas->TexHeight);
+	if (atlas->TexPixelsAlpha8 != nullptr)
+		payload.Write(atlas->TexPixelsAlpha8, texelCount);
+	if (atlas->TexPixelsRGBA32 != nullptr)
+		payload.Write(atlas->TexPixelsRGBA32, texelCount * 4);
+
+	payload.Write(static_cast<int32_t>(atlas->PackIdMouseCursors));
+	payload.Write(static_cast<int32_t>(atlas->PackIdLines));
+	payload.Write(static_cast<uint32_t>(atlas->CustomRects.Size));
+	for (const ImFontAtlasCustomRect& rect : atlas->CustomRects)
+	{
+		payload.Write(rect.Width);
+		payload.Write(rect.Height);
+		payload.Write(rect.X);
+		payload.Write(rect.Y);
+		payload.Write(rect.GlyphID);
+		payload.Write(rect.GlyphAdvanceX);
+		payload.Write(rect.GlyphOffset);
+		payload.Write(static_cast<int32_t>(FontIndex(atlas, rect.Font)));
+	}
+
+	payload.Write(static_cast<uint32_t>(atlas->Fonts.Size));
+	for (const ImFont* font : atlas->Fonts)
+	{
+		payload.Write(font->FontSize);
+		payload.Write(font->Ascent);
+		payload.Write(font->Descent);
+		payload.Write(font->FallbackAdvanceX);
+		payload.Write(font->EllipsisWidth);
+		payload.Write(font->EllipsisCharStep);
+		payload.Write(static_cast<int32_t>(font->MetricsTotalSurface));
+		payload.Write(static_cast<int32_t>(font->FallbackGlyph != nullptr ? font->FallbackGlyph - font->Glyphs.Data : -1));
+		payload.Write(static_cast<int16_t>(font->ConfigDataCount));
+		payload.Write(static_cast<int16_t>(font->EllipsisCharCount));
+		payload.Write(font->FallbackChar);
+		payload.Write(font->EllipsisChar);
+		payload.Write(static_cast<uint8_t>(font->SDF));
+		payload.Write(font->Used4kPagesMap, sizeof(font->Used4kPagesMap));
+		payload.WriteVector(font->Glyphs);
+		payload.WriteVector(font->IndexAdvanceX);
+		payload.WriteVector(font->IndexLookup);
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+	const uint64_t payloadSize = payload.bytes.size();
+	bool written = fwrite(kFontAtlasCacheMagic, sizeof(kFontAtlasCacheMagic), 1, file) == 1;
+	written = written && fwrite(&kFontAtlasCacheVersion, sizeof(kFontAtlasCacheVersion), 1, file) == 1;
+	written = written && fwrite(&key, sizeof(key), 1, file) == 1;
+	written = written && fwrite(&payloadSize, sizeof(payloadSize), 1, file) == 1;
+	written = written && fwrite(payload.bytes.data(), 1, payload.bytes.size(), file) == payload.bytes.size();
+	written = fclose(file) == 0 && written;
+	// a partial file would only be rejected on load, don't leave it around
+	if (!written)
+		remove(path);
+	return written;
+}
+
+bool BuildFontAtlasCached(ImFontAtlas* atlas, const char* path, bool* loadedFromCache)
+{
+	if (loadedFromCache != nullptr)
+		*loadedFromCache = false;
+	if (atlas->ConfigData.Size == 0)
+		atlas->AddFontDefault();
+
+	if (HasGlyphsOnDemand(atlas))
+		return atlas->Build();
+	const uint64_t key = FontAtlasCacheKey(atlas);
+	if (LoadFontAtlasCache(atlas, path, key))
+	{
+		if (loadedFromCache != nullptr)
+			*loadedFromCache = true;
+		return true;
+	}
+	if (!atlas->Build())
+		return false;
+	SaveFontAtlasCache(atlas, path, key);
+	return true;
+}
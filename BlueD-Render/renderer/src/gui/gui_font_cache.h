@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "imgui.h"
+
+// Keeps a built ImFontAtlas in a file so later startups map it and skip rasterizing the glyphs.
+// The file holds the texture, the custom rects and every font's glyphs, lookup tables and metrics, keyed by
+// a hash of what goes into the build: font file contents, sizes, glyph ranges, every ImFontConfig field
+// that changes the output, the atlas flags and padding and the user's custom rects. A file with another
+// key, another version or a different ImGui build is ignored and written again.
+//
+// File layout, all values little endian:
+//   header:  "BDFA", uint32 version, uint64 key, uint64 payload size
+//   payload: atlas texture state and custom rects, then per font its output state and tables
+//
+// Pixels an application draws into its own custom rects after building are only in the file when they were
+// drawn before SaveFontAtlasCache, BuildFontAtlasCached saves right after the build.
+// An atlas with ImFontConfig::GlyphRangesOnDemand fonts rasterizes glyphs while it runs, it is never loaded or saved.
+
+const uint32_t kFontAtlasCacheVersion = 2;
+
+// Hash of everything that goes into building the atlas as it is now, fonts and custom rects added, not built
+uint64_t FontAtlasCacheKey(const ImFontAtlas* atlas);
+// Restores a built atlas from the file when it was saved under the same key. The fonts and custom rects
+// must have been added already, as for Build(). Returns false and leaves the atlas as it was otherwise
+bool LoadFontAtlasCache(ImFontAtlas* atlas, const char* path, uint64_t key);
+// Writes the built atlas, false when the file could not be written
+bool SaveFontAtlasCache(const ImFontAtlas* atlas, const char* path, uint64_t key);
+// Builds the atlas through the cache: loads the file when it matches, builds and writes it otherwise.
+// Adds the default font when none was added, like Build(). Returns false when the build failed
+bool BuildFontAtlasCached(ImFontAtlas* atlas, const char* path, bool* loadedFromCache = nullptr);
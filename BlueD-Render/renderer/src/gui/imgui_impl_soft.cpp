@@ -0,0 +1,945 @@
+#include "imgui_impl_soft.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "soft/soft_jobs.h"
+#include "soft/soft_surface.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMGUI_IMPL_SOFT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// same 24.8 fixed point snapping and fill rule as the scene rasterizer
+	const int32_t kSubPixelBits = 8;
+	const int64_t kSubPixel = 1 << kSubPixelBits;
+	// bands lower than this are not worth a job
+	const int32_t kMinBandHeight = 32;
+
+	inline int64_t ToFixed(float v)
+	{
+		return static_cast<int64_t>(std::floor(v * kSubPixel + 0.5f));
+	}
+
+	inline bool IsTopLeft(int64_t ax, int64_t ay, int64_t bx, int64_t by)
+	{
+		return by < ay || (by == ay && bx > ax);
+	}
+
+	// pixels, max is exclusive
+	struct PixelRect
+	{
+		int32_t minX, minY, maxX, maxY;
+	};
+
+	// the value at the center of pixel (x, y) is base + dx * x + dy * y
+	struct Plane
+	{
+		float base, dx, dy;
+	};
+
+	enum PlaneIndex
+	{
+		PlaneR, PlaneG, PlaneB, PlaneA,	// vertex color in [0, 1]
+		PlaneU, PlaneV,					// texel coordinates
+		PlaneCount
+	};
+
+	struct TriangleShading
+	{
+		Plane				planes[PlaneCount];
+		const SoftSurface*	texture;
+	};
+
+	// source color that is the same for the whole triangle, rgb in [0, 255] and alpha in [0, 1]
+	struct FlatColor
+	{
+		float		r, g, b, a;
+		uint32_t	packed;		// the result when a is 1
+	};
+
+	inline Plane MakePlane(const ImVec2 p[3], float f0, float f1, float f2, float invArea)
+	{
+		const float e1x = p[1].x - p[0].x, e1y = p[1].y - p[0].y;
+		const float e2x = p[2].x - p[0].x, e2y = p[2].y - p[0].y;
+		const float d1 = f1 - f0, d2 = f2 - f0;
+		Plane plane;
+		plane.dx = (d1 * e2y - d2 * e1y) * invArea;
+		plane.dy = (d2 * e1x - d1 * e2x) * invArea;
+		plane.base = f0 - plane.dx * (p[0].x - 0.5f) - plane.dy * (p[0].y - 0.5f);
+		return plane;
+	}
+
+	inline float Clamp(float v, float lo, float hi)
+	{
+		return (std::min)((std::max)(v, lo), hi);
+	}
+
+	// nearest, clamped to the edge. A missing texture samples white
+	inline uint32_t FetchTexel(const SoftSurface* texture, float u, float v)
+	{
+		if (!texture)
+			return 0xffffffffu;
+		const uint32_t x = static_cast<uint32_t>(Clamp(u, 0.0f, static_cast<float>(texture->width - 1)));
+		const uint32_t y = static_cast<uint32_t>(Clamp(v, 0.0f, static_cast<float>(texture->height - 1)));
+		return texture->Row(y)[x];
+	}
+
+	// coverage of a pixel centered at texel coordinates (u, v) of a signed distance field texture (ImFontConfig::SDF),
+	// with the alpha filtered bilinearly like the linear sampler of the dx12 backend
+	inline float SampleSdfCoverage(const SoftSurface* texture, float u, float v, float pixelsPerTexel)
+	{
+		// texel centers are at half coordinates
+		const float x = Clamp(u - 0.5f, 0.0f, static_cast<float>(texture->width - 1));
+		const float y = Clamp(v - 0.5f, 0.0f, static_cast<float>(texture->height - 1));
+		const uint32_t x0 = static_cast<uint32_t>(x), y0 = static_cast<uint32_t>(y);
+		const uint32_t x1 = (std::min)(x0 + 1, texture->width - 1), y1 = (std::min)(y0 + 1, texture->height - 1);
+		const float fx = x - static_cast<float>(x0), fy = y - static_cast<float>(y0);
+		const uint32_t* row0 = texture->Row(y0);
+		const uint32_t* row1 = texture->Row(y1);
+		const float top = static_cast<float>(row0[x0] >> 24) + (static_cast<float>(row0[x1] >> 24) - static_cast<float>(row0[x0] >> 24)) * fx;
+		const float bottom = static_cast<float>(row1[x0] >> 24) + (static_cast<float>(row1[x1] >> 24) - static_cast<float>(row1[x0] >> 24)) * fx;
+		const float distance = (top + (bottom - top) * fy - static_cast<float>(IM_FONT_SDF_ONEDGE_VALUE)) / IM_FONT_SDF_TEXEL_DIST_SCALE;
+		return Clamp(0.5f + distance * pixelsPerTexel, 0.0f, 1.0f);
+	}
+
+	// target pixels per texel of the uv planes, from the area they scale by so that rotated quads work too
+	inline float PixelsPerTexel(const Plane& u, const Plane& v)
+	{
+		const float texelsPerPixel = std::sqrt(std::fabs(u.dx * v.dy - u.dy * v.dx));
+		return texelsPerPixel > 0.0f ? 1.0f / texelsPerPixel : 0.0f;
+	}
+
+	// rgb uses SrcAlpha / InvSrcAlpha, alpha One / InvSrcAlpha, like the dx12 backend. The vector paths
+	// below do the same operations in the same order, so every path gives the same bits
+	inline uint32_t BlendScalar(uint32_t dst, float sr, float sg, float sb, float sa)
+	{
+		const float inv = 1.0f - sa;
+		const float r = sr * sa + static_cast<float>(dst & 0xff) * inv;
+		const float g = sg * sa + static_cast<float>((dst >> 8) & 0xff) * inv;
+		const float b = sb * sa + static_cast<float>((dst >> 16) & 0xff) * inv;
+		const float a = sa * 255.0f + static_cast<float>(dst >> 24) * inv;
+		return static_cast<uint32_t>(std::nearbyint(r)) | (static_cast<uint32_t>(std::nearbyint(g)) << 8) |
+			(static_cast<uint32_t>(std::nearbyint(b)) << 16) | (static_cast<uint32_t>(std::nearbyint(a)) << 24);
+	}
+
+	// vertex color times texel, false when the result is fully transparent and there is nothing to draw
+	inline bool MakeFlatColor(uint32_t c, uint32_t t, FlatColor& color)
+	{
+		const float s = 1.0f / 255.0f;
+		color.r = static_cast<float>(c & 0xff) * s * static_cast<float>(t & 0xff);
+		color.g = static_cast<float>((c >> 8) & 0xff) * s * static_cast<float>((t >> 8) & 0xff);
+		color.b = static_cast<float>((c >> 16) & 0xff) * s * static_cast<float>((t >> 16) & 0xff);
+		color.a = static_cast<float>(c >> 24) * s * static_cast<float>(t >> 24) * s;
+		color.packed = BlendScalar(0, color.r, color.g, color.b, color.a);
+		return color.a > 0.0f;
+	}
+
+#ifdef IMGUI_IMPL_SOFT_SSE2
+	// four R8G8B8A8 pixels as float channels
+	struct Pixels4
+	{
+		__m128 r, g, b, a;
+	};
+
+	inline Pixels4 Unpack4(__m128i texels)
+	{
+		const __m128i mask = _mm_set1_epi32(0xff);
+		Pixels4 p;
+		p.r = _mm_cvtepi32_ps(_mm_and_si128(texels, mask));
+		p.g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8), mask));
+		p.b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 16), mask));
+		p.a = _mm_cvtepi32_ps(_mm_srli_epi32(texels, 24));
+		return p;
+	}
+
+	inline __m128i Blend4(__m128i dst, __m128 sr, __m128 sg, __m128 sb, __m128 sa)
+	{
+		const Pixels4 d = Unpack4(dst);
+		const __m128 inv = _mm_sub_ps(_mm_set1_ps(1.0f), sa);
+		const __m128i r = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(sr, sa), _mm_mul_ps(d.r, inv)));
+		const __m128i g = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(sg, sa), _mm_mul_ps(d.g, inv)));
+		const __m128i b = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(sb, sa), _mm_mul_ps(d.b, inv)));
+		const __m128i a = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(sa, _mm_set1_ps(255.0f)), _mm_mul_ps(d.a, inv)));
+		return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+	}
+
+	// the last pixels of a span go through a small buffer, so the loop always works on four
+	template <typename Shade>
+	inline void ForEachPixels4(uint32_t* row, int32_t x0, int32_t x1, const Shade& shade)
+	{
+		int32_t x = x0;
+		for (; x + 4 <= x1; x += 4)
+		{
+			__m128i* dst = reinterpret_cast<__m128i*>(row + x);
+			_mm_storeu_si128(dst, shade(x, _mm_loadu_si128(dst)));
+		}
+		if (x < x1)
+		{
+			alignas(16) uint32_t tail[4] = {};
+			const size_t bytes = static_cast<size_t>(x1 - x) * sizeof(uint32_t);
+			memcpy(tail, row + x, bytes);
+			_mm_store_si128(reinterpret_cast<__m128i*>(tail), shade(x, _mm_load_si128(reinterpret_cast<const __m128i*>(tail))));
+			memcpy(row + x, tail, bytes);
+		}
+	}
+#endif
+
+	// blends the constant source over pixels [x0, x1) of the row
+	void FillSpan(uint32_t* row, int32_t x0, int32_t x1, const FlatColor& color)
+	{
+		if (color.a >= 1.0f)
+		{
+			std::fill(row + x0, row + x1, color.packed);
+			return;
+		}
+#ifdef IMGUI_IMPL_SOFT_SSE2
+		const __m128 sr = _mm_set1_ps(color.r), sg = _mm_set1_ps(color.g), sb = _mm_set1_ps(color.b), sa = _mm_set1_ps(color.a);
+		ForEachPixels4(row, x0, x1, [&](int32_t, __m128i dst) { return Blend4(dst, sr, sg, sb, sa); });
+#else
+		for (int32_t x = x0; x < x1; ++x)
+			row[x] = BlendScalar(row[x], color.r, color.g, color.b, color.a);
+#endif
+	}
+
+	// interpolates color and uv over pixels [x0, x1) of row y and blends the textured result
+	void ShadeSpan(uint32_t* row, int32_t x0, int32_t x1, int32_t y, const TriangleShading& shading)
+	{
+		float rowBase[PlaneCount];
+		for (uint32_t i = 0; i < PlaneCount; ++i)
+			rowBase[i] = shading.planes[i].base + shading.planes[i].dy * static_cast<float>(y);
+		const SoftSurface* texture = shading.texture;
+
+#ifdef IMGUI_IMPL_SOFT_SSE2
+		__m128 base[PlaneCount], step[PlaneCount];
+		for (uint32_t i = 0; i < PlaneCount; ++i)
+		{
+			base[i] = _mm_set1_ps(rowBase[i]);
+			step[i] = _mm_set1_ps(shading.planes[i].dx);
+		}
+		const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		const __m128 maxU = _mm_set1_ps(texture ? static_cast<float>(texture->width - 1) : 0.0f);
+		const __m128 maxV = _mm_set1_ps(texture ? static_cast<float>(texture->height - 1) : 0.0f);
+		const __m128 white = _mm_set1_ps(255.0f), inv255 = _mm_set1_ps(1.0f / 255.0f);
+
+		ForEachPixels4(row, x0, x1, [&](int32_t x, __m128i dst)
+		{
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+			auto eval = [&](uint32_t i) { return _mm_add_ps(base[i], _mm_mul_ps(step[i], px)); };
+			// pixel centers just outside the triangle extrapolate, keep them in range
+			const __m128 r = _mm_min_ps(_mm_max_ps(eval(PlaneR), zero), one);
+			const __m128 g = _mm_min_ps(_mm_max_ps(eval(PlaneG), zero), one);
+			const __m128 b = _mm_min_ps(_mm_max_ps(eval(PlaneB), zero), one);
+			const __m128 a = _mm_min_ps(_mm_max_ps(eval(PlaneA), zero), one);
+
+			Pixels4 t = { white, white, white, white };
+			if (texture)
+			{
+				alignas(16) int32_t u[4], v[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(u), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(eval(PlaneU), zero), maxU)));
+				_mm_store_si128(reinterpret_cast<__m128i*>(v), _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(eval(PlaneV), zero), maxV)));
+				t = Unpack4(_mm_set_epi32(static_cast<int32_t>(texture->Row(v[3])[u[3]]), static_cast<int32_t>(texture->Row(v[2])[u[2]]),
+					static_cast<int32_t>(texture->Row(v[1])[u[1]]), static_cast<int32_t>(texture->Row(v[0])[u[0]])));
+			}
+			return Blend4(dst, _mm_mul_ps(r, t.r), _mm_mul_ps(g, t.g), _mm_mul_ps(b, t.b), _mm_mul_ps(_mm_mul_ps(a, t.a), inv255));
+		});
+#else
+		for (int32_t x = x0; x < x1; ++x)
+		{
+			const float px = static_cast<float>(x);
+			auto eval = [&](uint32_t i) { return rowBase[i] + shading.planes[i].dx * px; };
+			const uint32_t t = FetchTexel(texture, eval(PlaneU), eval(PlaneV));
+			const float sr = Clamp(eval(PlaneR), 0.0f, 1.0f) * static_cast<float>(t & 0xff);
+			const float sg = Clamp(eval(PlaneG), 0.0f, 1.0f) * static_cast<float>((t >> 8) & 0xff);
+			const float sb = Clamp(eval(PlaneB), 0.0f, 1.0f) * static_cast<float>((t >> 16) & 0xff);
+			const float sa = Clamp(eval(PlaneA), 0.0f, 1.0f) * static_cast<float>(t >> 24) * (1.0f / 255.0f);
+			row[x] = BlendScalar(row[x], sr, sg, sb, sa);
+		}
+#endif
+	}
+
+	// distance field text: the interpolated vertex color with its alpha scaled by the coverage at each pixel.
+	// The glyphs of the atlas are white, so their texel color is left out. Scalar only, text is a small part of a frame
+	void ShadeSdfSpan(uint32_t* row, int32_t x0, int32_t x1, int32_t y, const TriangleShading& shading, float pixelsPerTexel)
+	{
+		float rowBase[PlaneCount];
+		for (uint32_t i = 0; i < PlaneCount; ++i)
+			rowBase[i] = shading.planes[i].base + shading.planes[i].dy * static_cast<float>(y);
+		for (int32_t x = x0; x < x1; ++x)
+		{
+			const float px = static_cast<float>(x);
+			auto eval = [&](uint32_t i) { return rowBase[i] + shading.planes[i].dx * px; };
+			const float coverage = SampleSdfCoverage(shading.texture, eval(PlaneU), eval(PlaneV), pixelsPerTexel);
+			if (coverage <= 0.0f)
+				continue;
+			row[x] = BlendScalar(row[x], Clamp(eval(PlaneR), 0.0f, 1.0f) * 255.0f, Clamp(eval(PlaneG), 0.0f, 1.0f) * 255.0f,
+				Clamp(eval(PlaneB), 0.0f, 1.0f) * 255.0f, Clamp(eval(PlaneA), 0.0f, 1.0f) * coverage);
+		}
+	}
+
+	// blends a constant vertex color times texels of one texture row over pixels [x0, x1), pixel x samples
+	// texRow[columns[x - x0]]. columns has three more entries, the last four pixels may read them
+	void BlitSpan(uint32_t* row, int32_t x0, int32_t x1, const uint32_t* texRow, const uint32_t* columns, const float color[4])
+	{
+#ifdef IMGUI_IMPL_SOFT_SSE2
+		const __m128 r = _mm_set1_ps(color[0]), g = _mm_set1_ps(color[1]), b = _mm_set1_ps(color[2]), a = _mm_set1_ps(color[3]);
+		const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+		ForEachPixels4(row, x0, x1, [&](int32_t x, __m128i dst)
+		{
+			const uint32_t* c = columns + (x - x0);
+			const Pixels4 t = Unpack4(_mm_set_epi32(static_cast<int32_t>(texRow[c[3]]), static_cast<int32_t>(texRow[c[2]]),
+				static_cast<int32_t>(texRow[c[1]]), static_cast<int32_t>(texRow[c[0]])));
+			return Blend4(dst, _mm_mul_ps(r, t.r), _mm_mul_ps(g, t.g), _mm_mul_ps(b, t.b), _mm_mul_ps(_mm_mul_ps(a, t.a), inv255));
+		});
+#else
+		for (int32_t x = x0; x < x1; ++x)
+		{
+			const uint32_t t = texRow[columns[x - x0]];
+			row[x] = BlendScalar(row[x], color[0] * static_cast<float>(t & 0xff), color[1] * static_cast<float>((t >> 8) & 0xff),
+				color[2] * static_cast<float>((t >> 16) & 0xff), color[3] * static_cast<float>(t >> 24) * (1.0f / 255.0f));
+		}
+#endif
+	}
+
+	// narrows [start, end) to the pixels of the row that are inside the edge, pixel minX + k is inside
+	// when w + stepX * k >= 0
+	inline void NarrowSpan(int64_t w, int64_t stepX, int32_t minX, int32_t& start, int32_t& end)
+	{
+		if (stepX > 0)
+		{
+			if (w < 0)
+				start = static_cast<int32_t>((std::max)(static_cast<int64_t>(start), minX + (-w + stepX - 1) / stepX));
+		}
+		else if (w < 0)
+			end = start;
+		else if (stepX < 0)
+			end = static_cast<int32_t>((std::min)(static_cast<int64_t>(end), minX + w / -stepX + 1));
+	}
+
+	void DrawTriangle(SoftSurface& target, const PixelRect& clip, const ImDrawVert* v[3], const ImVec2& offset, const ImVec2& scale,
+		const SoftSurface* texture, bool fontTexture)
+	{
+		ImVec2 p[3];
+		int64_t x[3], y[3];
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			p[i] = ImVec2((v[i]->pos.x - offset.x) * scale.x, (v[i]->pos.y - offset.y) * scale.y);
+			x[i] = ToFixed(p[i].x);
+			y[i] = ToFixed(p[i].y);
+		}
+
+		// ImGui emits both windings, both are drawn
+		int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		if (area == 0)
+			return;
+		if (area < 0)
+		{
+			std::swap(v[1], v[2]);
+			std::swap(p[1], p[2]);
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+		}
+
+		const int32_t minX = (std::max)(static_cast<int32_t>((std::min)({ x[0], x[1], x[2] }) >> kSubPixelBits), clip.minX);
+		const int32_t minY = (std::max)(static_cast<int32_t>((std::min)({ y[0], y[1], y[2] }) >> kSubPixelBits), clip.minY);
+		const int32_t maxX = (std::min)(static_cast<int32_t>((std::max)({ x[0], x[1], x[2] }) >> kSubPixelBits), clip.maxX - 1);
+		const int32_t maxY = (std::min)(static_cast<int32_t>((std::max)({ y[0], y[1], y[2] }) >> kSubPixelBits), clip.maxY - 1);
+		if (minX > maxX || minY > maxY)
+			return;
+
+		// a triangle with one color and one texel is blended as a constant, which is most solid fills
+		// since they all sample the atlas' white pixel
+		const float texW = texture ? static_cast<float>(texture->width) : 0.0f;
+		const float texH = texture ? static_cast<float>(texture->height) : 0.0f;
+		// glyphs of distance field fonts are shifted by IM_FONT_SDF_UV_OFFSET in the font texture
+		const bool sdf = fontTexture && v[0]->uv.x >= IM_FONT_SDF_UV_OFFSET;
+		const float uBase = sdf ? IM_FONT_SDF_UV_OFFSET : 0.0f;
+		const bool flat = !sdf && v[0]->col == v[1]->col && v[0]->col == v[2]->col &&
+			v[0]->uv.x == v[1]->uv.x && v[0]->uv.x == v[2]->uv.x && v[0]->uv.y == v[1]->uv.y && v[0]->uv.y == v[2]->uv.y;
+		FlatColor flatColor = {};
+		TriangleShading shading = {};
+		if (flat)
+		{
+			if (!MakeFlatColor(v[0]->col, FetchTexel(texture, v[0]->uv.x * texW, v[0]->uv.y * texH), flatColor))
+				return;
+		}
+		else
+		{
+			const float invArea = 1.0f / ((p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x));
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				const uint32_t shift = i * 8;
+				const float s = 1.0f / 255.0f;
+				shading.planes[PlaneR + i] = MakePlane(p, static_cast<float>((v[0]->col >> shift) & 0xff) * s,
+					static_cast<float>((v[1]->col >> shift) & 0xff) * s, static_cast<float>((v[2]->col >> shift) & 0xff) * s, invArea);
+			}
+			shading.planes[PlaneU] = MakePlane(p, (v[0]->uv.x - uBase) * texW, (v[1]->uv.x - uBase) * texW, (v[2]->uv.x - uBase) * texW, invArea);
+			shading.planes[PlaneV] = MakePlane(p, v[0]->uv.y * texH, v[1]->uv.y * texH, v[2]->uv.y * texH, invArea);
+			shading.texture = texture;
+		}
+		const float pixelsPerTexel = sdf ? PixelsPerTexel(shading.planes[PlaneU], shading.planes[PlaneV]) : 0.0f;
+
+		// edge functions at the first pixel center of the box, stepped per row
+		const int64_t px = (static_cast<int64_t>(minX) << kSubPixelBits) + kSubPixel / 2;
+		const int64_t py = (static_cast<int64_t>(minY) << kSubPixelBits) + kSubPixel / 2;
+		int64_t row0 = (x[2] - x[1]) * (py - y[1]) - (y[2] - y[1]) * (px - x[1]) + (IsTopLeft(x[1], y[1], x[2], y[2]) ? 0 : -1);
+		int64_t row1 = (x[0] - x[2]) * (py - y[2]) - (y[0] - y[2]) * (px - x[2]) + (IsTopLeft(x[2], y[2], x[0], y[0]) ? 0 : -1);
+		int64_t row2 = (x[1] - x[0]) * (py - y[0]) - (y[1] - y[0]) * (px - x[0]) + (IsTopLeft(x[0], y[0], x[1], y[1]) ? 0 : -1);
+		const int64_t stepX0 = (y[1] - y[2]) * kSubPixel, stepY0 = (x[2] - x[1]) * kSubPixel;
+		const int64_t stepX1 = (y[2] - y[0]) * kSubPixel, stepY1 = (x[0] - x[2]) * kSubPixel;
+		const int64_t stepX2 = (y[0] - y[1]) * kSubPixel, stepY2 = (x[1] - x[0]) * kSubPixel;
+
+		for (int32_t rowY = minY; rowY <= maxY; ++rowY, row0 += stepY0, row1 += stepY1, row2 += stepY2)
+		{
+			int32_t start = minX, end = maxX + 1;
+			NarrowSpan(row0, stepX0, minX, start, end);
+			NarrowSpan(row1, stepX1, minX, start, end);
+			NarrowSpan(row2, stepX2, minX, start, end);
+			if (start >= end)
+				continue;
+			uint32_t* row = target.Row(static_cast<uint32_t>(rowY));
+			if (flat)
+				FillSpan(row, start, end, flatColor);
+			else if (sdf)
+				ShadeSdfSpan(row, start, end, rowY, shading, pixelsPerTexel);
+			else
+				ShadeSpan(row, start, end, rowY, shading);
+		}
+	}
+
+	// ImDrawList::PrimRect and PrimRectUV emit a, b, c, a, c, d with a at the top left and c at the bottom right.
+	// When the six indices are such a pair, with one color and a uv that follows x and y separately, a and c
+	// are returned and the pair can be drawn with span fills instead of edge functions
+	inline bool FindQuad(const ImDrawIdx* idx, const ImDrawVert* vertices, const ImDrawVert*& a, const ImDrawVert*& c)
+	{
+		if (idx[3] != idx[0] || idx[4] != idx[2])
+			return false;
+		const ImDrawVert& va = vertices[idx[0]];
+		const ImDrawVert& vb = vertices[idx[1]];
+		const ImDrawVert& vc = vertices[idx[2]];
+		const ImDrawVert& vd = vertices[idx[5]];
+		if (va.pos.y != vb.pos.y || vb.pos.x != vc.pos.x || vc.pos.y != vd.pos.y || vd.pos.x != va.pos.x)
+			return false;
+		if (va.col != vb.col || va.col != vc.col || va.col != vd.col)
+			return false;
+		if (va.uv.y != vb.uv.y || vb.uv.x != vc.uv.x || vc.uv.y != vd.uv.y || vd.uv.x != va.uv.x)
+			return false;
+		a = &va;
+		c = &vc;
+		return true;
+	}
+
+	// covers the same pixels as the two triangles, the ones with their center in the rect with the left and
+	// top edges included. Solid quads are filled, textured ones sample a column table built once per quad
+	void DrawQuad(SoftSurface& target, const PixelRect& clip, const ImDrawVert& a, const ImDrawVert& c, const ImVec2& offset,
+		const ImVec2& scale, const SoftSurface* texture, bool fontTexture, std::vector<uint32_t>& columns)
+	{
+		const ImVec2 p0((a.pos.x - offset.x) * scale.x, (a.pos.y - offset.y) * scale.y);
+		const ImVec2 p1((c.pos.x - offset.x) * scale.x, (c.pos.y - offset.y) * scale.y);
+		const int64_t x0 = ToFixed(p0.x), x1 = ToFixed(p1.x);
+		const int64_t y0 = ToFixed(p0.y), y1 = ToFixed(p1.y);
+
+		// first pixel with its center at or after the edge
+		auto firstPixel = [](int64_t edge) { return static_cast<int32_t>(-((kSubPixel / 2 - edge) >> kSubPixelBits)); };
+		const int32_t minX = (std::max)(firstPixel((std::min)(x0, x1)), clip.minX);
+		const int32_t maxX = (std::min)(firstPixel((std::max)(x0, x1)), clip.maxX);
+		const int32_t minY = (std::max)(firstPixel((std::min)(y0, y1)), clip.minY);
+		const int32_t maxY = (std::min)(firstPixel((std::max)(y0, y1)), clip.maxY);
+		if (minX >= maxX || minY >= maxY)
+			return;
+
+		const float texW = texture ? static_cast<float>(texture->width) : 0.0f;
+		const float texH = texture ? static_cast<float>(texture->height) : 0.0f;
+		if (!texture || (a.uv.x == c.uv.x && a.uv.y == c.uv.y))
+		{
+			FlatColor flatColor;
+			if (!MakeFlatColor(a.col, FetchTexel(texture, a.uv.x * texW, a.uv.y * texH), flatColor))
+				return;
+			for (int32_t y = minY; y < maxY; ++y)
+				FillSpan(target.Row(static_cast<uint32_t>(y)), minX, maxX, flatColor);
+			return;
+		}
+
+		const float s = 1.0f / 255.0f;
+		const float color[4] = { static_cast<float>(a.col & 0xff) * s, static_cast<float>((a.col >> 8) & 0xff) * s,
+			static_cast<float>((a.col >> 16) & 0xff) * s, static_cast<float>(a.col >> 24) * s };
+		if (color[3] <= 0.0f)
+			return;
+
+		if (fontTexture && a.uv.x >= IM_FONT_SDF_UV_OFFSET)
+		{
+			// the planes of the first triangle, a b c, as DrawTriangle sets them up
+			const ImVec2 p[3] = { p0, ImVec2(p1.x, p0.y), p1 };
+			const float invArea = 1.0f / ((p1.x - p0.x) * (p1.y - p0.y));
+			TriangleShading shading = {};
+			for (uint32_t i = 0; i < 4; ++i)
+				shading.planes[PlaneR + i] = MakePlane(p, color[i], color[i], color[i], invArea);
+			const float u0 = (a.uv.x - IM_FONT_SDF_UV_OFFSET) * texW, u1 = (c.uv.x - IM_FONT_SDF_UV_OFFSET) * texW;
+			shading.planes[PlaneU] = MakePlane(p, u0, u1, u1, invArea);
+			shading.planes[PlaneV] = MakePlane(p, a.uv.y * texH, a.uv.y * texH, c.uv.y * texH, invArea);
+			shading.texture = texture;
+			const float pixelsPerTexel = PixelsPerTexel(shading.planes[PlaneU], shading.planes[PlaneV]);
+			for (int32_t y = minY; y < maxY; ++y)
+				ShadeSdfSpan(target.Row(static_cast<uint32_t>(y)), minX, maxX, y, shading, pixelsPerTexel);
+			return;
+		}
+
+		// texel coordinates are linear in x and y, taken at pixel centers like the triangle planes
+		const float du = (c.uv.x - a.uv.x) * texW / (p1.x - p0.x);
+		const float dv = (c.uv.y - a.uv.y) * texH / (p1.y - p0.y);
+		const size_t width = static_cast<size_t>(maxX - minX);
+		columns.resize(width + 3);
+		for (size_t i = 0; i < width; ++i)
+		{
+			const float u = a.uv.x * texW + (static_cast<float>(minX + static_cast<int32_t>(i)) + 0.5f - p0.x) * du;
+			columns[i] = static_cast<uint32_t>(Clamp(u, 0.0f, texW - 1.0f));
+		}
+		columns[width] = columns[width + 1] = columns[width + 2] = columns[width - 1];
+
+		for (int32_t y = minY; y < maxY; ++y)
+		{
+			const float v = a.uv.y * texH + (static_cast<float>(y) + 0.5f - p0.y) * dv;
+			const uint32_t* texRow = texture->Row(static_cast<uint32_t>(Clamp(v, 0.0f, texH - 1.0f)));
+			BlitSpan(target.Row(static_cast<uint32_t>(y)), minX, maxX, texRow, columns.data(), color);
+		}
+	}
+
+	// draws every command into rows [band.minY, band.maxY) of the target. With stats every primitive
+	// is counted, including the ones outside the band
+	void DrawBand(ImDrawData* drawData, SoftSurface& target, const PixelRect& band, bool quadFastPath, ImGui_ImplSoft_Stats* stats)
+	{
+		std::vector<uint32_t> columns;
+		// the font texture may hold distance field glyphs, marked per vertex
+		const ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+		const ImTextureID sdfTexture = atlas->TexSdfSupported ? atlas->TexID : nullptr;
+		const ImVec2 clipOffset = drawData->DisplayPos;
+		const ImVec2 clipScale = drawData->FramebufferScale;
+		for (int n = 0; n < drawData->CmdListsCount; ++n)
+		{
+			const ImDrawList* cmdList = drawData->CmdLists[n];
+			for (int c = 0; c < cmdList->CmdBuffer.Size; ++c)
+			{
+				const ImDrawCmd* cmd = &cmdList->CmdBuffer[c];
+				if (cmd->UserCallback != nullptr)
+				{
+					// there is no render state to reset
+					if (cmd->UserCallback != ImDrawCallback_ResetRenderState)
+						cmd->UserCallback(cmdList, cmd);
+					continue;
+				}
+
+				// same rounding as the scissor rect of the dx12 backend
+				const ImVec2 clipMin((cmd->ClipRect.x - clipOffset.x) * clipScale.x, (cmd->ClipRect.y - clipOffset.y) * clipScale.y);
+				const ImVec2 clipMax((cmd->ClipRect.z - clipOffset.x) * clipScale.x, (cmd->ClipRect.w - clipOffset.y) * clipScale.y);
+				if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y)
+					continue;
+				PixelRect clip;
+				clip.minX = (std::max)(static_cast<int32_t>(clipMin.x), band.minX);
+				clip.minY = (std::max)(static_cast<int32_t>(clipMin.y), band.minY);
+				clip.maxX = (std::min)(static_cast<int32_t>(clipMax.x), band.maxX);
+				clip.maxY = (std::min)(static_cast<int32_t>(clipMax.y), band.maxY);
+				const bool visible = clip.minX < clip.maxX && clip.minY < clip.maxY;
+				if (!visible && !stats)
+					continue;
+
+				const SoftSurface* texture = static_cast<const SoftSurface*>(cmd->GetTexID());
+				const bool fontTexture = sdfTexture != nullptr && cmd->GetTexID() == sdfTexture;
+				const ImDrawIdx* indices = cmdList->IdxBuffer.Data + cmd->IdxOffset;
+				const ImDrawVert* vertices = cmdList->VtxBuffer.Data + cmd->VtxOffset;
+				for (unsigned int i = 0; i + 2 < cmd->ElemCount;)
+				{
+					const ImDrawVert* a;
+					const ImDrawVert* c;
+					if (quadFastPath && i + 5 < cmd->ElemCount && FindQuad(indices + i, vertices, a, c))
+					{
+						if (visible)
+							DrawQuad(target, clip, *a, *c, clipOffset, clipScale, texture, fontTexture, columns);
+						if (stats)
+							stats->Quads++;
+						i += 6;
+						continue;
+					}
+
+					if (visible)
+					{
+						const ImDrawVert* v[3] = { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] };
+						DrawTriangle(target, clip, v, clipOffset, clipScale, texture, fontTexture);
+					}
+					if (stats)
+						stats->Triangles++;
+					i += 3;
+				}
+			}
+		}
+	}
+
+	// user callbacks expect to run once and in order, frames with them are not split into bands
+	bool HasUserCallbacks(const ImDrawData* drawData)
+	{
+		for (int n = 0; n < drawData->CmdListsCount; ++n)
+		{
+			for (const ImDrawCmd& cmd : drawData->CmdLists[n]->CmdBuffer)
+			{
+				if (cmd.UserCallback != nullptr && cmd.UserCallback != ImDrawCallback_ResetRenderState)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// draws into rect of the target, split into bands over the pool when there is one. Every band owns
+	// its rows, so the result does not depend on the scheduling
+	void DrawRect(ImDrawData* drawData, SoftSurface& target, const PixelRect& rect, SoftThreadPool* pool, bool quadFastPath,
+		ImGui_ImplSoft_Stats* stats)
+	{
+		const int32_t height = rect.maxY - rect.minY;
+		uint32_t bandCount = 1;
+		if (pool)
+			bandCount = (std::max)(1u, (std::min)(pool->ThreadCount() + 1, static_cast<uint32_t>(height / kMinBandHeight)));
+		if (bandCount == 1)
+		{
+			DrawBand(drawData, target, rect, quadFastPath, stats);
+			return;
+		}
+
+		pool->ParallelFor(bandCount, [&](uint32_t band)
+		{
+			const int32_t minY = rect.minY + static_cast<int32_t>(static_cast<int64_t>(height) * band / bandCount);
+			const int32_t maxY = rect.minY + static_cast<int32_t>(static_cast<int64_t>(height) * (band + 1) / bandCount);
+			DrawBand(drawData, target, { rect.minX, minY, rect.maxX, maxY }, quadFastPath, band == 0 ? stats : nullptr);
+		});
+	}
+
+	// 64 bit FNV-1a over words, the tail byte by byte
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+	{
+		const uint64_t prime = 1099511628211ull;
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ word) * prime;
+		}
+		for (; i < size; ++i)
+			hash = (hash ^ bytes[i]) * prime;
+		return hash;
+	}
+
+	inline uint64_t HashValue(uint64_t value, uint64_t hash)
+	{
+		return (hash ^ value) * 1099511628211ull;
+	}
+
+	// what a draw list drew in the last frame: everything it emits hashed, and the pixels it can touch
+	struct ListState
+	{
+		const ImDrawList*	List;
+		uint64_t			Hash;
+		PixelRect			Rect;
+	};
+
+	ListState DescribeList(const ImDrawList* list, const ImVec2& offset, const ImVec2& scale, const PixelRect& target)
+	{
+		ListState state;
+		state.List = list;
+		uint64_t hash = HashBytes(list->VtxBuffer.Data, static_cast<size_t>(list->VtxBuffer.Size) * sizeof(ImDrawVert), 14695981039346656037ull);
+		hash = HashBytes(list->IdxBuffer.Data, static_cast<size_t>(list->IdxBuffer.Size) * sizeof(ImDrawIdx), hash);
+
+		// the union of the clip rects, with the same rounding as DrawBand
+		PixelRect clip = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+		for (const ImDrawCmd& cmd : list->CmdBuffer)
+		{
+			hash = HashBytes(&cmd.ClipRect, sizeof(cmd.ClipRect), hash);
+			hash = HashValue(reinterpret_cast<uintptr_t>(cmd.TextureId), hash);
+			hash = HashValue(cmd.VtxOffset, hash);
+			hash = HashValue(cmd.IdxOffset, hash);
+			hash = HashValue(cmd.ElemCount, hash);
+			hash = HashValue(reinterpret_cast<uintptr_t>(cmd.UserCallback), hash);
+			hash = HashValue(reinterpret_cast<uintptr_t>(cmd.UserCallbackData), hash);
+			if (cmd.UserCallback != nullptr || cmd.ElemCount == 0)
+				continue;
+			clip.minX = (std::min)(clip.minX, static_cast<int32_t>((cmd.ClipRect.x - offset.x) * scale.x));
+			clip.minY = (std::min)(clip.minY, static_cast<int32_t>((cmd.ClipRect.y - offset.y) * scale.y));
+			clip.maxX = (std::max)(clip.maxX, static_cast<int32_t>((cmd.ClipRect.z - offset.x) * scale.x));
+			clip.maxY = (std::max)(clip.maxY, static_cast<int32_t>((cmd.ClipRect.w - offset.y) * scale.y));
+		}
+		state.Hash = hash;
+
+		// pixels are covered when their center is inside a triangle, so the vertex bounds rounded out hold them all
+		ImVec2 minPos(FLT_MAX, FLT_MAX), maxPos(-FLT_MAX, -FLT_MAX);
+		for (const ImDrawVert& v : list->VtxBuffer)
+		{
+			minPos = ImVec2((std::min)(minPos.x, v.pos.x), (std::min)(minPos.y, v.pos.y));
+			maxPos = ImVec2((std::max)(maxPos.x, v.pos.x), (std::max)(maxPos.y, v.pos.y));
+		}
+		state.Rect = { target.minX, target.minY, target.minX, target.minY };
+		if (minPos.x > maxPos.x || clip.minX >= clip.maxX)
+			return state;
+		state.Rect.minX = (std::max)({ clip.minX, static_cast<int32_t>(std::floor((minPos.x - offset.x) * scale.x)), target.minX });
+		state.Rect.minY = (std::max)({ clip.minY, static_cast<int32_t>(std::floor((minPos.y - offset.y) * scale.y)), target.minY });
+		state.Rect.maxX = (std::min)({ clip.maxX, static_cast<int32_t>(std::ceil((maxPos.x - offset.x) * scale.x)) + 1, target.maxX });
+		state.Rect.maxY = (std::min)({ clip.maxY, static_cast<int32_t>(std::ceil((maxPos.y - offset.y) * scale.y)) + 1, target.maxY });
+		if (state.Rect.minX >= state.Rect.maxX || state.Rect.minY >= state.Rect.maxY)
+			state.Rect = { target.minX, target.minY, target.minX, target.minY };
+		return state;
+	}
+
+	inline bool Overlaps(const PixelRect& a, const PixelRect& b)
+	{
+		return a.minX < b.maxX && b.minX < a.maxX && a.minY < b.maxY && b.minY < a.maxY;
+	}
+
+	// adds rect to the union, overlapping rects are merged so no pixel is drawn twice. Past a few rects they
+	// all collapse into their bounds, the merging would cost more than the pixels it saves
+	void AddDirtyRect(std::vector<PixelRect>& rects, PixelRect rect)
+	{
+		const size_t kMaxDirtyRects = 16;
+		if (rect.minX >= rect.maxX || rect.minY >= rect.maxY)
+			return;
+		for (size_t i = 0; i < rects.size();)
+		{
+			if (!Overlaps(rects[i], rect))
+			{
+				++i;
+				continue;
+			}
+			rect = { (std::min)(rect.minX, rects[i].minX), (std::min)(rect.minY, rects[i].minY),
+				(std::max)(rect.maxX, rects[i].maxX), (std::max)(rect.maxY, rects[i].maxY) };
+			rects.erase(rects.begin() + static_cast<ptrdiff_t>(i));
+			i = 0;
+		}
+		rects.push_back(rect);
+		if (rects.size() > kMaxDirtyRects)
+		{
+			PixelRect bounds = rects[0];
+			for (const PixelRect& r : rects)
+				bounds = { (std::min)(bounds.minX, r.minX), (std::min)(bounds.minY, r.minY), (std::max)(bounds.maxX, r.maxX), (std::max)(bounds.maxY, r.maxY) };
+			rects.assign(1, bounds);
+		}
+	}
+}
+
+struct ImGui_ImplSoft_Data
+{
+	SoftSurface				FontTexture;
+	SoftThreadPool*			Pool = nullptr;
+	bool					QuadFastPath = true;
+	ImGui_ImplSoft_Stats	Stats = {};
+
+	// retained mode: the caller's target as it was before the ui went over it, and the lists of the last frame in draw order
+	const SoftSurface*		Background = nullptr;
+	std::vector<ListState>	Lists;
+	std::vector<ListState>	NextLists;
+	std::vector<PixelRect>	DirtyRects;
+	ImVec2					DisplayPos;
+	ImVec2					FramebufferScale;
+	bool					Valid = false;
+};
+
+// the atlas glyphs are rasterized on the backend's pool, the atlas is the same as a serial build
+static void ImGui_ImplSoft_BuildFontAtlasParallel(void* userData, int jobsCount, void (*jobFunc)(void* jobData, int jobIndex), void* jobData)
+{
+	static_cast<SoftThreadPool*>(userData)->ParallelFor(static_cast<uint32_t>(jobsCount), [jobFunc, jobData](uint32_t job)
+	{
+		jobFunc(jobData, static_cast<int>(job));
+	});
+}
+
+static ImGui_ImplSoft_Data* ImGui_ImplSoft_GetBackendData()
+{
+	return ImGui::GetCurrentContext() ? static_cast<ImGui_ImplSoft_Data*>(ImGui::GetIO().BackendRendererUserData) : nullptr;
+}
+
+// copies what the atlas glyph cache rasterized since the last frame into the font texture
+static void ImGui_ImplSoft_UpdateFontTexture(ImGui_ImplSoft_Data* bd)
+{
+	ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+	if (atlas->TexDirtyRects.empty())
+		return;
+	if (atlas->TexPixelsRGBA32 != nullptr && bd->FontTexture.width == static_cast<uint32_t>(atlas->TexWidth) && bd->FontTexture.height == static_cast<uint32_t>(atlas->TexHeight))
+	{
+		for (const ImVec4& rect : atlas->TexDirtyRects)
+		{
+			const int x = static_cast<int>(rect.x), width = static_cast<int>(rect.z) - x;
+			for (int y = static_cast<int>(rect.y); y < static_cast<int>(rect.w); ++y)
+				memcpy(bd->FontTexture.Row(static_cast<uint32_t>(y)) + x, atlas->TexPixelsRGBA32 + static_cast<size_t>(y) * atlas->TexWidth + x, static_cast<size_t>(width) * sizeof(uint32_t));
+		}
+	}
+	atlas->TexDirtyRects.clear();
+}
+
+bool ImGui_ImplSoft_Init(SoftThreadPool* pool)
+{
+	ImGuiIO& io = ImGui::GetIO();
+	IM_ASSERT(io.BackendRendererUserData == nullptr && "Already initialized a renderer backend!");
+
+	ImGui_ImplSoft_Data* bd = IM_NEW(ImGui_ImplSoft_Data)();
+	bd->Pool = pool;
+	io.BackendRendererUserData = static_cast<void*>(bd);
+	io.BackendRendererName = "imgui_impl_soft";
+	io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+	io.Fonts->TexSdfSupported = true;
+	if (pool != nullptr && io.Fonts->BuildParallelFor == nullptr)
+	{
+		io.Fonts->BuildParallelFor = ImGui_ImplSoft_BuildFontAtlasParallel;
+		io.Fonts->BuildParallelForUserData = pool;
+	}
+	return true;
+}
+
+void ImGui_ImplSoft_Shutdown()
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "No renderer backend to shutdown, or already shutdown?");
+	ImGuiIO& io = ImGui::GetIO();
+
+	io.Fonts->SetTexID(0);
+	io.Fonts->TexSdfSupported = false;
+	if (io.Fonts->BuildParallelFor == ImGui_ImplSoft_BuildFontAtlasParallel)
+	{
+		io.Fonts->BuildParallelFor = nullptr;
+		io.Fonts->BuildParallelForUserData = nullptr;
+	}
+	io.BackendRendererName = nullptr;
+	io.BackendRendererUserData = nullptr;
+	io.BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
+	IM_DELETE(bd);
+}
+
+void ImGui_ImplSoft_NewFrame()
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+	if (!bd->FontTexture.texels.empty())
+		return;
+
+	ImGuiIO& io = ImGui::GetIO();
+	unsigned char* pixels = nullptr;
+	int width = 0, height = 0;
+	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	bd->FontTexture.Resize(static_cast<uint32_t>(width), static_cast<uint32_t>(height), SoftFormat::R8G8B8A8_UNORM);
+	memcpy(bd->FontTexture.texels.data(), pixels, bd->FontTexture.SizeInBytes());
+	bd->FontTexture.state = SoftResourceState::ShaderResource;
+	io.Fonts->SetTexID(static_cast<ImTextureID>(&bd->FontTexture));
+}
+
+void ImGui_ImplSoft_SetQuadFastPath(bool enabled)
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+	bd->QuadFastPath = enabled;
+}
+
+ImGui_ImplSoft_Stats ImGui_ImplSoft_GetStats()
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+	return bd->Stats;
+}
+
+void ImGui_ImplSoft_RenderDrawData(ImDrawData* drawData, SoftSurface* target)
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+	IM_ASSERT(target != nullptr && target->format == SoftFormat::R8G8B8A8_UNORM);
+	ImGui_ImplSoft_UpdateFontTexture(bd);
+	bd->Stats = {};
+	if (drawData->DisplaySize.x <= 0.0f || drawData->DisplaySize.y <= 0.0f || drawData->CmdListsCount == 0)
+		return;
+
+	const PixelRect rect = { 0, 0, static_cast<int32_t>(target->width), static_cast<int32_t>(target->height) };
+	DrawRect(drawData, *target, rect, HasUserCallbacks(drawData) ? nullptr : bd->Pool, bd->QuadFastPath, &bd->Stats);
+}
+
+void ImGui_ImplSoft_RenderDrawDataRetained(ImDrawData* drawData, SoftSurface* target, const SoftSurface* background)
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+	IM_ASSERT(target != nullptr && target->format == SoftFormat::R8G8B8A8_UNORM);
+	ImGui_ImplSoft_UpdateFontTexture(bd);
+	bd->Stats = {};
+
+	const PixelRect full = { 0, 0, static_cast<int32_t>(target->width), static_cast<int32_t>(target->height) };
+	const bool empty = drawData->DisplaySize.x <= 0.0f || drawData->DisplaySize.y <= 0.0f;
+	const int listCount = empty ? 0 : drawData->CmdListsCount;
+
+	// a new background gets the ui as ImGui_ImplSoft_RenderDrawData draws it, with no hashing for a background that
+	// changes every frame. The next call without one draws everything again to know the lists
+	if (background != nullptr)
+	{
+		IM_ASSERT(background->width == target->width && background->height == target->height && background->format == target->format);
+		bd->Background = background;
+		bd->Valid = false;
+		bd->Lists.clear();
+		bd->Stats.Lists = bd->Stats.DirtyLists = listCount;
+		bd->Stats.DirtyPixels = static_cast<int>(target->width * target->height);
+		if (listCount > 0)
+			DrawRect(drawData, *target, full, HasUserCallbacks(drawData) ? nullptr : bd->Pool, bd->QuadFastPath, &bd->Stats);
+		return;
+	}
+	IM_ASSERT(bd->Background != nullptr && "The first call needs the background");
+	IM_ASSERT(bd->Background->width == target->width && bd->Background->height == target->height && bd->Background->format == target->format);
+
+	// a new origin or scale moves every list
+	const bool redrawAll = !bd->Valid ||
+		bd->DisplayPos.x != drawData->DisplayPos.x || bd->DisplayPos.y != drawData->DisplayPos.y ||
+		bd->FramebufferScale.x != drawData->FramebufferScale.x || bd->FramebufferScale.y != drawData->FramebufferScale.y;
+
+	// a list is clean when the one drawn at its place in the last frame was the same list with the same hash,
+	// else what it covers now and what was there before is drawn again
+	bd->NextLists.clear();
+	bd->DirtyRects.clear();
+	for (int n = 0; n < listCount; ++n)
+	{
+		bd->NextLists.push_back(DescribeList(drawData->CmdLists[n], drawData->DisplayPos, drawData->FramebufferScale, full));
+		const ListState& state = bd->NextLists.back();
+		const size_t index = static_cast<size_t>(n);
+		if (index < bd->Lists.size() && bd->Lists[index].List == state.List && bd->Lists[index].Hash == state.Hash)
+			continue;
+		bd->Stats.DirtyLists++;
+		AddDirtyRect(bd->DirtyRects, state.Rect);
+		if (index < bd->Lists.size())
+			AddDirtyRect(bd->DirtyRects, bd->Lists[index].Rect);
+	}
+	for (size_t index = static_cast<size_t>(listCount); index < bd->Lists.size(); ++index)
+		AddDirtyRect(bd->DirtyRects, bd->Lists[index].Rect);
+	bd->Lists.swap(bd->NextLists);
+	bd->Stats.Lists = listCount;
+	bd->DisplayPos = drawData->DisplayPos;
+	bd->FramebufferScale = drawData->FramebufferScale;
+	bd->Valid = true;
+
+	// the dirty rects are put back from the background and the ui drawn over them as ImGui_ImplSoft_RenderDrawData
+	// would, so the pixels don't depend on the mode
+	if (redrawAll)
+		bd->DirtyRects.assign(1, full);
+	for (const PixelRect& rect : bd->DirtyRects)
+		for (int32_t y = rect.minY; y < rect.maxY; ++y)
+			memcpy(target->Row(static_cast<uint32_t>(y)) + rect.minX, bd->Background->Row(static_cast<uint32_t>(y)) + rect.minX, static_cast<size_t>(rect.maxX - rect.minX) * sizeof(uint32_t));
+	SoftThreadPool* pool = HasUserCallbacks(drawData) ? nullptr : bd->Pool;
+	for (size_t i = 0; i < bd->DirtyRects.size(); ++i)
+	{
+		const PixelRect& rect = bd->DirtyRects[i];
+		if (listCount > 0)
+			DrawRect(drawData, *target, rect, pool, bd->QuadFastPath, i == 0 ? &bd->Stats : nullptr);
+		bd->Stats.DirtyPixels += (rect.maxX - rect.minX) * (rect.maxY - rect.minY);
+	}
+}
+
+void ImGui_ImplSoft_InvalidateRetained()
+{
+	ImGui_ImplSoft_Data* bd = ImGui_ImplSoft_GetBackendData();
+	IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplSoft_Init()?");
+	bd->Valid = false;
+	bd->Lists.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "imgui.h"
+
+class SoftSurface;
+class SoftThreadPool;
+
+// Dear ImGui renderer backend for the software path. Draws ImDrawData into an R8G8B8A8_UNORM SoftSurface,
+// e.g. over a finished frame of the SoftRenderer, without a gpu or a window.
+// Textures are passed as const SoftSurface* in ImTextureID, the font atlas is uploaded by the backend, and the
+// glyphs its cache rasterizes on demand (ImFontAtlas::TexDirtyRects) are copied in before each render.
+// Vertices of the font texture with U >= IM_FONT_SDF_UV_OFFSET sample it as a signed distance field in the alpha channel,
+// filtered bilinearly, which is how the text of ImFontConfig::SDF fonts is drawn at any scale (ImFontAtlas::TexSdfSupported).
+// Triangles are filled span by span, with SSE2 where the target has it, and cover the same pixels as the
+// software rasterizer's top-left rule. Blending matches the dx12 backend.
+// Axis-aligned quads from PrimRect and PrimRectUV, most of a UI, skip the edge functions and are drawn
+// as span fills and texture blits.
+
+// what the last ImGui_ImplSoft_RenderDrawData drew
+struct ImGui_ImplSoft_Stats
+{
+	int		Triangles;		// drawn with edge functions
+	int		Quads;			// triangle pairs drawn by the quad path
+	int		Lists;			// retained mode: draw lists in the frame
+	int		DirtyLists;		// retained mode: lists that changed since the last frame
+	int		DirtyPixels;	// retained mode: pixels drawn again
+};
+
+// with a pool the target is split into horizontal bands that are drawn in parallel, and unless the atlas has its
+// own ImFontAtlas::BuildParallelFor its glyphs are rasterized on the pool. The result does not change
+IMGUI_IMPL_API bool ImGui_ImplSoft_Init(SoftThreadPool* pool = nullptr);
+IMGUI_IMPL_API void ImGui_ImplSoft_Shutdown();
+// uploads the font atlas the first time it is called
+IMGUI_IMPL_API void ImGui_ImplSoft_NewFrame();
+IMGUI_IMPL_API void ImGui_ImplSoft_RenderDrawData(ImDrawData* drawData, SoftSurface* target);
+// Retained mode for mostly static UIs. Every draw list is hashed, only the rects of lists that changed since the
+// last call are put back from the background and drawn again, nothing when none did. The pixels are the same as
+// ImGui_ImplSoft_RenderDrawData's.
+// With a background, the target holds the same pixels and the UI is drawn over it as ImGui_ImplSoft_RenderDrawData
+// does, the next call without one draws the whole UI again. The background is kept and must stay unchanged until
+// the next call that passes one, the first call and a new target size need one. With nullptr the target must still
+// hold what the last call left there. Texture contents are not part of the hash, call
+// ImGui_ImplSoft_InvalidateRetained after changing one. User callbacks run once per dirty rect.
+IMGUI_IMPL_API void ImGui_ImplSoft_RenderDrawDataRetained(ImDrawData* drawData, SoftSurface* target, const SoftSurface* background);
+IMGUI_IMPL_API void ImGui_ImplSoft_InvalidateRetained();
+// on by default, off draws every triangle with edge functions to compare against
+IMGUI_IMPL_API void ImGui_ImplSoft_SetQuadFastPath(bool enabled);
+IMGUI_IMPL_API ImGui_ImplSoft_Stats ImGui_ImplSoft_GetStats();
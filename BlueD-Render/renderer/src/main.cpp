@@ -1,44 +1,146 @@
 #include "gui.h"
+#include "soft/soft_redraw.h"
+#include "soft/soft_sequence.h"
 
+#include <fcntl.h>
+#include <io.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <iostream>
 #include <thread>
 
+namespace
+{
+	// windows subsystem processes only get a crt stdout when the handle was inherited, e.g. from a pipe
+	FILE* OpenBinaryStdout()
+	{
+		if (_fileno(stdout) >= 0)
+		{
+			_setmode(_fileno(stdout), _O_BINARY);
+			return stdout;
+		}
+		HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
+		if (handle == NULL || handle == INVALID_HANDLE_VALUE)
+			return nullptr;
+		int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_BINARY);
+		return fd >= 0 ? _fdopen(fd, "wb") : nullptr;
+	}
+
+	// renderer --sequence <frames> [--format y4m|rgba] ... | encoder
+	int RunSequence(const SoftSequenceDesc& desc)
+	{
+		FILE* out = OpenBinaryStdout();
+		if (!out)
+		{
+			MessageBoxA(nullptr, "--sequence streams to stdout, pipe the output into a file or an encoder", "BlueD", MB_ICONERROR);
+			return EXIT_FAILURE;
+		}
+		try
+		{
+			RenderSequence(desc, out);
+		}
+		catch (const std::exception& e)
+		{
+			fprintf(stderr, "sequence failed: %s\n", e.what());
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// --animate renders every iteration like a game loop, --min-refresh <hz> renders at least that often
+	// for content that changes without an event
+	void ParseRedrawArgs(int argc, char** argv, RedrawScheduler& redraw)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--animate") == 0)
+				redraw.SetAnimating(true);
+			else if (strcmp(argv[i], "--min-refresh") == 0 && i + 1 < argc)
+				redraw.SetMinimumRefresh(static_cast<float>(atof(argv[++i])));
+		}
+	}
+}
+
 int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, INT)
 {
+	// headless modes run before any window or device is created
+	SoftSequenceDesc sequence;
+	try
+	{
+		if (ParseSequenceArgs(__argc, __argv, sequence))
+			return RunSequence(sequence);
+	}
+	catch (const std::exception& e)
+	{
+		MessageBoxA(nullptr, e.what(), "BlueD", MB_ICONERROR);
+		return EXIT_FAILURE;
+	}
 
 	// create gui object
 	Gui gui;
 	gui.InitWindow();
 
 	// create dx12 object
-	DXBlue dx = DXBlue(gui.windowWidth, gui.windowHeight, gui.window);
+	DXBlue dx(gui.windowWidth, gui.windowHeight, gui.window);
 	// initialize dx before initialize ImGui
 	dx.Init();
+	// lets the window procedure forward resizes
+	SetWindowLongPtr(gui.window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&dx));
+	// the window may already differ from the size the device started with
+	RECT clientRect;
+	if (GetClientRect(gui.window, &clientRect))
+		dx.RequestResize(clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
 
 	//gui.dx = &dx;
 	//gui.InitGui();
 
+	// frames are only rendered when something may have changed: input, finished background work, a
+	// settled resize, or an animation. An idle window sleeps in MsgWaitForMultipleObjectsEx
+	RedrawScheduler redraw;
+	ParseRedrawArgs(__argc, __argv, redraw);
+
 	MSG msg;
 	ZeroMemory(&msg, sizeof(MSG));
-	while (true)
+	bool quit = false;
+	while (!quit)
 	{
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			if (msg.message == WM_QUIT)
+			{
+				quit = true;
 				break;
+			}
 
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			redraw.Invalidate();
 		}
-		else
+		if (quit)
+			break;
+
+		// a debounced resize is applied by the first frame after it settled. While one is in flight the next
+		// waits for it, its deadline has passed and would spin the loop, the finished work sets g_hWakeEvent
+		if (dx.g_ResizeDebouncer.IsPending() && !dx.g_ResizeInFlight)
+			redraw.ScheduleAt(dx.g_ResizeDebouncer.Deadline());
+
+		if (redraw.ShouldRender())
 		{
+			redraw.BeginFrame();
 			// render gui
 			//gui.Render();
 			dx.Render();
+			continue;
 		}
+
+		if (MsgWaitForMultipleObjectsEx(1, &dx.g_hWakeEvent, redraw.WaitTimeoutMs(), QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_OBJECT_0)
+			redraw.Invalidate();
 	}
 	
 	//gui.CleanUp();
+	SetWindowLongPtr(gui.window, GWLP_USERDATA, 0);
 	dx.Cleanup();
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,101 @@
+#include "soft_arena.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	const size_t kMaxAlignment = 64;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// new[] only guarantees the default alignment, blocks are padded so their start can be aligned further
+	uint8_t* AlignedStart(uint8_t* block)
+	{
+		return reinterpret_cast<uint8_t*>(AlignUp(reinterpret_cast<uintptr_t>(block), kMaxAlignment));
+	}
+}
+
+FrameArena::FrameArena(size_t initialCapacity)
+{
+	if (initialCapacity > 0)
+	{
+		block.reset(new uint8_t[initialCapacity + kMaxAlignment]);
+		++stats.systemAllocations;
+	}
+	stats.capacity = initialCapacity;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (alignment > kMaxAlignment)
+		throw std::runtime_error("frame arena: alignment above 64 bytes");
+
+	size_t start = AlignUp(offset, alignment);
+	if (overflow.empty() && start + size <= stats.capacity)
+	{
+		offset = start + size;
+		stats.used = offset;
+		return AlignedStart(block.get()) + start;
+	}
+
+	// the main block is full for this frame, continue in overflow blocks that grow geometrically
+	start = AlignUp(overflowOffset, alignment);
+	if (overflow.empty() || start + size > overflowSize)
+	{
+		overflowSize = (std::max)(size, (std::max)(stats.capacity, overflowSize * 2));
+		overflow.emplace_back(new uint8_t[overflowSize + kMaxAlignment]);
+		++stats.systemAllocations;
+		overflowOffset = 0;
+		start = 0;
+	}
+	stats.used += start + size - overflowOffset;
+	overflowOffset = start + size;
+	return AlignedStart(overflow.back().get()) + start;
+}
+
+void FrameArena::Reset()
+{
+	stats.highWater = (std::max)(stats.highWater, stats.used);
+	if (!overflow.empty())
+	{
+		// one block big enough for the largest frame seen, the frames after it fit without spilling
+		overflow.clear();
+		overflowOffset = 0;
+		overflowSize = 0;
+		size_t capacity = AlignUp(stats.highWater + stats.highWater / 4, kMaxAlignment);
+		block.reset(new uint8_t[capacity + kMaxAlignment]);
+		++stats.systemAllocations;
+		stats.capacity = capacity;
+	}
+	offset = 0;
+	stats.used = 0;
+}
+
+void FrameArenas::Init(uint32_t frameCount, size_t initialCapacity)
+{
+	arenas.clear();
+	for (uint32_t i = 0; i < (std::max)(frameCount, 1u); ++i)
+		arenas.emplace_back(new FrameArena(initialCapacity));
+	slotFenceValues.assign(arenas.size(), 0);
+	currentSlot = 0;
+}
+
+FrameArena& FrameArenas::BeginFrame(uint32_t slot, uint64_t completedFenceValue)
+{
+	if (slot >= arenas.size())
+		throw std::logic_error("frame arena: frame slot out of range");
+	if (slotFenceValues[slot] > completedFenceValue)
+		throw std::logic_error("frame arena: frame slot reused before the gpu finished with it");
+	currentSlot = slot;
+	arenas[slot]->Reset();
+	return *arenas[slot];
+}
+
+void FrameArenas::EndFrame(uint64_t fenceValue)
+{
+	slotFenceValues[currentSlot] = fenceValue;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+struct FrameArenaStats
+{
+	size_t		capacity = 0;			// bytes of the main block
+	size_t		used = 0;				// bytes taken this frame, overflow blocks included
+	size_t		highWater = 0;			// the most a single frame took
+	uint64_t	systemAllocations = 0;	// blocks ever requested from the system allocator
+};
+
+// Bump allocator for data that only lives for one frame. Allocation is a pointer increment, freeing is a no-op
+// and Reset takes everything back at once. A frame that does not fit spills into extra blocks, the next Reset
+// replaces them with one main block of the high water size, so steady state frames never call into the system
+// allocator. Not thread safe.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t initialCapacity = 64 * 1024);
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// alignment is a power of two
+	void* Allocate(size_t size, size_t alignment);
+	template <typename T>
+	T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+	// everything allocated since the last Reset is gone, nothing is destructed
+	void Reset();
+
+	const FrameArenaStats& GetStats() const { return stats; }
+
+private:
+	std::unique_ptr<uint8_t[]>					block;
+	size_t										offset = 0;
+	std::vector<std::unique_ptr<uint8_t[]>>		overflow;
+	size_t										overflowOffset = 0;
+	size_t										overflowSize = 0;
+	FrameArenaStats								stats;
+};
+
+// STL allocator on top of a frame arena, without an arena it falls back to new and delete so the same
+// containers work outside a frame. Containers have to be dropped before their arena is reset.
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	// a container moved into another one takes its arena along, that is how per frame containers are rebound
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	ArenaAllocator() = default;
+	explicit ArenaAllocator(FrameArena* arena) : arena(arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count)
+	{
+		if (arena)
+			return arena->AllocateArray<T>(count);
+		return static_cast<T*>(::operator new(count * sizeof(T)));
+	}
+
+	void deallocate(T* pointer, size_t)
+	{
+		if (!arena)
+			::operator delete(pointer);
+	}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+	FrameArena*		arena = nullptr;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// One arena per frame slot. A slot's arena is reset when a new frame starts in it, which the fence
+// has to allow, so data built in one frame stays valid while the gpu or the next frame still reads it.
+class FrameArenas
+{
+public:
+	void Init(uint32_t frameCount, size_t initialCapacity = 64 * 1024);
+
+	// resets the slot's arena and makes it the current one, the fence must have passed the frame that used it last
+	FrameArena& BeginFrame(uint32_t slot, uint64_t completedFenceValue);
+	// the current arena is in use until the fence reaches fenceValue
+	void EndFrame(uint64_t fenceValue);
+
+	FrameArena& Current() { return *arenas[currentSlot]; }
+	uint32_t FrameCount() const { return static_cast<uint32_t>(arenas.size()); }
+	FrameArena& GetArena(uint32_t slot) { return *arenas[slot]; }
+
+private:
+	std::vector<std::unique_ptr<FrameArena>>	arenas;
+	std::vector<uint64_t>						slotFenceValues;
+	uint32_t									currentSlot = 0;
+};
@@ -0,0 +1,553 @@
+#include "soft_capture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const char kCaptureMagic[4] = { 'B', 'D', 'C', 'P' };
+
+	uint64_t HashBytes(const void* data, size_t size)
+	{
+		// FNV-1a
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint32_t IndexBufferSize(const SoftCommand& command)
+	{
+		return command.indexBuffer.count * static_cast<uint32_t>(sizeof(uint32_t));
+	}
+
+	class CaptureReader
+	{
+	public:
+		explicit CaptureReader(FILE* file) : file(file) {}
+
+		void Read(void* data, size_t size)
+		{
+			if (size && fread(data, 1, size, file) != size)
+				throw std::runtime_error("capture file is truncated");
+		}
+
+		template <class T> T Read()
+		{
+			T value;
+			Read(&value, sizeof(T));
+			return value;
+		}
+
+	private:
+		FILE* file;
+	};
+}
+
+SoftCaptureWriter::~SoftCaptureWriter()
+{
+	End();
+}
+
+void SoftCaptureWriter::Begin(const char* path)
+{
+	End();
+	file = fopen(path, "wb");
+	if (!file)
+		throw std::runtime_error(std::string("failed to create capture file ") + path);
+
+	surfaceIds.clear();
+	bufferIds.clear();
+	bufferContents.clear();
+	pipelineIds.clear();
+	Write(kCaptureMagic, sizeof(kCaptureMagic));
+	Write(kSoftCaptureVersion);
+}
+
+void SoftCaptureWriter::End()
+{
+	if (!file)
+		return;
+	Write(SoftCaptureChunk::End);
+	fclose(file);
+	file = nullptr;
+	// the copies are only needed while capturing
+	bufferIds.clear();
+	bufferContents.clear();
+}
+
+void SoftCaptureWriter::Write(const void* data, size_t size)
+{
+	if (size && fwrite(data, 1, size, file) != size)
+		throw std::runtime_error("failed to write capture file");
+}
+
+uint32_t SoftCaptureWriter::SurfaceId(const SoftSurface* surface)
+{
+	if (!surface)
+		return kSoftCaptureNull;
+
+	auto it = surfaceIds.find(surface);
+	if (it != surfaceIds.end())
+		return it->second;
+
+	uint32_t id = static_cast<uint32_t>(surfaceIds.size());
+	surfaceIds[surface] = id;
+	Write(SoftCaptureChunk::Surface);
+	Write(id);
+	Write(surface->width);
+	Write(surface->height);
+	Write(surface->format);
+	Write(surface->state);
+	WriteTexels(*surface);
+	return id;
+}
+
+void SoftCaptureWriter::WriteTexels(const SoftSurface& surface)
+{
+	// run length encoded, cleared targets shrink to a handful of runs
+	std::vector<uint32_t> runs;
+	const std::vector<uint32_t>& texels = surface.texels;
+	for (size_t i = 0; i < texels.size();)
+	{
+		size_t end = i + 1;
+		while (end < texels.size() && texels[end] == texels[i])
+			++end;
+		runs.push_back(static_cast<uint32_t>(end - i));
+		runs.push_back(texels[i]);
+		i = end;
+	}
+	Write(static_cast<uint32_t>(runs.size() / 2));
+	Write(runs.data(), runs.size() * sizeof(uint32_t));
+}
+
+uint32_t SoftCaptureWriter::BufferId(const void* data, uint32_t size)
+{
+	if (!data)
+		return kSoftCaptureNull;
+
+	// buffers are identified by content, so a dynamic buffer rewritten in place is captured once per version
+	uint64_t key = HashBytes(data, size);
+	auto range = bufferIds.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		const std::vector<uint8_t>& contents = bufferContents[it->second];
+		if (contents.size() == size && memcmp(contents.data(), data, size) == 0)
+			return it->second;
+	}
+
+	uint32_t id = static_cast<uint32_t>(bufferContents.size());
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	bufferContents.emplace_back(bytes, bytes + size);
+	bufferIds.emplace(key, id);
+	Write(SoftCaptureChunk::Buffer);
+	Write(id);
+	Write(size);
+	Write(data, size);
+	return id;
+}
+
+uint32_t SoftCaptureWriter::PipelineId(const SoftPipelineState* state)
+{
+	if (!state)
+		return kSoftCaptureNull;
+
+	auto it = pipelineIds.find(state);
+	if (it != pipelineIds.end())
+		return it->second;
+
+	uint32_t id = static_cast<uint32_t>(pipelineIds.size());
+	pipelineIds[state] = id;
+	const SoftPipelineDesc& desc = state->desc;
+	const uint8_t fields[] = {
+		static_cast<uint8_t>(desc.shader), static_cast<uint8_t>(desc.blend),
+		static_cast<uint8_t>(desc.depthEnable), static_cast<uint8_t>(desc.depthWrite), static_cast<uint8_t>(desc.depthFunc),
+		static_cast<uint8_t>(desc.cull), static_cast<uint8_t>(desc.frontCounterClockwise),
+		static_cast<uint8_t>(desc.layout) };
+	Write(SoftCaptureChunk::Pipeline);
+	Write(id);
+	Write(fields, sizeof(fields));
+	return id;
+}
+
+void SoftCaptureWriter::RecordExecute(uint32_t count, const SoftCommandList* const* lists)
+{
+	// first pass writes every resource the submission needs that the file does not have yet
+	pendingBufferIds.clear();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		for (const SoftCommand& command : lists[i]->commands)
+		{
+			switch (command.type)
+			{
+			case SoftCommandType::ResourceBarrier: SurfaceId(command.barrier.resource); break;
+			case SoftCommandType::UpdateSubresource: SurfaceId(command.upload.target); break;
+			case SoftCommandType::SetRenderTargets:
+				SurfaceId(command.renderTargets.color);
+				SurfaceId(command.renderTargets.depth);
+				break;
+			case SoftCommandType::ClearRenderTarget: SurfaceId(command.clearColor.target); break;
+			case SoftCommandType::ClearDepth: SurfaceId(command.clearDepth.target); break;
+			case SoftCommandType::SetPipelineState: PipelineId(command.pipelineState); break;
+			case SoftCommandType::SetTexture: SurfaceId(command.texture); break;
+			case SoftCommandType::SetShadingRateImage: SurfaceId(command.shadingRateImage); break;
+			case SoftCommandType::SetVertexBuffer:
+				pendingBufferIds.push_back(BufferId(command.vertexBuffer.data, command.vertexBuffer.sizeInBytes));
+				break;
+			case SoftCommandType::SetIndexBuffer:
+				pendingBufferIds.push_back(BufferId(command.indexBuffer.data, IndexBufferSize(command)));
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	// second pass writes the commands themselves
+	size_t bufferCursor = 0;
+	Write(SoftCaptureChunk::Execute);
+	Write(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Write(static_cast<uint32_t>(lists[i]->commands.size()));
+		for (const SoftCommand& command : lists[i]->commands)
+			WriteCommand(command, bufferCursor);
+	}
+}
+
+void SoftCaptureWriter::RecordFrameEnd()
+{
+	if (file)
+		Write(SoftCaptureChunk::FrameEnd);
+}
+
+void SoftCaptureWriter::WriteCommand(const SoftCommand& command, size_t& bufferCursor)
+{
+	Write(command.type);
+	switch (command.type)
+	{
+	case SoftCommandType::ResourceBarrier:
+		Write(SurfaceId(command.barrier.resource));
+		Write(command.barrier.before);
+		Write(command.barrier.after);
+		break;
+
+	case SoftCommandType::UpdateSubresource:
+		Write(SurfaceId(command.upload.target));
+		Write(command.upload.data, command.upload.target->SizeInBytes());
+		break;
+
+	case SoftCommandType::SetRenderTargets:
+		Write(SurfaceId(command.renderTargets.color));
+		Write(SurfaceId(command.renderTargets.depth));
+		break;
+
+	case SoftCommandType::ClearRenderTarget:
+		Write(SurfaceId(command.clearColor.target));
+		Write(command.clearColor.color, sizeof(command.clearColor.color));
+		break;
+
+	case SoftCommandType::ClearDepth:
+		Write(SurfaceId(command.clearDepth.target));
+		Write(command.clearDepth.depth);
+		break;
+
+	case SoftCommandType::SetPipelineState: Write(PipelineId(command.pipelineState)); break;
+	case SoftCommandType::SetTexture: Write(SurfaceId(command.texture)); break;
+	case SoftCommandType::SetWorldViewProj: Write(command.worldViewProj); break;
+
+	case SoftCommandType::SetVertexBuffer:
+		Write(pendingBufferIds[bufferCursor++]);
+		Write(command.vertexBuffer.stride);
+		break;
+
+	case SoftCommandType::SetIndexBuffer:
+		Write(pendingBufferIds[bufferCursor++]);
+		break;
+
+	case SoftCommandType::Draw:
+		Write(command.draw.vertexCount);
+		Write(command.draw.startVertex);
+		break;
+
+	case SoftCommandType::DrawIndexed:
+		Write(command.drawIndexed.indexCount);
+		Write(command.drawIndexed.startIndex);
+		Write(command.drawIndexed.baseVertex);
+		break;
+
+	case SoftCommandType::SetShadingRate: Write(command.shadingRate); break;
+	case SoftCommandType::SetShadingRateImage: Write(SurfaceId(command.shadingRateImage)); break;
+	}
+}
+
+void SoftCaptureReplay::Load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		throw std::runtime_error(std::string("failed to open capture file ") + path);
+	std::unique_ptr<FILE, int (*)(FILE*)> closer(file, &fclose);
+	CaptureReader reader(file);
+
+	char magic[4];
+	reader.Read(magic, sizeof(magic));
+	if (memcmp(magic, kCaptureMagic, sizeof(magic)) != 0)
+		throw std::runtime_error("not a capture file");
+	uint32_t version = reader.Read<uint32_t>();
+	if (version < 2 || version > kSoftCaptureVersion)
+		throw std::runtime_error("unsupported capture version");
+
+	surfaces.clear();
+	buffers.clear();
+	bufferSizes.clear();
+	uploads.clear();
+	pipelines.clear();
+	submissions.clear();
+	frameCount = 0;
+	lastRenderTarget = nullptr;
+
+	auto surface = [this](uint32_t id) -> SoftSurface*
+	{
+		if (id == kSoftCaptureNull)
+			return nullptr;
+		if (id >= surfaces.size())
+			throw std::runtime_error("capture references an unknown surface");
+		return &surfaces[id];
+	};
+	auto checkBuffer = [this](uint32_t id) -> bool
+	{
+		if (id == kSoftCaptureNull)
+			return false;
+		if (id >= buffers.size())
+			throw std::runtime_error("capture references an unknown buffer");
+		return true;
+	};
+	auto pipeline = [this](uint32_t id) -> const SoftPipelineState*
+	{
+		if (id == kSoftCaptureNull)
+			return nullptr;
+		if (id >= pipelines.size())
+			throw std::runtime_error("capture references an unknown pipeline state");
+		return pipelines[id];
+	};
+
+	for (;;)
+	{
+		SoftCaptureChunk chunk = reader.Read<SoftCaptureChunk>();
+		if (chunk == SoftCaptureChunk::End)
+			break;
+
+		switch (chunk)
+		{
+		case SoftCaptureChunk::Surface:
+		{
+			if (reader.Read<uint32_t>() != surfaces.size())
+				throw std::runtime_error("capture surfaces are out of order");
+			uint32_t width = reader.Read<uint32_t>();
+			uint32_t height = reader.Read<uint32_t>();
+			SoftFormat format = reader.Read<SoftFormat>();
+			surfaces.emplace_back();
+			SoftSurface& s = surfaces.back();
+			s.Resize(width, height, format);
+			s.state = reader.Read<SoftResourceState>();
+
+			uint32_t runCount = reader.Read<uint32_t>();
+			size_t cursor = 0;
+			for (uint32_t r = 0; r < runCount; ++r)
+			{
+				uint32_t length = reader.Read<uint32_t>();
+				uint32_t texel = reader.Read<uint32_t>();
+				if (length > s.texels.size() - cursor)
+					throw std::runtime_error("capture surface data is corrupt");
+				std::fill(s.texels.begin() + cursor, s.texels.begin() + cursor + length, texel);
+				cursor += length;
+			}
+		} break;
+
+		case SoftCaptureChunk::Buffer:
+		{
+			if (reader.Read<uint32_t>() != buffers.size())
+				throw std::runtime_error("capture buffers are out of order");
+			uint32_t size = reader.Read<uint32_t>();
+			buffers.emplace_back((size + 3) / 4);
+			bufferSizes.push_back(size);
+			reader.Read(buffers.back().data(), size);
+		} break;
+
+		case SoftCaptureChunk::Pipeline:
+		{
+			if (reader.Read<uint32_t>() != pipelines.size())
+				throw std::runtime_error("capture pipeline states are out of order");
+			uint8_t fields[8];
+			reader.Read(fields, sizeof(fields));
+			if (fields[0] >= static_cast<uint8_t>(SoftShader::Count) || fields[1] >= static_cast<uint8_t>(SoftBlend::Count) ||
+				fields[4] >= static_cast<uint8_t>(SoftCompare::Count) || fields[5] >= static_cast<uint8_t>(SoftCull::Count) ||
+				fields[7] >= static_cast<uint8_t>(SoftVertexLayout::Count))
+				throw std::runtime_error("capture contains an unknown pipeline state");
+			SoftPipelineDesc desc;
+			desc.shader = static_cast<SoftShader>(fields[0]);
+			desc.blend = static_cast<SoftBlend>(fields[1]);
+			desc.depthEnable = fields[2] != 0;
+			desc.depthWrite = fields[3] != 0;
+			desc.depthFunc = static_cast<SoftCompare>(fields[4]);
+			desc.cull = static_cast<SoftCull>(fields[5]);
+			desc.frontCounterClockwise = fields[6] != 0;
+			desc.layout = static_cast<SoftVertexLayout>(fields[7]);
+			pipelines.push_back(pipelineCache.GetPipelineState(desc));
+		} break;
+
+		case SoftCaptureChunk::Execute:
+		{
+			submissions.emplace_back();
+			Submission& submission = submissions.back();
+			uint32_t listCount = reader.Read<uint32_t>();
+			for (uint32_t l = 0; l < listCount; ++l)
+			{
+				submission.lists.emplace_back(new SoftCommandList());
+				SoftCommandList& list = *submission.lists.back();
+				list.Reset(nullptr);
+
+				uint32_t commandCount = reader.Read<uint32_t>();
+				for (uint32_t c = 0; c < commandCount; ++c)
+				{
+					switch (reader.Read<SoftCommandType>())
+					{
+					case SoftCommandType::ResourceBarrier:
+					{
+						SoftSurface* resource = surface(reader.Read<uint32_t>());
+						SoftResourceState before = reader.Read<SoftResourceState>();
+						SoftResourceState after = reader.Read<SoftResourceState>();
+						list.ResourceBarrier(resource, before, after);
+					} break;
+
+					case SoftCommandType::UpdateSubresource:
+					{
+						SoftSurface* target = surface(reader.Read<uint32_t>());
+						if (!target)
+							throw std::runtime_error("capture uploads to a null surface");
+						uploads.emplace_back(target->texels.size());
+						reader.Read(uploads.back().data(), target->SizeInBytes());
+						list.UpdateSubresource(target, uploads.back().data());
+					} break;
+
+					case SoftCommandType::SetRenderTargets:
+					{
+						SoftSurface* color = surface(reader.Read<uint32_t>());
+						SoftSurface* depth = surface(reader.Read<uint32_t>());
+						list.OMSetRenderTargets(color, depth);
+						if (color)
+							lastRenderTarget = color;
+					} break;
+
+					case SoftCommandType::ClearRenderTarget:
+					{
+						SoftSurface* target = surface(reader.Read<uint32_t>());
+						float color[4];
+						reader.Read(color, sizeof(color));
+						list.ClearRenderTargetView(target, color);
+					} break;
+
+					case SoftCommandType::ClearDepth:
+					{
+						SoftSurface* target = surface(reader.Read<uint32_t>());
+						list.ClearDepthStencilView(target, reader.Read<float>());
+					} break;
+
+					case SoftCommandType::SetPipelineState: list.SetPipelineState(pipeline(reader.Read<uint32_t>())); break;
+					case SoftCommandType::SetTexture: list.SetTexture(surface(reader.Read<uint32_t>())); break;
+					case SoftCommandType::SetWorldViewProj: list.SetWorldViewProj(reader.Read<Mat4>()); break;
+
+					case SoftCommandType::SetVertexBuffer:
+					{
+						uint32_t id = reader.Read<uint32_t>();
+						uint32_t stride = reader.Read<uint32_t>();
+						if (checkBuffer(id))
+							list.IASetVertexBuffer(buffers[id].data(), bufferSizes[id], stride);
+						else
+							list.IASetVertexBuffer(nullptr, 0, stride);
+					} break;
+
+					case SoftCommandType::SetIndexBuffer:
+					{
+						uint32_t id = reader.Read<uint32_t>();
+						if (checkBuffer(id))
+							list.IASetIndexBuffer(buffers[id].data(), bufferSizes[id] / sizeof(uint32_t));
+						else
+							list.IASetIndexBuffer(nullptr, 0);
+					} break;
+
+					case SoftCommandType::Draw:
+					{
+						uint32_t vertexCount = reader.Read<uint32_t>();
+						list.Draw(vertexCount, reader.Read<uint32_t>());
+					} break;
+
+					case SoftCommandType::DrawIndexed:
+					{
+						uint32_t indexCount = reader.Read<uint32_t>();
+						uint32_t startIndex = reader.Read<uint32_t>();
+						list.DrawIndexed(indexCount, startIndex, reader.Read<int32_t>());
+					} break;
+
+					case SoftCommandType::SetShadingRate:
+					{
+						SoftShadingRate rate = reader.Read<SoftShadingRate>();
+						if (rate >= SoftShadingRate::Count)
+							throw std::runtime_error("capture contains an unknown shading rate");
+						list.RSSetShadingRate(rate);
+					} break;
+
+					case SoftCommandType::SetShadingRateImage: list.RSSetShadingRateImage(surface(reader.Read<uint32_t>())); break;
+
+					default:
+						throw std::runtime_error("capture contains an unknown command");
+					}
+				}
+				list.Close();
+				submission.executeOrder.push_back(&list);
+			}
+		} break;
+
+		case SoftCaptureChunk::FrameEnd:
+			++frameCount;
+			break;
+
+		default:
+			throw std::runtime_error("capture contains an unknown chunk");
+		}
+	}
+
+	initialSurfaces.assign(surfaces.begin(), surfaces.end());
+}
+
+void SoftCaptureReplay::Reset()
+{
+	for (size_t i = 0; i < surfaces.size(); ++i)
+	{
+		surfaces[i].state = initialSurfaces[i].state;
+		surfaces[i].texels = initialSurfaces[i].texels;
+	}
+}
+
+void SoftCaptureReplay::Replay(SoftCommandQueue& queue)
+{
+	for (const Submission& submission : submissions)
+		queue.ExecuteCommandLists(static_cast<uint32_t>(submission.executeOrder.size()), submission.executeOrder.data());
+}
+
+size_t SoftCaptureReplay::CommandCount() const
+{
+	size_t count = 0;
+	for (const Submission& submission : submissions)
+	{
+		for (const std::unique_ptr<SoftCommandList>& list : submission.lists)
+			count += list->commands.size();
+	}
+	return count;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "soft_command.h"
+#include "soft_pipeline.h"
+#include "soft_surface.h"
+
+// Capture file layout, all values little endian:
+//   header:  "BDCP", uint32 version
+//   chunks:  uint8 tag followed by its payload
+// Resources (surfaces, buffers, pipeline descs) are written the first time a submission references them,
+// with their contents at that point, and are referred to by id afterwards.
+enum class SoftCaptureChunk : uint8_t
+{
+	Surface = 1,	// uint32 id, uint32 width, uint32 height, uint8 format, uint8 state, uint32 run count, runs of (uint32 length, uint32 texel)
+	Buffer,			// uint32 id, uint32 size, bytes
+	Pipeline,		// uint32 id, SoftPipelineDesc fields as uint8
+	Execute,		// uint32 list count, then per list: uint32 command count, commands
+	FrameEnd,
+	End,
+};
+
+// version 3 added the shading rate commands, version 2 files are still read
+const uint32_t kSoftCaptureVersion = 3;
+const uint32_t kSoftCaptureNull = 0xffffffff;
+
+// Records every command list a SoftCommandQueue executes while it is attached
+class SoftCaptureWriter
+{
+public:
+	~SoftCaptureWriter();
+
+	void Begin(const char* path);
+	void End();
+	bool IsActive() const { return file != nullptr; }
+
+	// called by the queue before the lists execute
+	void RecordExecute(uint32_t count, const SoftCommandList* const* lists);
+	void RecordFrameEnd();
+
+private:
+	FILE*													file = nullptr;
+	std::unordered_map<const SoftSurface*, uint32_t>		surfaceIds;
+	std::unordered_multimap<uint64_t, uint32_t>				bufferIds;		// keyed by content hash, colliding buffers share a key
+	// the contents each buffer id was written with, a hash match only reuses the id when they are the same
+	std::vector<std::vector<uint8_t>>						bufferContents;
+	std::unordered_map<const SoftPipelineState*, uint32_t>	pipelineIds;
+	// buffer ids resolved for the submission being written, in command order
+	std::vector<uint32_t>									pendingBufferIds;
+
+	uint32_t SurfaceId(const SoftSurface* surface);
+	uint32_t BufferId(const void* data, uint32_t size);
+	uint32_t PipelineId(const SoftPipelineState* state);
+	void WriteCommand(const SoftCommand& command, size_t& bufferCursor);
+	void WriteTexels(const SoftSurface& surface);
+	void Write(const void* data, size_t size);
+	template <class T> void Write(const T& value) { Write(&value, sizeof(T)); }
+};
+
+// Loads a capture and executes it without the scene, the window or user input
+class SoftCaptureReplay
+{
+public:
+	void Load(const char* path);
+	// restores every surface to its captured contents
+	void Reset();
+	void Replay(SoftCommandQueue& queue);
+
+	uint32_t FrameCount() const { return frameCount; }
+	size_t CommandCount() const;
+	const SoftSurface* LastRenderTarget() const { return lastRenderTarget; }
+
+private:
+	struct Submission
+	{
+		std::vector<std::unique_ptr<SoftCommandList>>	lists;
+		std::vector<const SoftCommandList*>				executeOrder;
+	};
+
+	SoftPipelineCache						pipelineCache;
+	std::deque<SoftSurface>					surfaces;
+	std::vector<SoftSurface>				initialSurfaces;
+	std::deque<std::vector<uint32_t>>		buffers;		// word sized so vertex data stays aligned
+	std::vector<uint32_t>					bufferSizes;
+	std::deque<std::vector<uint32_t>>		uploads;
+	std::vector<const SoftPipelineState*>	pipelines;
+	std::vector<Submission>					submissions;
+	uint32_t								frameCount = 0;
+	const SoftSurface*						lastRenderTarget = nullptr;
+};
@@ -0,0 +1,238 @@
+#include "soft_command.h"
+#include "soft_capture.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+void SoftCommandList::Reset(const SoftPipelineState* initialState)
+{
+	// keeps the capacity, so recording a frame like the last one does not allocate
+	commands.clear();
+	recording = true;
+	if (initialState)
+		SetPipelineState(initialState);
+}
+
+void SoftCommandList::Close()
+{
+	recording = false;
+}
+
+SoftCommand& SoftCommandList::Append(SoftCommandType type)
+{
+	assert(recording && "command list must be reset before recording");
+	commands.emplace_back();
+	SoftCommand& command = commands.back();
+	command.type = type;
+	return command;
+}
+
+void SoftCommandList::ResourceBarrier(SoftSurface* resource, SoftResourceState before, SoftResourceState after)
+{
+	SoftCommand& command = Append(SoftCommandType::ResourceBarrier);
+	command.barrier.resource = resource;
+	command.barrier.before = before;
+	command.barrier.after = after;
+}
+
+void SoftCommandList::UpdateSubresource(SoftSurface* target, const void* data)
+{
+	SoftCommand& command = Append(SoftCommandType::UpdateSubresource);
+	command.upload.target = target;
+	command.upload.data = data;
+}
+
+void SoftCommandList::OMSetRenderTargets(SoftSurface* color, SoftSurface* depth)
+{
+	SoftCommand& command = Append(SoftCommandType::SetRenderTargets);
+	command.renderTargets.color = color;
+	command.renderTargets.depth = depth;
+}
+
+void SoftCommandList::ClearRenderTargetView(SoftSurface* target, const float color[4])
+{
+	SoftCommand& command = Append(SoftCommandType::ClearRenderTarget);
+	command.clearColor.target = target;
+	for (int i = 0; i < 4; ++i)
+		command.clearColor.color[i] = color[i];
+}
+
+void SoftCommandList::ClearDepthStencilView(SoftSurface* target, float depth)
+{
+	SoftCommand& command = Append(SoftCommandType::ClearDepth);
+	command.clearDepth.target = target;
+	command.clearDepth.depth = depth;
+}
+
+void SoftCommandList::SetPipelineState(const SoftPipelineState* state)
+{
+	Append(SoftCommandType::SetPipelineState).pipelineState = state;
+}
+
+void SoftCommandList::SetTexture(const SoftSurface* texture)
+{
+	Append(SoftCommandType::SetTexture).texture = texture;
+}
+
+void SoftCommandList::SetWorldViewProj(const Mat4& worldViewProj)
+{
+	Append(SoftCommandType::SetWorldViewProj).worldViewProj = worldViewProj;
+}
+
+void SoftCommandList::IASetVertexBuffer(const void* data, uint32_t sizeInBytes, uint32_t stride)
+{
+	SoftCommand& command = Append(SoftCommandType::SetVertexBuffer);
+	command.vertexBuffer.data = data;
+	command.vertexBuffer.sizeInBytes = sizeInBytes;
+	command.vertexBuffer.stride = stride;
+}
+
+void SoftCommandList::IASetIndexBuffer(const uint32_t* data, uint32_t count)
+{
+	SoftCommand& command = Append(SoftCommandType::SetIndexBuffer);
+	command.indexBuffer.data = data;
+	command.indexBuffer.count = count;
+}
+
+void SoftCommandList::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+	SoftCommand& command = Append(SoftCommandType::Draw);
+	command.draw.vertexCount = vertexCount;
+	command.draw.startVertex = startVertex;
+}
+
+void SoftCommandList::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	SoftCommand& command = Append(SoftCommandType::DrawIndexed);
+	command.drawIndexed.indexCount = indexCount;
+	command.drawIndexed.startIndex = startIndex;
+	command.drawIndexed.baseVertex = baseVertex;
+}
+
+void SoftCommandList::RSSetShadingRate(SoftShadingRate rate)
+{
+	Append(SoftCommandType::SetShadingRate).shadingRate = rate;
+}
+
+void SoftCommandList::RSSetShadingRateImage(const SoftSurface* rateImage)
+{
+	Append(SoftCommandType::SetShadingRateImage).shadingRateImage = rateImage;
+}
+
+void SoftCommandQueue::ExecuteCommandLists(uint32_t count, const SoftCommandList* const* lists)
+{
+	if (capture && capture->IsActive())
+		capture->RecordExecute(count, lists);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		assert(!lists[i]->recording && "command list must be closed before it is executed");
+		Execute(*lists[i]);
+	}
+}
+
+void SoftCommandQueue::Execute(const SoftCommandList& list)
+{
+	// bound state does not carry over between command lists, same as d3d12
+	const SoftPipelineState* pipelineState = nullptr;
+	SoftSurface* colorTarget = nullptr;
+	SoftSurface* depthTarget = nullptr;
+	const SoftSurface* texture = nullptr;
+	SoftShadingRate shadingRate = SoftShadingRate::Rate1x1;
+	const SoftSurface* shadingRateImage = nullptr;
+	Mat4 worldViewProj = Mat4::Identity();
+	const uint8_t* vertices = nullptr;
+	uint32_t vertexCount = 0;
+	uint32_t vertexStride = 0;
+	const uint32_t* indices = nullptr;
+	uint32_t indexCount = 0;
+
+	for (const SoftCommand& command : list.commands)
+	{
+		switch (command.type)
+		{
+		case SoftCommandType::ResourceBarrier:
+			assert(command.barrier.resource->state == command.barrier.before && "resource barrier does not match the current state");
+			command.barrier.resource->state = command.barrier.after;
+			break;
+
+		case SoftCommandType::UpdateSubresource:
+		{
+			SoftSurface* target = command.upload.target;
+			memcpy(target->texels.data(), command.upload.data, target->SizeInBytes());
+		} break;
+
+		case SoftCommandType::SetRenderTargets:
+			colorTarget = command.renderTargets.color;
+			depthTarget = command.renderTargets.depth;
+			break;
+
+		case SoftCommandType::ClearRenderTarget:
+		{
+			const float* c = command.clearColor.color;
+			command.clearColor.target->Fill(PackColor(c[0], c[1], c[2], c[3]));
+		} break;
+
+		case SoftCommandType::ClearDepth:
+			command.clearDepth.target->Fill(FloatBits(command.clearDepth.depth));
+			break;
+
+		case SoftCommandType::SetPipelineState: pipelineState = command.pipelineState; break;
+		case SoftCommandType::SetTexture: texture = command.texture; break;
+		case SoftCommandType::SetWorldViewProj: worldViewProj = command.worldViewProj; break;
+		case SoftCommandType::SetShadingRate: shadingRate = command.shadingRate; break;
+		case SoftCommandType::SetShadingRateImage: shadingRateImage = command.shadingRateImage; break;
+
+		case SoftCommandType::SetVertexBuffer:
+			vertices = static_cast<const uint8_t*>(command.vertexBuffer.data);
+			vertexStride = command.vertexBuffer.stride;
+			vertexCount = vertexStride ? command.vertexBuffer.sizeInBytes / vertexStride : 0;
+			break;
+
+		case SoftCommandType::SetIndexBuffer:
+			indices = command.indexBuffer.data;
+			indexCount = command.indexBuffer.count;
+			break;
+
+		case SoftCommandType::Draw:
+		case SoftCommandType::DrawIndexed:
+		{
+			if (!pipelineState || !colorTarget || !vertices || vertexStride < pipelineState->vertexStride)
+				break;
+
+			SoftRasterContext ctx;
+			ctx.color = colorTarget->texels.data();
+			ctx.depth = depthTarget ? depthTarget->DepthRow(0) : nullptr;
+			ctx.pitch = colorTarget->width;
+			ctx.width = static_cast<int32_t>(colorTarget->width);
+			ctx.height = static_cast<int32_t>(colorTarget->height);
+			ctx.texture = texture;
+			ctx.shadingRate = shadingRate;
+			ctx.shadingRateImage = shadingRateImage;
+			if (depthTarget && (depthTarget->width != colorTarget->width || depthTarget->height != colorTarget->height))
+				ctx.depth = nullptr;
+
+			if (command.type == SoftCommandType::Draw)
+			{
+				uint32_t start = command.draw.startVertex;
+				if (start >= vertexCount)
+					break;
+				uint32_t count = (std::min)(command.draw.vertexCount, vertexCount - start);
+				rasterizer.DrawTriangles(*pipelineState, ctx, worldViewProj,
+					vertices + static_cast<size_t>(start) * vertexStride, vertexStride, count, nullptr, 0);
+			}
+			else
+			{
+				uint32_t start = command.drawIndexed.startIndex;
+				int32_t base = command.drawIndexed.baseVertex;
+				if (!indices || start >= indexCount || base < 0 || static_cast<uint32_t>(base) >= vertexCount)
+					break;
+				uint32_t count = (std::min)(command.drawIndexed.indexCount, indexCount - start);
+				rasterizer.DrawTriangles(*pipelineState, ctx, worldViewProj,
+					vertices + static_cast<size_t>(base) * vertexStride, vertexStride, vertexCount - base, indices + start, count);
+			}
+		} break;
+		}
+	}
+}
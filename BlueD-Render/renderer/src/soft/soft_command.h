@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "soft_pipeline.h"
+#include "soft_raster.h"
+#include "soft_surface.h"
+
+class SoftCaptureWriter;
+
+enum class SoftCommandType : uint8_t
+{
+	ResourceBarrier,
+	UpdateSubresource,
+	SetRenderTargets,
+	ClearRenderTarget,
+	ClearDepth,
+	SetPipelineState,
+	SetTexture,
+	SetWorldViewProj,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	Draw,
+	DrawIndexed,
+	SetShadingRate,
+	SetShadingRateImage,
+};
+
+// One recorded command. Resources are referenced, not copied, and must stay alive until the list is executed
+struct SoftCommand
+{
+	SoftCommandType type;
+	union
+	{
+		struct { SoftSurface* resource; SoftResourceState before, after; }			barrier;
+		struct { SoftSurface* target; const void* data; }							upload;
+		struct { SoftSurface* color; SoftSurface* depth; }							renderTargets;
+		struct { SoftSurface* target; float color[4]; }								clearColor;
+		struct { SoftSurface* target; float depth; }								clearDepth;
+		const SoftPipelineState*													pipelineState;
+		const SoftSurface*															texture;
+		Mat4																		worldViewProj;
+		struct { const void* data; uint32_t sizeInBytes; uint32_t stride; }		vertexBuffer;
+		struct { const uint32_t* data; uint32_t count; }							indexBuffer;
+		struct { uint32_t vertexCount; uint32_t startVertex; }						draw;
+		struct { uint32_t indexCount; uint32_t startIndex; int32_t baseVertex; }	drawIndexed;
+		SoftShadingRate																shadingRate;
+		const SoftSurface*															shadingRateImage;
+	};
+};
+
+// Records commands for the software path, mirroring ID3D12GraphicsCommandList
+class SoftCommandList
+{
+public:
+	std::vector<SoftCommand>	commands;
+	bool						recording = false;
+
+	// like ID3D12GraphicsCommandList::Reset, starts recording with an optional initial pipeline state
+	void Reset(const SoftPipelineState* initialState);
+	void Close();
+
+	void ResourceBarrier(SoftSurface* resource, SoftResourceState before, SoftResourceState after);
+	// copies a full surface worth of texels, data must stay alive until the list is executed
+	void UpdateSubresource(SoftSurface* target, const void* data);
+	void OMSetRenderTargets(SoftSurface* color, SoftSurface* depth);
+	void ClearRenderTargetView(SoftSurface* target, const float color[4]);
+	void ClearDepthStencilView(SoftSurface* target, float depth);
+	void SetPipelineState(const SoftPipelineState* state);
+	void SetTexture(const SoftSurface* texture);
+	void SetWorldViewProj(const Mat4& worldViewProj);
+	void IASetVertexBuffer(const void* data, uint32_t sizeInBytes, uint32_t stride);
+	void IASetIndexBuffer(const uint32_t* data, uint32_t count);
+	void Draw(uint32_t vertexCount, uint32_t startVertex);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	// like ID3D12GraphicsCommandList5, the rate of the following draws and a screen space rate image, null for none
+	void RSSetShadingRate(SoftShadingRate rate);
+	void RSSetShadingRateImage(const SoftSurface* rateImage);
+
+private:
+	SoftCommand& Append(SoftCommandType type);
+};
+
+// Executes closed command lists on the calling thread, mirroring ID3D12CommandQueue
+class SoftCommandQueue
+{
+public:
+	// when set, every submission is recorded before it executes
+	SoftCaptureWriter*	capture = nullptr;
+
+	void ExecuteCommandLists(uint32_t count, const SoftCommandList* const* lists);
+
+private:
+	SoftRasterizer	rasterizer;
+
+	void Execute(const SoftCommandList& list);
+};
@@ -0,0 +1,66 @@
+#include "soft_descriptors.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void DescriptorAllocator::Init(uint32_t persistent, uint32_t perFrame, uint32_t frames)
+{
+	persistentCount = persistent;
+	perFrameCount = perFrame;
+	frameCount = frames ? frames : 1;
+	// popped from the back, so handles are handed out in ascending order
+	freeList.resize(persistentCount);
+	for (uint32_t i = 0; i < persistentCount; ++i)
+		freeList[i] = persistentCount - 1 - i;
+	allocated.assign(persistentCount, false);
+	currentSlot = 0;
+	frameUsed = 0;
+	slotFenceValues.assign(frameCount, 0);
+	stats = DescriptorAllocatorStats();
+}
+
+uint32_t DescriptorAllocator::AllocatePersistent()
+{
+	if (freeList.empty())
+		throw std::runtime_error("descriptor heap: persistent region exhausted");
+	uint32_t index = freeList.back();
+	freeList.pop_back();
+	allocated[index] = true;
+	++stats.persistentInUse;
+	stats.persistentHighWater = (std::max)(stats.persistentHighWater, stats.persistentInUse);
+	return index;
+}
+
+void DescriptorAllocator::FreePersistent(uint32_t index)
+{
+	if (index >= persistentCount || !allocated[index])
+		throw std::logic_error("descriptor heap: freeing a handle that is not allocated");
+	allocated[index] = false;
+	freeList.push_back(index);
+	--stats.persistentInUse;
+}
+
+uint32_t DescriptorAllocator::AllocateFrame(uint32_t count)
+{
+	if (frameUsed + count > perFrameCount)
+		throw std::runtime_error("descriptor heap: frame region exhausted");
+	uint32_t index = FrameRegionStart(currentSlot) + frameUsed;
+	frameUsed += count;
+	stats.frameHighWater = (std::max)(stats.frameHighWater, frameUsed);
+	return index;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t slot, uint64_t completedFenceValue)
+{
+	if (slot >= frameCount)
+		throw std::logic_error("descriptor heap: frame slot out of range");
+	if (slotFenceValues[slot] > completedFenceValue)
+		throw std::logic_error("descriptor heap: frame slot reused before the gpu finished with it");
+	currentSlot = slot;
+	frameUsed = 0;
+}
+
+void DescriptorAllocator::EndFrame(uint64_t fenceValue)
+{
+	slotFenceValues[currentSlot] = fenceValue;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct DescriptorAllocatorStats
+{
+	uint32_t	persistentInUse = 0;
+	uint32_t	persistentHighWater = 0;
+	uint32_t	frameHighWater = 0;		// the most handles one frame took from its region
+};
+
+// Hands out indices into a descriptor heap without touching a device. The heap is split into a persistent region,
+// handed out and returned one handle at a time through a free list, and one linear region per frame slot for
+// bindings that only live for a frame. A slot's region is reused wholesale once the fence passed its last frame.
+//
+//     [ persistent | slot 0 | slot 1 | ... ]
+class DescriptorAllocator
+{
+public:
+	void Init(uint32_t persistentCount, uint32_t perFrameCount, uint32_t frameCount);
+
+	// throws when the persistent region is exhausted
+	uint32_t AllocatePersistent();
+	void FreePersistent(uint32_t index);
+
+	// count contiguous handles that stay valid until the current frame has finished on the gpu
+	uint32_t AllocateFrame(uint32_t count);
+	// starts recording into slot, the fence must have passed the frame that used the slot last
+	void BeginFrame(uint32_t slot, uint64_t completedFenceValue);
+	// the frame's handles are in use until the fence reaches fenceValue
+	void EndFrame(uint64_t fenceValue);
+
+	uint32_t Capacity() const { return persistentCount + perFrameCount * frameCount; }
+	uint32_t FrameRegionStart(uint32_t slot) const { return persistentCount + slot * perFrameCount; }
+	const DescriptorAllocatorStats& GetStats() const { return stats; }
+
+private:
+	uint32_t					persistentCount = 0;
+	uint32_t					perFrameCount = 0;
+	uint32_t					frameCount = 0;
+	std::vector<uint32_t>		freeList;
+	std::vector<bool>			allocated;
+	uint32_t					currentSlot = 0;
+	uint32_t					frameUsed = 0;
+	std::vector<uint64_t>		slotFenceValues;
+	DescriptorAllocatorStats	stats;
+};
@@ -0,0 +1,260 @@
+#include "soft_export.h"
+
+#include <exception>
+#include <stdexcept>
+
+SoftFrameExporter::SoftFrameExporter(uint32_t threadCount, uint32_t maxFramesInFlight)
+	: pool(threadCount), maxFramesInFlight(maxFramesInFlight ? maxFramesInFlight : 1)
+{
+}
+
+SoftFrameExporter::~SoftFrameExporter()
+{
+	pool.Wait();
+}
+
+void SoftFrameExporter::Start(const char* pattern, SoftImageFormat imageFormat)
+{
+	Flush();
+	Reset();
+	pathPattern = pattern;
+	format = imageFormat;
+}
+
+void SoftFrameExporter::StartStream(FILE* outStream, SoftImageFormat imageFormat, uint32_t fps)
+{
+	Flush();
+	Reset();
+	stream = outStream;
+	format = imageFormat;
+	framesPerSecond = fps ? fps : 1;
+}
+
+void SoftFrameExporter::Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pathPattern.clear();
+	stream = nullptr;
+	framesWritten = 0;
+	bytesWritten = 0;
+	nextSequence = 0;
+	nextWrite = 0;
+	streamWidth = 0;
+	streamHeight = 0;
+}
+
+void SoftFrameExporter::Submit(SoftSurface&& frame, uint32_t frameNumber)
+{
+	if (frame.format != SoftFormat::R8G8B8A8_UNORM)
+		throw std::runtime_error("only color surfaces can be exported");
+	if (pathPattern.empty() && !stream)
+		throw std::runtime_error("frame exporter was not started");
+
+	std::vector<uint8_t> encoded;
+	uint32_t sequence;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		frameDone.wait(lock, [this] { return framesInFlight < maxFramesInFlight; });
+		if (!error.empty())
+		{
+			lock.unlock();
+			ThrowPendingError();
+		}
+		++framesInFlight;
+		sequence = nextSequence++;
+		if (!freeBuffers.empty())
+		{
+			encoded = std::move(freeBuffers.back());
+			freeBuffers.pop_back();
+		}
+	}
+
+	pool.Submit([this, frameNumber, sequence, frame = std::move(frame), encoded = std::move(encoded)]() mutable
+	{
+		std::string failure;
+		try
+		{
+			encoded.clear();
+			EncodeImage(format, frame, encoded);
+			if (!stream)
+				WriteFile(encoded, frameNumber);
+		}
+		catch (const std::exception& e)
+		{
+			failure = e.what();
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!failure.empty() && error.empty())
+			error = failure;
+
+		if (stream)
+		{
+			// an encode failure still takes its turn so the frames after it are not held back
+			EncodedFrame ready = { sequence, frame.width, frame.height, std::move(encoded) };
+			if (!failure.empty())
+				ready.data.clear();
+			readyFrames.push_back(std::move(ready));
+		}
+		else
+		{
+			if (failure.empty())
+			{
+				++framesWritten;
+				bytesWritten += encoded.size();
+			}
+			freeBuffers.push_back(std::move(encoded));
+			--framesInFlight;
+		}
+		freeSurfaces.push_back(std::move(frame));
+		// one worker writes the stream at a time, frames that become ready meanwhile are left to it
+		if (stream && !writing)
+			WriteReadyFrames(lock);
+		frameDone.notify_all();
+	});
+}
+
+SoftSurface SoftFrameExporter::AcquireSurface(uint32_t width, uint32_t height, SoftFormat surfaceFormat)
+{
+	SoftSurface surface;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!freeSurfaces.empty())
+		{
+			surface = std::move(freeSurfaces.back());
+			freeSurfaces.pop_back();
+		}
+	}
+	surface.state = SoftResourceState::Common;
+	surface.Resize(width, height, surfaceFormat);
+	return surface;
+}
+
+void SoftFrameExporter::Flush()
+{
+	pool.Wait();
+	if (stream)
+		fflush(stream);
+	ThrowPendingError();
+}
+
+uint32_t SoftFrameExporter::FramesWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return framesWritten;
+}
+
+uint64_t SoftFrameExporter::BytesWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return bytesWritten;
+}
+
+void SoftFrameExporter::WriteFile(const std::vector<uint8_t>& encoded, uint32_t frameNumber)
+{
+	char path[512];
+	int length = snprintf(path, sizeof(path), pathPattern.c_str(), frameNumber);
+	if (length < 0 || static_cast<size_t>(length) + 6 >= sizeof(path))
+		throw std::runtime_error("export path is too long");
+	snprintf(path + length, sizeof(path) - length, ".%s", GetImageExtension(format));
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		throw std::runtime_error(std::string("failed to open ") + path);
+	size_t written = fwrite(encoded.data(), 1, encoded.size(), file);
+	fclose(file);
+	if (written != encoded.size())
+		throw std::runtime_error(std::string("failed to write ") + path);
+}
+
+void SoftFrameExporter::WriteReadyFrames(std::unique_lock<std::mutex>& lock)
+{
+	writing = true;
+	for (;;)
+	{
+		// takes every frame that is next in order, the writes happen without the lock so encoders can finish meanwhile
+		for (;;)
+		{
+			size_t index = 0;
+			while (index < readyFrames.size() && readyFrames[index].sequence != nextWrite)
+				++index;
+			if (index == readyFrames.size())
+				break;
+			writeBatch.push_back(std::move(readyFrames[index]));
+			readyFrames[index] = std::move(readyFrames.back());
+			readyFrames.pop_back();
+			++nextWrite;
+		}
+		if (writeBatch.empty())
+			break;
+
+		// after an error the frames are only given back
+		std::string failure;
+		uint32_t written = 0;
+		uint64_t bytes = 0;
+		const bool skip = !error.empty();
+		lock.unlock();
+		for (size_t i = 0; i < writeBatch.size() && !skip && failure.empty(); ++i)
+		{
+			try
+			{
+				WriteStreamFrame(writeBatch[i]);
+				++written;
+				bytes += writeBatch[i].data.size();
+			}
+			catch (const std::exception& e)
+			{
+				failure = e.what();
+			}
+		}
+		lock.lock();
+
+		if (!failure.empty() && error.empty())
+			error = failure;
+		framesWritten += written;
+		bytesWritten += bytes;
+		framesInFlight -= static_cast<uint32_t>(writeBatch.size());
+		for (EncodedFrame& frame : writeBatch)
+			freeBuffers.push_back(std::move(frame.data));
+		writeBatch.clear();
+		frameDone.notify_all();
+	}
+	writing = false;
+}
+
+void SoftFrameExporter::WriteStreamFrame(const EncodedFrame& frame)
+{
+	if (format == SoftImageFormat::Yuv420)
+	{
+		if (frame.sequence == 0)
+		{
+			streamWidth = frame.width;
+			streamHeight = frame.height;
+			char header[128];
+			int length = snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+				frame.width, frame.height, framesPerSecond);
+			WriteStream(header, static_cast<size_t>(length));
+		}
+		if (frame.width != streamWidth || frame.height != streamHeight)
+			throw std::runtime_error("YUV4MPEG2 streams cannot change size");
+		WriteStream("FRAME\n", 6);
+	}
+	WriteStream(frame.data.data(), frame.data.size());
+}
+
+void SoftFrameExporter::WriteStream(const void* data, size_t size)
+{
+	if (fwrite(data, 1, size, stream) != size)
+		throw std::runtime_error("failed to write to the output stream");
+}
+
+void SoftFrameExporter::ThrowPendingError()
+{
+	std::string pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.swap(error);
+	}
+	if (!pending.empty())
+		throw std::runtime_error(pending);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "soft_image.h"
+#include "soft_jobs.h"
+#include "soft_surface.h"
+
+// Writes finished frames on worker threads. Frames are handed over by move and their storage
+// is given back through AcquireSurface once written, so a steady export does not allocate or copy.
+class SoftFrameExporter
+{
+public:
+	// threadCount 0 uses every hardware thread, maxFramesInFlight bounds the frames queued or being written
+	explicit SoftFrameExporter(uint32_t threadCount = 0, uint32_t maxFramesInFlight = 4);
+	~SoftFrameExporter();
+	SoftFrameExporter(const SoftFrameExporter&) = delete;
+	SoftFrameExporter& operator=(const SoftFrameExporter&) = delete;
+
+	// one file per frame, pathPattern is a printf pattern taking the frame number, e.g. "frames/frame_%05u",
+	// the extension is appended
+	void Start(const char* pathPattern, SoftImageFormat format);
+	// appends the frames to an open stream in submission order, the stream stays owned by the caller.
+	// Yuv420 streams are written as YUV4MPEG2 at the given frame rate.
+	void StartStream(FILE* stream, SoftImageFormat format, uint32_t framesPerSecond);
+	// blocks only while maxFramesInFlight frames are still being written
+	void Submit(SoftSurface&& frame, uint32_t frameNumber);
+	// a surface for the next frame, reusing the storage of frames that have been written
+	SoftSurface AcquireSurface(uint32_t width, uint32_t height, SoftFormat format);
+	// waits for every submitted frame, throws the first write error
+	void Flush();
+
+	uint32_t FramesWritten() const;
+	uint64_t BytesWritten() const;
+
+private:
+	struct EncodedFrame
+	{
+		uint32_t				sequence;
+		uint32_t				width;
+		uint32_t				height;
+		std::vector<uint8_t>	data;
+	};
+
+	SoftThreadPool							pool;
+	std::string								pathPattern;
+	FILE*									stream = nullptr;
+	uint32_t								framesPerSecond = 0;
+	SoftImageFormat							format = SoftImageFormat::Png;
+	uint32_t								maxFramesInFlight;
+
+	mutable std::mutex						mutex;
+	std::condition_variable					frameDone;
+	uint32_t								framesInFlight = 0;
+	uint32_t								framesWritten = 0;
+	uint64_t								bytesWritten = 0;
+	std::string								error;
+	std::vector<SoftSurface>				freeSurfaces;
+	std::vector<std::vector<uint8_t>>		freeBuffers;
+
+	// stream mode, frames finish encoding out of order and are written once their predecessors are
+	uint32_t								nextSequence = 0;
+	uint32_t								nextWrite = 0;
+	uint32_t								streamWidth = 0;
+	uint32_t								streamHeight = 0;
+	std::vector<EncodedFrame>				readyFrames;
+	// set while a worker writes ready frames without the mutex, the others leave theirs to it
+	bool									writing = false;
+	std::vector<EncodedFrame>				writeBatch;
+
+	void Reset();
+	void WriteFile(const std::vector<uint8_t>& encoded, uint32_t frameNumber);
+	// called with the mutex held, releases it while the frames are written
+	void WriteReadyFrames(std::unique_lock<std::mutex>& lock);
+	void WriteStreamFrame(const EncodedFrame& frame);
+	void WriteStream(const void* data, size_t size);
+	void ThrowPendingError();
+};
@@ -0,0 +1,65 @@
+#include "soft_fence.h"
+
+#include <chrono>
+
+void SoftTimelineFence::Wait(uint64_t value)
+{
+	if (GetCompletedValue() >= value)
+		return;
+	std::unique_lock<std::mutex> lock(mutex);
+	signaled.wait(lock, [this, value] { return GetCompletedValue() >= value; });
+}
+
+bool SoftTimelineFence::WaitFor(uint64_t value, uint32_t timeoutMs)
+{
+	if (GetCompletedValue() >= value)
+		return true;
+	std::unique_lock<std::mutex> lock(mutex);
+	return signaled.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, value] { return GetCompletedValue() >= value; });
+}
+
+void SoftTimelineFence::Signal(uint64_t value)
+{
+	{
+		// the store happens under the lock so a waiter cannot miss it between its check and its wait
+		std::lock_guard<std::mutex> lock(mutex);
+		if (value <= completedValue.load(std::memory_order_relaxed))
+			return;
+		completedValue.store(value, std::memory_order_release);
+	}
+	signaled.notify_all();
+}
+
+void FrameScheduler::Init(TimelineFence* timelineFence, uint32_t maxFramesInFlight)
+{
+	fence = timelineFence;
+	framesInFlight = maxFramesInFlight ? maxFramesInFlight : 1;
+	frameNumber = fence ? fence->GetCompletedValue() : 0;
+	stalledFrames = 0;
+}
+
+uint32_t FrameScheduler::BeginFrame()
+{
+	// frame n may start once frame n - framesInFlight, which signals n - framesInFlight + 1, is done
+	if (frameNumber >= framesInFlight)
+	{
+		uint64_t value = frameNumber - framesInFlight + 1;
+		if (fence->GetCompletedValue() < value)
+		{
+			++stalledFrames;
+			fence->Wait(value);
+		}
+	}
+	return CurrentSlot();
+}
+
+uint64_t FrameScheduler::EndFrame()
+{
+	return ++frameNumber;
+}
+
+void FrameScheduler::WaitIdle()
+{
+	if (fence && frameNumber > 0)
+		fence->Wait(frameNumber);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// A monotonic 64 bit counter that a queue signals and the CPU waits on, like ID3D12Fence
+class TimelineFence
+{
+public:
+	virtual ~TimelineFence() = default;
+	virtual uint64_t GetCompletedValue() const = 0;
+	// blocks until the completed value has reached value
+	virtual void Wait(uint64_t value) = 0;
+};
+
+// Timeline fence in system memory, signaled by CPU threads
+class SoftTimelineFence : public TimelineFence
+{
+public:
+	uint64_t GetCompletedValue() const override { return completedValue.load(std::memory_order_acquire); }
+	void Wait(uint64_t value) override;
+	// false when the value was not reached within timeoutMs
+	bool WaitFor(uint64_t value, uint32_t timeoutMs);
+	// values never go backwards, signaling a lower value than the completed one is ignored
+	void Signal(uint64_t value);
+
+private:
+	std::atomic<uint64_t>		completedValue{ 0 };
+	std::mutex					mutex;
+	std::condition_variable		signaled;
+};
+
+// Keeps at most framesInFlight frames queued ahead of the timeline fence.
+// Frame n signals n + 1 when its work is done, so its per frame resources live in slot n % framesInFlight
+// and can be reused once frame n - framesInFlight has been signaled.
+class FrameScheduler
+{
+public:
+	void Init(TimelineFence* timelineFence, uint32_t maxFramesInFlight);
+
+	// blocks only while framesInFlight frames are still unfinished, returns the slot of the new frame
+	uint32_t BeginFrame();
+	// the value the queue has to signal once the work of the current frame is done
+	uint64_t EndFrame();
+	// blocks until every ended frame has been signaled
+	void WaitIdle();
+
+	uint32_t FramesInFlight() const { return framesInFlight; }
+	uint32_t CurrentSlot() const { return static_cast<uint32_t>(frameNumber % framesInFlight); }
+	uint64_t FrameNumber() const { return frameNumber; }
+	// frames whose BeginFrame had to wait for the fence
+	uint64_t StalledFrames() const { return stalledFrames; }
+
+private:
+	TimelineFence*		fence = nullptr;
+	uint32_t			framesInFlight = 1;
+	uint64_t			frameNumber = 0;
+	uint64_t			stalledFrames = 0;
+};
@@ -0,0 +1,305 @@
+#include "soft_graph.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+void RenderGraph::Reset(FrameArena* frameArena)
+{
+	// moving in empty containers drops the previous frame's storage and rebinds them to the new arena
+	arena = frameArena;
+	passes = ArenaVector<Pass>(ArenaAllocator<Pass>(arena));
+	resources = ArenaVector<Resource>(ArenaAllocator<Resource>(arena));
+	slotDescs = ArenaVector<RenderGraphTextureDesc>(ArenaAllocator<RenderGraphTextureDesc>(arena));
+	finalBarriers = ArenaVector<RenderGraphBarrier>(ArenaAllocator<RenderGraphBarrier>(arena));
+	stats = RenderGraphStats();
+	compiled = false;
+}
+
+RenderGraphResource RenderGraph::Import(const char* name, SoftResourceState initialState, SoftResourceState finalState)
+{
+	Resource resource;
+	resource.name = name;
+	resource.initialState = initialState;
+	resource.finalState = finalState;
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateTransient(const char* name, const RenderGraphTextureDesc& desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.transient = true;
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(const char* name, std::function<void()> execute)
+{
+	passes.emplace_back();
+	passes.back().name = name;
+	passes.back().accesses = ArenaVector<Access>(ArenaAllocator<Access>(arena));
+	passes.back().barriers = ArenaVector<RenderGraphBarrier>(ArenaAllocator<RenderGraphBarrier>(arena));
+	passes.back().execute = std::move(execute);
+	compiled = false;
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::Read(uint32_t pass, RenderGraphResource resource, SoftResourceState state)
+{
+	AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(uint32_t pass, RenderGraphResource resource, SoftResourceState state)
+{
+	AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::KeepAlive(uint32_t pass)
+{
+	passes[pass].keepAlive = true;
+}
+
+void RenderGraph::AddAccess(uint32_t pass, RenderGraphResource resource, SoftResourceState state, bool write)
+{
+	for (Access& access : passes[pass].accesses)
+	{
+		if (access.resource != resource)
+			continue;
+		// a resource is in exactly one state for the whole pass
+		if (access.state != state)
+			throw std::runtime_error(std::string("render graph: pass ") + passes[pass].name + " uses " + resources[resource].name + " in two states");
+		access.write = access.write || write;
+		return;
+	}
+	passes[pass].accesses.push_back({ resource, state, write });
+	compiled = false;
+}
+
+void RenderGraph::Compile()
+{
+	for (Resource& resource : resources)
+	{
+		resource.used = false;
+		resource.aliasSlot = kInvalidGraphResource;
+	}
+	slotDescs.clear();
+	finalBarriers.clear();
+	stats = RenderGraphStats();
+	stats.passes = static_cast<uint32_t>(passes.size());
+
+	CullPasses();
+	AssignAliasSlots();
+	DeriveBarriers();
+	compiled = true;
+}
+
+void RenderGraph::CullPasses()
+{
+	// walk backwards, a pass survives when it writes something a surviving later pass reads,
+	// writes an imported resource or was marked to keep
+	ArenaVector<bool> needed(resources.size(), false, ArenaAllocator<bool>(arena));
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		Pass& pass = passes[i];
+		bool alive = pass.keepAlive;
+		for (const Access& access : pass.accesses)
+		{
+			if (access.write && (!resources[access.resource].transient || needed[access.resource]))
+				alive = true;
+		}
+		pass.culled = !alive;
+		if (!alive)
+		{
+			++stats.culledPasses;
+			continue;
+		}
+		for (const Access& access : pass.accesses)
+		{
+			if (!access.write)
+				needed[access.resource] = true;
+		}
+	}
+
+	for (uint32_t i = 0; i < passes.size(); ++i)
+	{
+		if (passes[i].culled)
+			continue;
+		for (const Access& access : passes[i].accesses)
+		{
+			Resource& resource = resources[access.resource];
+			if (resource.transient && !resource.used && !access.write)
+				throw std::runtime_error(std::string("render graph: pass ") + passes[i].name + " reads " + resource.name + " before it was written");
+			if (!resource.used)
+				resource.firstPass = i;
+			resource.lastPass = i;
+			resource.used = true;
+		}
+	}
+}
+
+void RenderGraph::AssignAliasSlots()
+{
+	ArenaVector<RenderGraphResource> transients{ ArenaAllocator<RenderGraphResource>(arena) };
+	for (RenderGraphResource i = 0; i < resources.size(); ++i)
+	{
+		if (resources[i].transient && resources[i].used)
+			transients.push_back(i);
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+	{
+		return resources[a].firstPass < resources[b].firstPass;
+	});
+
+	// a slot is free again after the last pass of its current occupant, only identical descs share one
+	ArenaVector<uint32_t> slotLastPass{ ArenaAllocator<uint32_t>(arena) };
+	for (RenderGraphResource index : transients)
+	{
+		Resource& resource = resources[index];
+		size_t bytes = static_cast<size_t>(resource.desc.width) * resource.desc.height * sizeof(uint32_t);
+		stats.transientBytes += bytes;
+
+		for (uint32_t slot = 0; slot < slotDescs.size(); ++slot)
+		{
+			const RenderGraphTextureDesc& desc = slotDescs[slot];
+			if (slotLastPass[slot] < resource.firstPass && desc.width == resource.desc.width && desc.height == resource.desc.height && desc.format == resource.desc.format)
+			{
+				resource.aliasSlot = slot;
+				break;
+			}
+		}
+		if (resource.aliasSlot == kInvalidGraphResource)
+		{
+			resource.aliasSlot = static_cast<uint32_t>(slotDescs.size());
+			slotDescs.push_back(resource.desc);
+			slotLastPass.push_back(0);
+			stats.aliasedBytes += bytes;
+		}
+		slotLastPass[resource.aliasSlot] = resource.lastPass;
+	}
+}
+
+void RenderGraph::DeriveBarriers()
+{
+	// transients take the state of their slot, slots start out in common with undefined contents
+	ArenaVector<SoftResourceState> states(resources.size(), SoftResourceState::Common, ArenaAllocator<SoftResourceState>(arena));
+	for (RenderGraphResource i = 0; i < resources.size(); ++i)
+		states[i] = resources[i].initialState;
+	ArenaVector<SoftResourceState> slotStates(slotDescs.size(), SoftResourceState::Common, ArenaAllocator<SoftResourceState>(arena));
+	ArenaVector<RenderGraphResource> slotOccupants(slotDescs.size(), kInvalidGraphResource, ArenaAllocator<RenderGraphResource>(arena));
+
+	for (uint32_t i = 0; i < passes.size(); ++i)
+	{
+		Pass& pass = passes[i];
+		pass.barriers.clear();
+		if (pass.culled)
+			continue;
+
+		for (const Access& access : pass.accesses)
+		{
+			const Resource& resource = resources[access.resource];
+			if (resource.transient)
+			{
+				uint32_t slot = resource.aliasSlot;
+				RenderGraphResource aliasedFrom = kInvalidGraphResource;
+				if (resource.firstPass == i)
+				{
+					aliasedFrom = slotOccupants[slot];
+					slotOccupants[slot] = access.resource;
+				}
+				if (slotStates[slot] != access.state || aliasedFrom != kInvalidGraphResource)
+					pass.barriers.push_back({ access.resource, aliasedFrom, slotStates[slot], access.state });
+				slotStates[slot] = access.state;
+			}
+			else if (states[access.resource] != access.state)
+			{
+				pass.barriers.push_back({ access.resource, kInvalidGraphResource, states[access.resource], access.state });
+				states[access.resource] = access.state;
+			}
+		}
+		stats.barriers += static_cast<uint32_t>(pass.barriers.size());
+	}
+
+	for (RenderGraphResource i = 0; i < resources.size(); ++i)
+	{
+		if (!resources[i].transient && states[i] != resources[i].finalState)
+			finalBarriers.push_back({ i, kInvalidGraphResource, states[i], resources[i].finalState });
+	}
+	// slots end the frame in common again so the next frame can start from there, whatever aliases into them
+	for (uint32_t slot = 0; slot < slotDescs.size(); ++slot)
+	{
+		if (slotStates[slot] != SoftResourceState::Common)
+			finalBarriers.push_back({ slotOccupants[slot], kInvalidGraphResource, slotStates[slot], SoftResourceState::Common });
+	}
+	stats.barriers += static_cast<uint32_t>(finalBarriers.size());
+}
+
+void RenderGraph::Execute(const std::function<void(const RenderGraphBarrier*, size_t)>& barriers)
+{
+	if (!compiled)
+		Compile();
+
+	for (Pass& pass : passes)
+	{
+		if (pass.culled)
+			continue;
+		if (!pass.barriers.empty())
+			barriers(pass.barriers.data(), pass.barriers.size());
+		if (pass.execute)
+			pass.execute();
+	}
+	if (!finalBarriers.empty())
+		barriers(finalBarriers.data(), finalBarriers.size());
+}
+
+void SoftGraphSurfaces::Bind(RenderGraphResource resource, SoftSurface* surface)
+{
+	if (bound.size() <= resource)
+		bound.resize(resource + 1, nullptr);
+	bound[resource] = surface;
+}
+
+void SoftGraphSurfaces::Realize(const RenderGraph& graph)
+{
+	uint32_t slotCount = graph.GetAliasSlotCount();
+	while (slots.size() < slotCount)
+		slots.emplace_back(new SoftSurface());
+	for (uint32_t slot = 0; slot < slotCount; ++slot)
+	{
+		const RenderGraphTextureDesc& desc = graph.GetAliasSlotDesc(slot);
+		SoftSurface& surface = *slots[slot];
+		if (surface.width == desc.width && surface.height == desc.height && surface.format == desc.format)
+			continue;
+		if (!pool)
+		{
+			surface.Resize(desc.width, desc.height, desc.format);
+			continue;
+		}
+		// slots are in common between frames, so that is the state they go into the pool and come out in
+		if (!surface.texels.empty())
+			pool->Release({ surface.width, surface.height, static_cast<uint32_t>(surface.format) }, std::move(surface));
+		surface = SoftSurface();
+		if (!pool->Acquire({ desc.width, desc.height, static_cast<uint32_t>(desc.format) }, surface))
+			surface.Resize(desc.width, desc.height, desc.format);
+	}
+
+	if (bound.size() < graph.GetResourceCount())
+		bound.resize(graph.GetResourceCount(), nullptr);
+	for (RenderGraphResource resource = 0; resource < graph.GetResourceCount(); ++resource)
+	{
+		if (graph.IsTransient(resource))
+			bound[resource] = graph.GetAliasSlot(resource) != kInvalidGraphResource ? slots[graph.GetAliasSlot(resource)].get() : nullptr;
+	}
+}
+
+void SoftGraphSurfaces::RecordBarriers(SoftCommandList& commandList, const RenderGraphBarrier* barriers, size_t count) const
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		// aliasing needs no extra work in system memory, only the state change is recorded
+		if (barriers[i].before != barriers[i].after)
+			commandList.ResourceBarrier(bound[barriers[i].resource], barriers[i].before, barriers[i].after);
+	}
+}
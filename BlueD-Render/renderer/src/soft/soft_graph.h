@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "soft_arena.h"
+#include "soft_command.h"
+#include "soft_pool.h"
+#include "soft_surface.h"
+
+typedef uint32_t RenderGraphResource;
+const RenderGraphResource kInvalidGraphResource = 0xffffffffu;
+
+struct RenderGraphTextureDesc
+{
+	uint32_t		width = 0;
+	uint32_t		height = 0;
+	SoftFormat		format = SoftFormat::Unknown;
+};
+
+// A state change derived by the graph. aliasedFrom is set when the resource takes over memory
+// another transient used before it, its contents are undefined then.
+struct RenderGraphBarrier
+{
+	RenderGraphResource		resource;
+	RenderGraphResource		aliasedFrom;
+	SoftResourceState		before;
+	SoftResourceState		after;
+};
+
+struct RenderGraphStats
+{
+	uint32_t	passes = 0;
+	uint32_t	culledPasses = 0;
+	uint32_t	barriers = 0;
+	size_t		transientBytes = 0;		// what the transients would take without aliasing
+	size_t		aliasedBytes = 0;		// what they take with it
+};
+
+// Passes are declared in execution order together with the resources they read and write.
+// Compile culls passes whose output nobody uses, derives the transitions between them and lets transient
+// targets with disjoint lifetimes share memory. The states mirror D3D12_RESOURCE_STATES, so the graph
+// drives both the software and the d3d path.
+class RenderGraph
+{
+public:
+	// forgets every pass and resource. With an arena the frame's passes, resources and barriers are allocated
+	// from it, the graph has to be reset again before that arena is
+	void Reset(FrameArena* frameArena = nullptr);
+
+	// names are not copied and have to outlive the frame, string literals do
+	// a resource owned outside the graph, it is in initialState before the first pass and is left in finalState
+	RenderGraphResource Import(const char* name, SoftResourceState initialState, SoftResourceState finalState);
+	// a target that only lives within the frame, its contents are undefined before its first write
+	RenderGraphResource CreateTransient(const char* name, const RenderGraphTextureDesc& desc);
+
+	uint32_t AddPass(const char* name, std::function<void()> execute);
+	void Read(uint32_t pass, RenderGraphResource resource, SoftResourceState state = SoftResourceState::ShaderResource);
+	void Write(uint32_t pass, RenderGraphResource resource, SoftResourceState state = SoftResourceState::RenderTarget);
+	// the pass has effects the graph cannot see, like uploads or presenting, and is never culled
+	void KeepAlive(uint32_t pass);
+
+	void Compile();
+	// runs the surviving passes in order, barriers is called before each of them with the transitions it needs
+	// and once at the end with the transitions of the imported resources into their final states.
+	// Alias slots start and end every frame in the common state.
+	void Execute(const std::function<void(const RenderGraphBarrier*, size_t)>& barriers);
+
+	uint32_t GetResourceCount() const { return static_cast<uint32_t>(resources.size()); }
+	bool IsCulled(uint32_t pass) const { return passes[pass].culled; }
+	bool IsTransient(RenderGraphResource resource) const { return resources[resource].transient; }
+	const RenderGraphTextureDesc& GetDesc(RenderGraphResource resource) const { return resources[resource].desc; }
+	// transients in the same slot share memory, kInvalidGraphResource for imported and unused resources
+	uint32_t GetAliasSlot(RenderGraphResource resource) const { return resources[resource].aliasSlot; }
+	uint32_t GetAliasSlotCount() const { return static_cast<uint32_t>(slotDescs.size()); }
+	const RenderGraphTextureDesc& GetAliasSlotDesc(uint32_t slot) const { return slotDescs[slot]; }
+	const RenderGraphStats& GetStats() const { return stats; }
+
+private:
+	struct Access
+	{
+		RenderGraphResource		resource;
+		SoftResourceState		state;
+		bool					write;
+	};
+
+	struct Pass
+	{
+		const char*							name = "";
+		std::function<void()>				execute;
+		ArenaVector<Access>					accesses;
+		ArenaVector<RenderGraphBarrier>		barriers;
+		bool								keepAlive = false;
+		bool								culled = false;
+	};
+
+	struct Resource
+	{
+		const char*					name = "";
+		RenderGraphTextureDesc		desc;
+		bool						transient = false;
+		SoftResourceState			initialState = SoftResourceState::Common;
+		SoftResourceState			finalState = SoftResourceState::Common;
+		uint32_t					firstPass = 0;
+		uint32_t					lastPass = 0;
+		bool						used = false;
+		uint32_t					aliasSlot = kInvalidGraphResource;
+	};
+
+	FrameArena*							arena = nullptr;
+	ArenaVector<Pass>					passes;
+	ArenaVector<Resource>				resources;
+	ArenaVector<RenderGraphTextureDesc>	slotDescs;
+	ArenaVector<RenderGraphBarrier>		finalBarriers;
+	RenderGraphStats					stats;
+	bool								compiled = false;
+
+	void AddAccess(uint32_t pass, RenderGraphResource resource, SoftResourceState state, bool write);
+	void CullPasses();
+	void AssignAliasSlots();
+	void DeriveBarriers();
+};
+
+// Backs the resources of a compiled graph with software surfaces, transients in one alias slot share a surface
+class SoftGraphSurfaces
+{
+public:
+	// when set, slot surfaces come from and go back to this pool as the graph changes shape
+	RenderTargetPool<SoftSurface>*	pool = nullptr;
+
+	void Bind(RenderGraphResource resource, SoftSurface* surface);
+	// sizes the alias slot surfaces and binds the transients of the graph to them, imported ones are bound by the caller
+	void Realize(const RenderGraph& graph);
+	SoftSurface* Get(RenderGraphResource resource) const { return bound[resource]; }
+	void RecordBarriers(SoftCommandList& commandList, const RenderGraphBarrier* barriers, size_t count) const;
+
+private:
+	std::vector<SoftSurface*>					bound;
+	std::vector<std::unique_ptr<SoftSurface>>	slots;
+};
@@ -0,0 +1,950 @@
+#include "soft_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// ---- byte helpers ----
+
+	void PutU32BE(std::vector<uint8_t>& out, uint32_t v)
+	{
+		out.push_back(static_cast<uint8_t>(v >> 24));
+		out.push_back(static_cast<uint8_t>(v >> 16));
+		out.push_back(static_cast<uint8_t>(v >> 8));
+		out.push_back(static_cast<uint8_t>(v));
+	}
+
+	void PutU16LE(uint8_t* dst, uint16_t v)
+	{
+		dst[0] = static_cast<uint8_t>(v);
+		dst[1] = static_cast<uint8_t>(v >> 8);
+	}
+
+	void PutU32LE(std::vector<uint8_t>& out, uint32_t v)
+	{
+		for (int i = 0; i < 4; ++i)
+			out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+	}
+
+	void PutU64LE(uint8_t* dst, uint64_t v)
+	{
+		for (int i = 0; i < 8; ++i)
+			dst[i] = static_cast<uint8_t>(v >> (i * 8));
+	}
+
+	void PutString(std::vector<uint8_t>& out, const char* s)
+	{
+		out.insert(out.end(), s, s + strlen(s) + 1);
+	}
+
+	void CheckColorSurface(const SoftSurface& surface)
+	{
+		if (surface.format != SoftFormat::R8G8B8A8_UNORM)
+			throw std::runtime_error("image export needs an R8G8B8A8_UNORM surface");
+	}
+
+	// ---- deflate ----
+
+	struct DeflateTables
+	{
+		uint16_t	literalCode[288];	// bit reversed fixed huffman codes
+		uint8_t		literalBits[288];
+		uint8_t		lengthSymbol[259];	// length -> length code index 0..28
+		uint8_t		distanceCode[512];	// distance -> distance code index, see BuildDeflateTables
+	};
+
+	const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	const int kWindowSize = 32768;
+	const int kHashBits = 15;
+	const int kMinMatch = 3;
+	const int kMaxMatch = 258;
+	const int kMaxChain = 32;
+
+	uint32_t ReverseBits(uint32_t code, int bits)
+	{
+		uint32_t result = 0;
+		for (int i = 0; i < bits; ++i)
+		{
+			result = (result << 1) | (code & 1);
+			code >>= 1;
+		}
+		return result;
+	}
+
+	DeflateTables BuildDeflateTables()
+	{
+		DeflateTables t;
+		for (int sym = 0; sym < 288; ++sym)
+		{
+			uint32_t code;
+			int bits;
+			if (sym < 144)		{ code = 0x30 + sym;			bits = 8; }
+			else if (sym < 256)	{ code = 0x190 + (sym - 144);	bits = 9; }
+			else if (sym < 280)	{ code = sym - 256;				bits = 7; }
+			else				{ code = 0xc0 + (sym - 280);	bits = 8; }
+			t.literalCode[sym] = static_cast<uint16_t>(ReverseBits(code, bits));
+			t.literalBits[sym] = static_cast<uint8_t>(bits);
+		}
+		for (int i = 0; i < 29; ++i)
+		{
+			int end = i == 28 ? 259 : kLengthBase[i + 1];
+			for (int len = kLengthBase[i]; len < end; ++len)
+				t.lengthSymbol[len] = static_cast<uint8_t>(i);
+		}
+		// distances up to 256 index directly, larger ones by (d - 1) >> 7
+		for (int i = 0; i < 30; ++i)
+		{
+			int end = i == 29 ? 32769 : kDistanceBase[i + 1];
+			for (int d = kDistanceBase[i]; d < end; ++d)
+			{
+				if (d <= 256)
+					t.distanceCode[d - 1] = static_cast<uint8_t>(i);
+				else
+					t.distanceCode[256 + ((d - 1) >> 7)] = static_cast<uint8_t>(i);
+			}
+		}
+		return t;
+	}
+
+	const DeflateTables& GetDeflateTables()
+	{
+		static const DeflateTables tables = BuildDeflateTables();
+		return tables;
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+		void Put(uint32_t bits, int count)
+		{
+			acc |= static_cast<uint64_t>(bits) << used;
+			used += count;
+			while (used >= 8)
+			{
+				out.push_back(static_cast<uint8_t>(acc));
+				acc >>= 8;
+				used -= 8;
+			}
+		}
+
+		void Flush()
+		{
+			if (used > 0)
+				out.push_back(static_cast<uint8_t>(acc));
+			acc = 0;
+			used = 0;
+		}
+
+	private:
+		std::vector<uint8_t>&	out;
+		uint64_t				acc = 0;
+		int						used = 0;
+	};
+
+	uint32_t Hash3(const uint8_t* p)
+	{
+		uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+		return (v * 2654435761u) >> (32 - kHashBits);
+	}
+
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1, b = 0;
+		while (size > 0)
+		{
+			// largest block that cannot overflow before the modulo
+			size_t block = size < 5552 ? size : 5552;
+			size -= block;
+			while (block--)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	// ---- inflate ----
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+		uint32_t Get(int count)
+		{
+			while (used < count)
+			{
+				if (pos >= size)
+					throw std::runtime_error("deflate stream is truncated");
+				acc |= static_cast<uint32_t>(data[pos++]) << used;
+				used += 8;
+			}
+			uint32_t bits = acc & ((1u << count) - 1);
+			acc >>= count;
+			used -= count;
+			return bits;
+		}
+
+		void AlignToByte()
+		{
+			acc = 0;
+			used = 0;
+		}
+
+		const uint8_t* Bytes(size_t count)
+		{
+			if (pos + count > size)
+				throw std::runtime_error("deflate stream is truncated");
+			const uint8_t* bytes = data + pos;
+			pos += count;
+			return bytes;
+		}
+
+	private:
+		const uint8_t*	data;
+		size_t			size;
+		size_t			pos = 0;
+		uint32_t		acc = 0;
+		int				used = 0;
+	};
+
+	// canonical huffman table, decoded a bit at a time
+	struct Huffman
+	{
+		uint16_t	count[16];
+		uint16_t	symbol[288];
+
+		void Build(const uint8_t* lengths, int n)
+		{
+			memset(count, 0, sizeof(count));
+			for (int i = 0; i < n; ++i)
+				++count[lengths[i]];
+			count[0] = 0;
+			uint16_t offset[16];
+			offset[1] = 0;
+			for (int len = 1; len < 15; ++len)
+				offset[len + 1] = offset[len] + count[len];
+			for (int i = 0; i < n; ++i)
+			{
+				if (lengths[i])
+					symbol[offset[lengths[i]]++] = static_cast<uint16_t>(i);
+			}
+		}
+
+		int Decode(BitReader& bits) const
+		{
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len < 16; ++len)
+			{
+				code |= static_cast<int>(bits.Get(1));
+				int n = count[len];
+				if (code - n < first)
+					return symbol[index + (code - first)];
+				index += n;
+				first += n;
+				first <<= 1;
+				code <<= 1;
+			}
+			throw std::runtime_error("invalid huffman code in deflate stream");
+		}
+	};
+
+	void InflateBlock(BitReader& bits, const Huffman& literals, const Huffman& distances, std::vector<uint8_t>& out, size_t base)
+	{
+		for (;;)
+		{
+			int symbol = literals.Decode(bits);
+			if (symbol < 256)
+			{
+				out.push_back(static_cast<uint8_t>(symbol));
+				continue;
+			}
+			if (symbol == 256)
+				return;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				throw std::runtime_error("invalid length in deflate stream");
+			size_t length = kLengthBase[symbol] + bits.Get(kLengthExtra[symbol]);
+			int distanceSymbol = distances.Decode(bits);
+			if (distanceSymbol >= 30)
+				throw std::runtime_error("invalid distance in deflate stream");
+			size_t distance = kDistanceBase[distanceSymbol] + bits.Get(kDistanceExtra[distanceSymbol]);
+			if (distance > out.size() - base)
+				throw std::runtime_error("deflate distance reaches before the stream");
+			// copies byte by byte, matches may overlap their own output
+			size_t from = out.size() - distance;
+			for (size_t i = 0; i < length; ++i)
+				out.push_back(out[from + i]);
+		}
+	}
+
+	void InflateDynamicTables(BitReader& bits, Huffman& literals, Huffman& distances)
+	{
+		static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		int literalCount = static_cast<int>(bits.Get(5)) + 257;
+		int distanceCount = static_cast<int>(bits.Get(5)) + 1;
+		int codeCount = static_cast<int>(bits.Get(4)) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+			throw std::runtime_error("invalid dynamic huffman header");
+
+		uint8_t lengths[320] = {};
+		for (int i = 0; i < codeCount; ++i)
+			lengths[order[i]] = static_cast<uint8_t>(bits.Get(3));
+		Huffman codeLengths;
+		codeLengths.Build(lengths, 19);
+
+		memset(lengths, 0, sizeof(lengths));
+		int n = 0;
+		while (n < literalCount + distanceCount)
+		{
+			int symbol = codeLengths.Decode(bits);
+			if (symbol < 16)
+			{
+				lengths[n++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+			uint8_t repeat = 0;
+			int times;
+			if (symbol == 16)
+			{
+				if (n == 0)
+					throw std::runtime_error("invalid dynamic huffman lengths");
+				repeat = lengths[n - 1];
+				times = 3 + static_cast<int>(bits.Get(2));
+			}
+			else if (symbol == 17)
+			{
+				times = 3 + static_cast<int>(bits.Get(3));
+			}
+			else
+			{
+				times = 11 + static_cast<int>(bits.Get(7));
+			}
+			if (n + times > literalCount + distanceCount)
+				throw std::runtime_error("invalid dynamic huffman lengths");
+			while (times--)
+				lengths[n++] = repeat;
+		}
+		literals.Build(lengths, literalCount);
+		distances.Build(lengths + literalCount, distanceCount);
+	}
+
+	// ---- png ----
+
+	const uint32_t* GetCrcTable()
+	{
+		static uint32_t table[256];
+		static bool built = [] {
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				table[n] = c;
+			}
+			return true;
+		}();
+		(void)built;
+		return table;
+	}
+
+	void PutPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+	{
+		const uint32_t* crcTable = GetCrcTable();
+		PutU32BE(out, static_cast<uint32_t>(size));
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		if (size)
+			out.insert(out.end(), data, data + size);
+
+		uint32_t crc = 0xffffffffu;
+		for (size_t i = start; i < out.size(); ++i)
+			crc = crcTable[(crc ^ out[i]) & 0xff] ^ (crc >> 8);
+		PutU32BE(out, crc ^ 0xffffffffu);
+	}
+
+	uint8_t Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return static_cast<uint8_t>(a);
+		return static_cast<uint8_t>(pb <= pc ? b : c);
+	}
+
+	// filters one row with every png filter and keeps the one with the smallest sum of signed residuals
+	void FilterRow(const uint8_t* row, const uint8_t* prev, size_t rowBytes, uint8_t* scratch, uint8_t* dst)
+	{
+		uint32_t bestCost = 0xffffffffu;
+		for (uint8_t filter = 0; filter < 5; ++filter)
+		{
+			uint32_t cost = 0;
+			for (size_t i = 0; i < rowBytes; ++i)
+			{
+				int a = i >= 4 ? row[i - 4] : 0;
+				int b = prev ? prev[i] : 0;
+				int c = (prev && i >= 4) ? prev[i - 4] : 0;
+				uint8_t v = row[i];
+				switch (filter)
+				{
+				case 1: v = static_cast<uint8_t>(v - a); break;
+				case 2: v = static_cast<uint8_t>(v - b); break;
+				case 3: v = static_cast<uint8_t>(v - ((a + b) >> 1)); break;
+				case 4: v = static_cast<uint8_t>(v - Paeth(a, b, c)); break;
+				default: break;
+				}
+				scratch[i] = v;
+				cost += v < 128 ? v : 256 - v;
+			}
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				dst[0] = filter;
+				memcpy(dst + 1, scratch, rowBytes);
+			}
+		}
+	}
+
+	// ---- exr ----
+
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t f = FloatBits(value);
+		uint32_t sign = (f >> 16) & 0x8000;
+		int32_t exponent = static_cast<int32_t>((f >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = f & 0x7fffff;
+
+		if (((f >> 23) & 0xff) == 0xff)
+			return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+		if (exponent >= 31)
+			return static_cast<uint16_t>(sign | 0x7c00);
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+				return static_cast<uint16_t>(sign);
+			// denormal, round to nearest
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+				++half;
+			return static_cast<uint16_t>(sign | half);
+		}
+		uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		// round to nearest, a carry into the exponent is still correct
+		if (mantissa & 0x1000)
+			++half;
+		return static_cast<uint16_t>(half);
+	}
+
+	struct ExrTables
+	{
+		uint16_t	srgbToLinear[256];
+		uint16_t	unorm[256];
+	};
+
+	const ExrTables& GetExrTables()
+	{
+		static const ExrTables tables = [] {
+			ExrTables t;
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = i / 255.0f;
+				float linear = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+				t.srgbToLinear[i] = FloatToHalf(linear);
+				t.unorm[i] = FloatToHalf(c);
+			}
+			return t;
+		}();
+		return tables;
+	}
+
+	void PutExrAttribute(std::vector<uint8_t>& out, const char* name, const char* type, const void* value, uint32_t size)
+	{
+		PutString(out, name);
+		PutString(out, type);
+		PutU32LE(out, size);
+		const uint8_t* bytes = static_cast<const uint8_t*>(value);
+		out.insert(out.end(), bytes, bytes + size);
+	}
+}
+
+const char* GetImageExtension(SoftImageFormat format)
+{
+	switch (format)
+	{
+	case SoftImageFormat::Png: return "png";
+	case SoftImageFormat::Exr: return "exr";
+	case SoftImageFormat::Raw: return "rgba";
+	case SoftImageFormat::Yuv420: return "yuv";
+	}
+	return "bin";
+}
+
+void DeflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+	const DeflateTables& t = GetDeflateTables();
+
+	// zlib header: deflate, 32k window, no dictionary
+	out.push_back(0x78);
+	out.push_back(0x01);
+
+	BitWriter bits(out);
+	// a single final block with the fixed huffman tables
+	bits.Put(1, 1);
+	bits.Put(1, 2);
+
+	std::vector<int32_t> head(static_cast<size_t>(1) << kHashBits, -1);
+	std::vector<int32_t> prev(kWindowSize, -1);
+
+	auto insert = [&](size_t pos)
+	{
+		uint32_t h = Hash3(data + pos);
+		prev[pos & (kWindowSize - 1)] = head[h];
+		head[h] = static_cast<int32_t>(pos);
+	};
+
+	size_t pos = 0;
+	while (pos < size)
+	{
+		int bestLength = 0;
+		size_t bestDistance = 0;
+		if (pos + kMinMatch <= size)
+		{
+			int maxLength = static_cast<int>((std::min)(static_cast<size_t>(kMaxMatch), size - pos));
+			int32_t candidate = head[Hash3(data + pos)];
+			for (int chain = 0; candidate >= 0 && chain < kMaxChain; ++chain)
+			{
+				size_t distance = pos - static_cast<size_t>(candidate);
+				if (distance > static_cast<size_t>(kWindowSize))
+					break;
+				const uint8_t* a = data + candidate;
+				const uint8_t* b = data + pos;
+				if (a[bestLength] == b[bestLength])
+				{
+					int length = 0;
+					while (length < maxLength && a[length] == b[length])
+						++length;
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = distance;
+						if (length == maxLength)
+							break;
+					}
+				}
+				int32_t next = prev[candidate & (kWindowSize - 1)];
+				// the slot was reused by a newer position, the chain ends here
+				if (next >= candidate)
+					break;
+				candidate = next;
+			}
+		}
+
+		if (bestLength >= kMinMatch)
+		{
+			int lengthIndex = t.lengthSymbol[bestLength];
+			int symbol = 257 + lengthIndex;
+			bits.Put(t.literalCode[symbol], t.literalBits[symbol]);
+			if (kLengthExtra[lengthIndex])
+				bits.Put(bestLength - kLengthBase[lengthIndex], kLengthExtra[lengthIndex]);
+
+			int distanceIndex = bestDistance <= 256 ? t.distanceCode[bestDistance - 1] : t.distanceCode[256 + ((bestDistance - 1) >> 7)];
+			bits.Put(ReverseBits(distanceIndex, 5), 5);
+			if (kDistanceExtra[distanceIndex])
+				bits.Put(static_cast<uint32_t>(bestDistance - kDistanceBase[distanceIndex]), kDistanceExtra[distanceIndex]);
+
+			size_t end = pos + bestLength;
+			for (; pos < end; ++pos)
+			{
+				if (pos + kMinMatch <= size)
+					insert(pos);
+			}
+		}
+		else
+		{
+			bits.Put(t.literalCode[data[pos]], t.literalBits[data[pos]]);
+			if (pos + kMinMatch <= size)
+				insert(pos);
+			++pos;
+		}
+	}
+
+	bits.Put(t.literalCode[256], t.literalBits[256]);
+	bits.Flush();
+	PutU32BE(out, Adler32(data, size));
+}
+
+void EncodePng(const SoftSurface& surface, std::vector<uint8_t>& out)
+{
+	CheckColorSurface(surface);
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	out.insert(out.end(), signature, signature + 8);
+
+	uint8_t header[13];
+	for (int i = 0; i < 4; ++i)
+	{
+		header[i] = static_cast<uint8_t>(surface.width >> (24 - i * 8));
+		header[4 + i] = static_cast<uint8_t>(surface.height >> (24 - i * 8));
+	}
+	header[8] = 8;		// bits per channel
+	header[9] = 6;		// rgba
+	header[10] = 0;		// deflate
+	header[11] = 0;		// adaptive filtering
+	header[12] = 0;		// no interlace
+	PutPngChunk(out, "IHDR", header, sizeof(header));
+
+	// the texel memory is already r, g, b, a bytes
+	size_t rowBytes = static_cast<size_t>(surface.width) * 4;
+	std::vector<uint8_t> filtered((rowBytes + 1) * surface.height);
+	std::vector<uint8_t> scratch(rowBytes);
+	for (uint32_t y = 0; y < surface.height; ++y)
+	{
+		const uint8_t* row = reinterpret_cast<const uint8_t*>(surface.Row(y));
+		const uint8_t* prevRow = y ? reinterpret_cast<const uint8_t*>(surface.Row(y - 1)) : nullptr;
+		FilterRow(row, prevRow, rowBytes, scratch.data(), filtered.data() + y * (rowBytes + 1));
+	}
+
+	std::vector<uint8_t> compressed;
+	compressed.reserve(filtered.size() / 4);
+	DeflateZlib(filtered.data(), filtered.size(), compressed);
+	PutPngChunk(out, "IDAT", compressed.data(), compressed.size());
+	PutPngChunk(out, "IEND", nullptr, 0);
+}
+
+void EncodeExr(const SoftSurface& surface, std::vector<uint8_t>& out)
+{
+	CheckColorSurface(surface);
+	const ExrTables& tables = GetExrTables();
+
+	size_t base = out.size();
+	PutU32LE(out, 20000630);	// magic
+	PutU32LE(out, 2);			// version 2, single part scanline file
+
+	// channels have to be listed in alphabetical order
+	std::vector<uint8_t> channels;
+	const char* names[4] = { "A", "B", "G", "R" };
+	for (const char* name : names)
+	{
+		PutString(channels, name);
+		PutU32LE(channels, 1);		// half
+		PutU32LE(channels, 0);		// pLinear and reserved
+		PutU32LE(channels, 1);		// x sampling
+		PutU32LE(channels, 1);		// y sampling
+	}
+	channels.push_back(0);
+	PutExrAttribute(out, "channels", "chlist", channels.data(), static_cast<uint32_t>(channels.size()));
+
+	uint8_t compression = 0;
+	PutExrAttribute(out, "compression", "compression", &compression, 1);
+	int32_t window[4] = { 0, 0, static_cast<int32_t>(surface.width) - 1, static_cast<int32_t>(surface.height) - 1 };
+	PutExrAttribute(out, "dataWindow", "box2i", window, sizeof(window));
+	PutExrAttribute(out, "displayWindow", "box2i", window, sizeof(window));
+	uint8_t lineOrder = 0;
+	PutExrAttribute(out, "lineOrder", "lineOrder", &lineOrder, 1);
+	float aspect = 1.0f;
+	PutExrAttribute(out, "pixelAspectRatio", "float", &aspect, sizeof(aspect));
+	float center[2] = { 0.0f, 0.0f };
+	PutExrAttribute(out, "screenWindowCenter", "v2f", center, sizeof(center));
+	float windowWidth = 1.0f;
+	PutExrAttribute(out, "screenWindowWidth", "float", &windowWidth, sizeof(windowWidth));
+	out.push_back(0);
+
+	// uncompressed files store one scanline per block
+	size_t lineBytes = static_cast<size_t>(surface.width) * 4 * sizeof(uint16_t);
+	size_t blockBytes = 8 + lineBytes;
+	size_t offsetTable = out.size();
+	size_t firstBlock = offsetTable + static_cast<size_t>(surface.height) * 8;
+	out.resize(firstBlock + blockBytes * surface.height);
+
+	for (uint32_t y = 0; y < surface.height; ++y)
+	{
+		size_t blockStart = firstBlock + y * blockBytes;
+		PutU64LE(&out[offsetTable + y * 8], blockStart - base);
+
+		uint8_t* block = &out[blockStart];
+		PutU16LE(block, static_cast<uint16_t>(y));
+		PutU16LE(block + 2, static_cast<uint16_t>(y >> 16));
+		PutU16LE(block + 4, static_cast<uint16_t>(lineBytes));
+		PutU16LE(block + 6, static_cast<uint16_t>(lineBytes >> 16));
+
+		uint8_t* a = block + 8;
+		uint8_t* b = a + surface.width * 2;
+		uint8_t* g = b + surface.width * 2;
+		uint8_t* r = g + surface.width * 2;
+		const uint32_t* row = surface.Row(y);
+		for (uint32_t x = 0; x < surface.width; ++x)
+		{
+			uint32_t texel = row[x];
+			// color targets hold srgb encoded values, exr stores linear light
+			PutU16LE(r + x * 2, tables.srgbToLinear[texel & 0xff]);
+			PutU16LE(g + x * 2, tables.srgbToLinear[(texel >> 8) & 0xff]);
+			PutU16LE(b + x * 2, tables.srgbToLinear[(texel >> 16) & 0xff]);
+			PutU16LE(a + x * 2, tables.unorm[texel >> 24]);
+		}
+	}
+}
+
+void EncodeRaw(const SoftSurface& surface, std::vector<uint8_t>& out)
+{
+	CheckColorSurface(surface);
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(surface.texels.data());
+	out.insert(out.end(), bytes, bytes + surface.SizeInBytes());
+}
+
+void EncodeYuv420(const SoftSurface& surface, std::vector<uint8_t>& out)
+{
+	CheckColorSurface(surface);
+
+	// BT.709 in 16 bit fixed point, with the 219 and 224 level scale of limited range folded in
+	const int32_t kYR = 11966, kYG = 40254, kYB = 4064;
+	const int32_t kUR = -6597, kUG = -22189, kUB = 28784;
+	const int32_t kVR = 28784, kVG = -26147, kVB = -2637;
+
+	uint32_t chromaWidth = (surface.width + 1) / 2;
+	uint32_t chromaHeight = (surface.height + 1) / 2;
+	size_t lumaSize = static_cast<size_t>(surface.width) * surface.height;
+	size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+	size_t base = out.size();
+	out.resize(base + lumaSize + chromaSize * 2);
+	uint8_t* lumaPlane = &out[base];
+	uint8_t* cbPlane = lumaPlane + lumaSize;
+	uint8_t* crPlane = cbPlane + chromaSize;
+
+	for (uint32_t y = 0; y < surface.height; ++y)
+	{
+		const uint32_t* row = surface.Row(y);
+		uint8_t* luma = lumaPlane + static_cast<size_t>(y) * surface.width;
+		for (uint32_t x = 0; x < surface.width; ++x)
+		{
+			int32_t r = row[x] & 0xff, g = (row[x] >> 8) & 0xff, b = (row[x] >> 16) & 0xff;
+			luma[x] = static_cast<uint8_t>((r * kYR + g * kYG + b * kYB + (16 << 16) + 32768) >> 16);
+		}
+	}
+
+	// chroma from the average of each 2x2 block, edges repeat the last row and column
+	for (uint32_t cy = 0; cy < chromaHeight; ++cy)
+	{
+		const uint32_t* row0 = surface.Row(cy * 2);
+		const uint32_t* row1 = surface.Row((std::min)(cy * 2 + 1, surface.height - 1));
+		for (uint32_t cx = 0; cx < chromaWidth; ++cx)
+		{
+			uint32_t x0 = cx * 2;
+			uint32_t x1 = (std::min)(x0 + 1, surface.width - 1);
+			uint32_t quad[4] = { row0[x0], row0[x1], row1[x0], row1[x1] };
+			int32_t r = 0, g = 0, b = 0;
+			for (uint32_t texel : quad)
+			{
+				r += texel & 0xff;
+				g += (texel >> 8) & 0xff;
+				b += (texel >> 16) & 0xff;
+			}
+			// the sums are 4x the average, fold that into the shift
+			size_t i = static_cast<size_t>(cy) * chromaWidth + cx;
+			cbPlane[i] = static_cast<uint8_t>((r * kUR + g * kUG + b * kUB + (128 << 18) + (1 << 17)) >> 18);
+			crPlane[i] = static_cast<uint8_t>((r * kVR + g * kVG + b * kVB + (128 << 18) + (1 << 17)) >> 18);
+		}
+	}
+}
+
+void EncodeImage(SoftImageFormat format, const SoftSurface& surface, std::vector<uint8_t>& out)
+{
+	switch (format)
+	{
+	case SoftImageFormat::Png: EncodePng(surface, out); break;
+	case SoftImageFormat::Exr: EncodeExr(surface, out); break;
+	case SoftImageFormat::Raw: EncodeRaw(surface, out); break;
+	case SoftImageFormat::Yuv420: EncodeYuv420(surface, out); break;
+	}
+}
+
+void InflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+	if (size < 6 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		throw std::runtime_error("not a zlib stream");
+
+	size_t base = out.size();
+	BitReader bits(data + 2, size - 6);
+	bool last = false;
+	while (!last)
+	{
+		last = bits.Get(1) != 0;
+		uint32_t type = bits.Get(2);
+		if (type == 0)
+		{
+			bits.AlignToByte();
+			const uint8_t* header = bits.Bytes(4);
+			uint32_t length = header[0] | (header[1] << 8);
+			if ((length ^ 0xffff) != static_cast<uint32_t>(header[2] | (header[3] << 8)))
+				throw std::runtime_error("invalid stored block in deflate stream");
+			const uint8_t* bytes = bits.Bytes(length);
+			out.insert(out.end(), bytes, bytes + length);
+		}
+		else if (type == 1)
+		{
+			static const struct FixedTables
+			{
+				Huffman literals;
+				Huffman distances;
+				FixedTables()
+				{
+					uint8_t lengths[288];
+					memset(lengths, 8, 144);
+					memset(lengths + 144, 9, 112);
+					memset(lengths + 256, 7, 24);
+					memset(lengths + 280, 8, 8);
+					literals.Build(lengths, 288);
+					memset(lengths, 5, 30);
+					distances.Build(lengths, 30);
+				}
+			} fixed;
+			InflateBlock(bits, fixed.literals, fixed.distances, out, base);
+		}
+		else if (type == 2)
+		{
+			Huffman literals, distances;
+			InflateDynamicTables(bits, literals, distances);
+			InflateBlock(bits, literals, distances, out, base);
+		}
+		else
+		{
+			throw std::runtime_error("invalid block type in deflate stream");
+		}
+	}
+
+	const uint8_t* trailer = data + size - 4;
+	uint32_t expected = (static_cast<uint32_t>(trailer[0]) << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3];
+	if (Adler32(out.data() + base, out.size() - base) != expected)
+		throw std::runtime_error("zlib checksum mismatch");
+}
+
+void DecodePng(const uint8_t* data, size_t size, SoftSurface& surface)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+		throw std::runtime_error("not a png file");
+
+	auto readU32 = [](const uint8_t* p) { return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; };
+	uint32_t width = 0, height = 0;
+	uint8_t colorType = 0;
+	std::vector<uint8_t> compressed;
+	size_t pos = 8;
+	for (;;)
+	{
+		if (pos + 12 > size)
+			throw std::runtime_error("png file is truncated");
+		uint32_t length = readU32(data + pos);
+		const uint8_t* type = data + pos + 4;
+		const uint8_t* chunk = data + pos + 8;
+		if (length > size - pos - 12)
+			throw std::runtime_error("png file is truncated");
+		pos += 12 + static_cast<size_t>(length);
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+				throw std::runtime_error("invalid png header");
+			width = readU32(chunk);
+			height = readU32(chunk + 4);
+			colorType = chunk[9];
+			if (chunk[8] != 8 || (colorType != 2 && colorType != 6) || chunk[12] != 0)
+				throw std::runtime_error("only 8 bit, non interlaced RGB and RGBA png files are supported");
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+	}
+	if (width == 0 || height == 0)
+		throw std::runtime_error("png file has no image");
+
+	std::vector<uint8_t> filtered;
+	InflateZlib(compressed.data(), compressed.size(), filtered);
+	uint32_t channels = colorType == 6 ? 4 : 3;
+	size_t rowBytes = static_cast<size_t>(width) * channels;
+	if (filtered.size() < (rowBytes + 1) * height)
+		throw std::runtime_error("png image data is truncated");
+
+	surface.Resize(width, height, SoftFormat::R8G8B8A8_UNORM);
+	std::vector<uint8_t> prevRow(rowBytes, 0), row(rowBytes);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* src = filtered.data() + y * (rowBytes + 1);
+		uint8_t filter = src[0];
+		for (size_t i = 0; i < rowBytes; ++i)
+		{
+			int a = i >= channels ? row[i - channels] : 0;
+			int b = prevRow[i];
+			int c = i >= channels ? prevRow[i - channels] : 0;
+			uint8_t v = src[i + 1];
+			switch (filter)
+			{
+			case 0: break;
+			case 1: v = static_cast<uint8_t>(v + a); break;
+			case 2: v = static_cast<uint8_t>(v + b); break;
+			case 3: v = static_cast<uint8_t>(v + ((a + b) >> 1)); break;
+			case 4: v = static_cast<uint8_t>(v + Paeth(a, b, c)); break;
+			default: throw std::runtime_error("invalid png filter");
+			}
+			row[i] = v;
+		}
+
+		uint32_t* dst = surface.Row(y);
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint8_t* p = row.data() + x * channels;
+			uint32_t alpha = channels == 4 ? p[3] : 0xff;
+			dst[x] = p[0] | (p[1] << 8) | (p[2] << 16) | (alpha << 24);
+		}
+		row.swap(prevRow);
+	}
+}
+
+void WriteImageFile(const char* path, SoftImageFormat format, const SoftSurface& surface)
+{
+	std::vector<uint8_t> encoded;
+	EncodeImage(format, surface, encoded);
+	FILE* file = fopen(path, "wb");
+	if (!file)
+		throw std::runtime_error(std::string("failed to open ") + path);
+	size_t written = fwrite(encoded.data(), 1, encoded.size(), file);
+	fclose(file);
+	if (written != encoded.size())
+		throw std::runtime_error(std::string("failed to write ") + path);
+}
+
+bool ReadPngFile(const char* path, SoftSurface& surface)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+	std::vector<uint8_t> data;
+	uint8_t buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		data.insert(data.end(), buffer, buffer + read);
+	fclose(file);
+	DecodePng(data.data(), data.size(), surface);
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "soft_surface.h"
+
+enum class SoftImageFormat : uint8_t
+{
+	Png,	// 8 bit RGBA, deflate compressed
+	Exr,	// half float RGBA, linear, uncompressed scanlines
+	Raw,	// 8 bit RGBA texels, no header
+	Yuv420,	// 8 bit planar Y, Cb, Cr with half resolution chroma, BT.709 limited range
+};
+
+const char* GetImageExtension(SoftImageFormat format);
+
+// Encoders for R8G8B8A8_UNORM surfaces. They append to out, so callers can reuse its capacity.
+void EncodePng(const SoftSurface& surface, std::vector<uint8_t>& out);
+void EncodeExr(const SoftSurface& surface, std::vector<uint8_t>& out);
+void EncodeRaw(const SoftSurface& surface, std::vector<uint8_t>& out);
+void EncodeYuv420(const SoftSurface& surface, std::vector<uint8_t>& out);
+void EncodeImage(SoftImageFormat format, const SoftSurface& surface, std::vector<uint8_t>& out);
+
+// zlib stream (RFC 1950) of a single fixed huffman deflate block
+void DeflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+// decodes any zlib stream, appending to out
+void InflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+// 8 bit RGB and RGBA png files into an R8G8B8A8_UNORM surface, RGB gets an opaque alpha
+void DecodePng(const uint8_t* data, size_t size, SoftSurface& surface);
+
+void WriteImageFile(const char* path, SoftImageFormat format, const SoftSurface& surface);
+// returns false when the file does not exist, throws when it is not a supported png
+bool ReadPngFile(const char* path, SoftSurface& surface);
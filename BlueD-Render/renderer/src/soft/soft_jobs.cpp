@@ -0,0 +1,118 @@
+#include "soft_jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+SoftThreadPool::SoftThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+		workers.emplace_back(&SoftThreadPool::WorkerLoop, this);
+}
+
+SoftThreadPool::~SoftThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void SoftThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void SoftThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	jobsDone.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void SoftThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job)
+{
+	if (count == 0)
+		return;
+
+	std::atomic<uint32_t> nextIndex{ 0 };
+	std::mutex doneMutex;
+	std::condition_variable done;
+	uint32_t helpersLeft = (std::min)(count - 1, ThreadCount());
+	std::exception_ptr failure;
+
+	auto run = [&]()
+	{
+		for (uint32_t i = nextIndex++; i < count; i = nextIndex++)
+		{
+			try
+			{
+				job(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if (!failure)
+					failure = std::current_exception();
+			}
+		}
+	};
+
+	// the helpers reference this stack frame, so it only returns after every helper has finished
+	uint32_t helpers = helpersLeft;
+	for (uint32_t i = 0; i < helpers; ++i)
+	{
+		Submit([&]()
+		{
+			run();
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if (--helpersLeft == 0)
+				done.notify_one();
+		});
+	}
+	run();
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	done.wait(lock, [&] { return helpersLeft == 0; });
+	if (failure)
+		std::rethrow_exception(failure);
+}
+
+void SoftThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			// drain the queue before stopping
+			if (jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			++activeJobs;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--activeJobs;
+			if (jobs.empty() && activeJobs == 0)
+				jobsDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running jobs in submission order
+class SoftThreadPool
+{
+public:
+	// 0 picks one thread per hardware thread
+	explicit SoftThreadPool(uint32_t threadCount = 0);
+	~SoftThreadPool();
+	SoftThreadPool(const SoftThreadPool&) = delete;
+	SoftThreadPool& operator=(const SoftThreadPool&) = delete;
+
+	void Submit(std::function<void()> job);
+	// blocks until every submitted job has finished
+	void Wait();
+	// runs job(i) for every i in [0, count) and returns once they are all done, the calling thread
+	// takes part. The first exception thrown by a job is rethrown here. Not for use from inside a job of the same pool.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+	uint32_t ThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+	std::vector<std::thread>				workers;
+	std::deque<std::function<void()>>		jobs;
+	std::mutex								mutex;
+	std::condition_variable					jobAvailable;
+	std::condition_variable					jobsDone;
+	uint32_t								activeJobs = 0;
+	bool									stopping = false;
+
+	void WorkerLoop();
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Small vector/matrix types for the software path.
+// Matrices follow the DirectXMath convention: row vectors (v * M), left handed, depth in [0, 1].
+
+struct Vec2
+{
+	float x, y;
+};
+
+struct Vec3
+{
+	float x, y, z;
+};
+
+struct Vec4
+{
+	float x, y, z, w;
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Vec3 operator*(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+inline Vec4 operator*(const Vec4& a, const Vec4& b) { return { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w }; }
+inline Vec4 operator*(const Vec4& a, float s) { return { a.x * s, a.y * s, a.z * s, a.w * s }; }
+
+inline float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline Vec3 Normalize(const Vec3& v) { float len = std::sqrt(Dot(v, v)); return len > 0.0f ? v * (1.0f / len) : v; }
+
+struct Mat4
+{
+	float m[4][4];
+
+	static Mat4 Identity()
+	{
+		Mat4 r = {};
+		r.m[0][0] = r.m[1][1] = r.m[2][2] = r.m[3][3] = 1.0f;
+		return r;
+	}
+
+	static Mat4 Translation(float x, float y, float z)
+	{
+		Mat4 r = Identity();
+		r.m[3][0] = x; r.m[3][1] = y; r.m[3][2] = z;
+		return r;
+	}
+
+	static Mat4 Scale(float x, float y, float z)
+	{
+		Mat4 r = Identity();
+		r.m[0][0] = x; r.m[1][1] = y; r.m[2][2] = z;
+		return r;
+	}
+
+	static Mat4 RotationX(float angle)
+	{
+		float s = std::sin(angle), c = std::cos(angle);
+		Mat4 r = Identity();
+		r.m[1][1] = c; r.m[1][2] = s;
+		r.m[2][1] = -s; r.m[2][2] = c;
+		return r;
+	}
+
+	static Mat4 RotationY(float angle)
+	{
+		float s = std::sin(angle), c = std::cos(angle);
+		Mat4 r = Identity();
+		r.m[0][0] = c; r.m[0][2] = -s;
+		r.m[2][0] = s; r.m[2][2] = c;
+		return r;
+	}
+
+	static Mat4 LookAtLH(const Vec3& eye, const Vec3& target, const Vec3& up)
+	{
+		Vec3 zAxis = Normalize(target - eye);
+		Vec3 xAxis = Normalize(Cross(up, zAxis));
+		Vec3 yAxis = Cross(zAxis, xAxis);
+		Mat4 r = Identity();
+		r.m[0][0] = xAxis.x; r.m[0][1] = yAxis.x; r.m[0][2] = zAxis.x;
+		r.m[1][0] = xAxis.y; r.m[1][1] = yAxis.y; r.m[1][2] = zAxis.y;
+		r.m[2][0] = xAxis.z; r.m[2][1] = yAxis.z; r.m[2][2] = zAxis.z;
+		r.m[3][0] = -Dot(xAxis, eye); r.m[3][1] = -Dot(yAxis, eye); r.m[3][2] = -Dot(zAxis, eye);
+		return r;
+	}
+
+	static Mat4 PerspectiveFovLH(float fovY, float aspect, float zNear, float zFar)
+	{
+		float yScale = 1.0f / std::tan(fovY * 0.5f);
+		float range = zFar / (zFar - zNear);
+		Mat4 r = {};
+		r.m[0][0] = yScale / aspect;
+		r.m[1][1] = yScale;
+		r.m[2][2] = range;
+		r.m[2][3] = 1.0f;
+		r.m[3][2] = -range * zNear;
+		return r;
+	}
+};
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	Mat4 r;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+	return r;
+}
+
+inline Vec4 Transform(const Vec3& v, const Mat4& m)
+{
+	return {
+		v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0],
+		v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1],
+		v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2],
+		v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + m.m[3][3] };
+}
@@ -0,0 +1,72 @@
+#include "soft_pipeline.h"
+#include "soft_raster.h"
+
+bool SoftPipelineDesc::operator==(const SoftPipelineDesc& other) const
+{
+	return shader == other.shader && blend == other.blend &&
+		depthEnable == other.depthEnable && depthWrite == other.depthWrite && depthFunc == other.depthFunc &&
+		cull == other.cull && frontCounterClockwise == other.frontCounterClockwise &&
+		layout == other.layout;
+}
+
+SoftPipelineDesc CanonicalizePipelineDesc(const SoftPipelineDesc& desc)
+{
+	SoftPipelineDesc result = desc;
+	if (!result.depthEnable)
+	{
+		result.depthWrite = false;
+		result.depthFunc = SoftCompare::Always;
+	}
+	if (result.cull == SoftCull::None)
+		result.frontCounterClockwise = false;
+	return result;
+}
+
+uint64_t HashPipelineDesc(const SoftPipelineDesc& desc)
+{
+	const uint8_t fields[] = {
+		static_cast<uint8_t>(desc.shader), static_cast<uint8_t>(desc.blend),
+		static_cast<uint8_t>(desc.depthEnable), static_cast<uint8_t>(desc.depthWrite), static_cast<uint8_t>(desc.depthFunc),
+		static_cast<uint8_t>(desc.cull), static_cast<uint8_t>(desc.frontCounterClockwise),
+		static_cast<uint8_t>(desc.layout) };
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (uint8_t field : fields)
+	{
+		hash ^= field;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+SoftPipelineState::SoftPipelineState(const SoftPipelineDesc& desc, uint64_t hash) :
+	desc(desc), hash(hash),
+	vertexStride(GetVertexStride(desc.layout)),
+	fetch(SelectVertexFetch(desc.layout)),
+	kernel(SelectRasterKernel(desc)) {}
+
+const SoftPipelineState* SoftPipelineCache::GetPipelineState(const SoftPipelineDesc& desc)
+{
+	SoftPipelineDesc canonical = CanonicalizePipelineDesc(desc);
+	uint64_t hash = HashPipelineDesc(canonical);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::unique_ptr<SoftPipelineState>>& bucket = states[hash];
+	for (const std::unique_ptr<SoftPipelineState>& state : bucket)
+	{
+		if (state->desc == canonical)
+			return state.get();
+	}
+
+	// first time we see this combination, resolve its kernel
+	bucket.emplace_back(new SoftPipelineState(canonical, hash));
+	++count;
+	return bucket.back().get();
+}
+
+size_t SoftPipelineCache::Size() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return count;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "soft_math.h"
+#include "soft_surface.h"
+
+// Pixel shaders of the software path
+enum class SoftShader : uint8_t
+{
+	VertexColor,		// interpolated vertex color
+	Texture,			// texture sample
+	TextureModulate,	// texture sample * vertex color
+	Count,
+};
+
+enum class SoftBlend : uint8_t
+{
+	Opaque,
+	Alpha,				// src * a + dst * (1 - a)
+	Additive,			// src * a + dst
+	Count,
+};
+
+enum class SoftCompare : uint8_t
+{
+	Less,
+	LessEqual,
+	Greater,
+	Always,
+	Count,
+};
+
+enum class SoftCull : uint8_t
+{
+	None,
+	Front,
+	Back,
+	Count,
+};
+
+enum class SoftVertexLayout : uint8_t
+{
+	PosColor,
+	PosColorUV,
+	PosUV,
+	Count,
+};
+
+// How many pixels one pixel shader invocation covers, the square subset of D3D12_SHADING_RATE.
+// Depth and coverage stay per pixel at every rate
+enum class SoftShadingRate : uint8_t
+{
+	Rate1x1,
+	Rate2x2,
+	Rate4x4,
+	Count,
+};
+
+// a shading rate image holds one SoftShadingRate per tile of this many pixels squared
+const uint32_t kShadingRateTileSize = 8;
+
+// Input vertex formats, one per SoftVertexLayout
+struct SoftVertexPosColor
+{
+	Vec3 pos;
+	Vec4 color;
+};
+
+struct SoftVertexPosColorUV
+{
+	Vec3 pos;
+	Vec4 color;
+	Vec2 uv;
+};
+
+struct SoftVertexPosUV
+{
+	Vec3 pos;
+	Vec2 uv;
+};
+
+// Output of the vertex stage, in clip space
+struct SoftClipVertex
+{
+	Vec4 pos;
+	Vec4 color;
+	Vec2 uv;
+};
+
+// Input of the raster kernels, in screen space. Attributes are pre-multiplied by invW
+struct SoftRasterVertex
+{
+	float x, y, z, invW;
+	Vec4 color;
+	Vec2 uv;
+};
+
+// Everything a raster kernel writes to or reads from
+struct SoftRasterContext
+{
+	uint32_t*				color;
+	float*					depth;
+	uint32_t				pitch;		// in texels, shared by color and depth
+	int32_t					width;
+	int32_t					height;
+	const SoftSurface*		texture;
+	// the coarser of the two wins, like D3D12_SHADING_RATE_COMBINER_MAX
+	SoftShadingRate			shadingRate = SoftShadingRate::Rate1x1;
+	const SoftSurface*		shadingRateImage = nullptr;
+};
+
+typedef void (*SoftVertexFetch)(const void* vertices, uint32_t stride, uint32_t count, const Mat4& worldViewProj, SoftClipVertex* out);
+typedef void (*SoftRasterKernel)(const SoftRasterContext& ctx, const SoftRasterVertex* vertices, uint32_t triangleCount);
+
+// Describes a pipeline state, like D3D12_GRAPHICS_PIPELINE_STATE_DESC does for the gpu
+struct SoftPipelineDesc
+{
+	SoftShader			shader = SoftShader::VertexColor;
+	SoftBlend			blend = SoftBlend::Opaque;
+	bool				depthEnable = true;
+	bool				depthWrite = true;
+	SoftCompare			depthFunc = SoftCompare::Less;
+	SoftCull			cull = SoftCull::Back;
+	bool				frontCounterClockwise = false;	// d3d default, clockwise triangles are front facing
+	SoftVertexLayout	layout = SoftVertexLayout::PosColor;
+
+	bool operator==(const SoftPipelineDesc& other) const;
+	bool operator!=(const SoftPipelineDesc& other) const { return !(*this == other); }
+};
+
+// Zeroes the fields that have no effect, so equivalent descriptions share a state
+SoftPipelineDesc CanonicalizePipelineDesc(const SoftPipelineDesc& desc);
+uint64_t HashPipelineDesc(const SoftPipelineDesc& desc);
+
+// Immutable, only created by SoftPipelineCache. Binding one is a pointer swap.
+class SoftPipelineState
+{
+public:
+	const SoftPipelineDesc		desc;
+	const uint64_t				hash;
+	const uint32_t				vertexStride;
+	const SoftVertexFetch		fetch;
+	const SoftRasterKernel		kernel;
+
+	SoftPipelineState(const SoftPipelineDesc& desc, uint64_t hash);
+	SoftPipelineState(const SoftPipelineState&) = delete;
+	SoftPipelineState& operator=(const SoftPipelineState&) = delete;
+};
+
+// Resolves each unique description once to a state with its specialized kernel
+class SoftPipelineCache
+{
+public:
+	const SoftPipelineState* GetPipelineState(const SoftPipelineDesc& desc);
+	size_t Size() const;
+
+private:
+	mutable std::mutex																	mutex;
+	std::unordered_map<uint64_t, std::vector<std::unique_ptr<SoftPipelineState>>>		states;	// bucketed by hash
+	size_t																				count = 0;
+};
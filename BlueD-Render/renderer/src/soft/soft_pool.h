@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Size and format of a pooled target, format is the backend's own enum value
+struct RenderTargetKey
+{
+	uint32_t	width = 0;
+	uint32_t	height = 0;
+	uint32_t	format = 0;
+
+	bool operator==(const RenderTargetKey& other) const { return width == other.width && height == other.height && format == other.format; }
+};
+
+struct RenderTargetPoolStats
+{
+	uint64_t	hits = 0;
+	uint64_t	misses = 0;
+	uint64_t	evictions = 0;
+};
+
+// Keeps released render targets for a few frames so resizes and per pass intermediates reuse them
+// instead of allocating and faulting in fresh memory. Target is any movable handle, a SoftSurface or a ComPtr.
+template <typename Target>
+class RenderTargetPool
+{
+public:
+	// a released target is handed out again once reuseAfterFrames frames have ended, which covers the frames
+	// a gpu may still be using it in, and dropped once keepFrames frames have ended without a taker
+	explicit RenderTargetPool(uint32_t reuseAfterFrames = 0, uint32_t keepFrames = 8)
+		: reuseAfterFrames(reuseAfterFrames), keepFrames(keepFrames) {}
+
+	// false when nothing fits, the caller creates the target then
+	bool Acquire(const RenderTargetKey& key, Target& target)
+	{
+		// the most recently released match first, its memory is the most likely to still be resident
+		for (size_t i = entries.size(); i-- > 0;)
+		{
+			Entry& entry = entries[i];
+			if (!(entry.key == key) || frame - entry.releasedFrame < reuseAfterFrames)
+				continue;
+			target = std::move(entry.target);
+			entries.erase(entries.begin() + i);
+			++stats.hits;
+			return true;
+		}
+		++stats.misses;
+		return false;
+	}
+
+	void Release(const RenderTargetKey& key, Target&& target)
+	{
+		entries.push_back({ key, std::move(target), frame });
+	}
+
+	// call once per frame, drops the targets nobody took within keepFrames
+	void EndFrame()
+	{
+		++frame;
+		for (size_t i = entries.size(); i-- > 0;)
+		{
+			if (frame - entries[i].releasedFrame > keepFrames)
+			{
+				entries.erase(entries.begin() + i);
+				++stats.evictions;
+			}
+		}
+	}
+
+	void Clear() { entries.clear(); }
+	size_t PooledCount() const { return entries.size(); }
+	const RenderTargetPoolStats& GetStats() const { return stats; }
+
+private:
+	struct Entry
+	{
+		RenderTargetKey		key;
+		Target				target;
+		uint64_t			releasedFrame;
+	};
+
+	std::vector<Entry>		entries;
+	uint64_t				frame = 0;
+	uint32_t				reuseAfterFrames;
+	uint32_t				keepFrames;
+	RenderTargetPoolStats	stats;
+};
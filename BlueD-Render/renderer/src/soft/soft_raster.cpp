@@ -0,0 +1,477 @@
+#include "soft_raster.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// screen coordinates are snapped to 24.8 fixed point before setup
+	const int32_t kSubPixelBits = 8;
+	const int64_t kSubPixel = 1 << kSubPixelBits;
+	// triangles are clipped against the near and far planes and against a guard band
+	// this many viewports wide, which keeps the fixed point edge functions in range
+	const float kGuardBand = 8.0f;
+
+	inline int64_t ToFixed(float v)
+	{
+		return static_cast<int64_t>(std::floor(v * kSubPixel + 0.5f));
+	}
+
+	// top-left fill rule, for the clockwise (positive area) winding triangles are set up in
+	inline bool IsTopLeft(int64_t ax, int64_t ay, int64_t bx, int64_t by)
+	{
+		return by < ay || (by == ay && bx > ax);
+	}
+
+	inline Vec4 UnpackColor(uint32_t c)
+	{
+		const float s = 1.0f / 255.0f;
+		return { (c & 0xff) * s, ((c >> 8) & 0xff) * s, ((c >> 16) & 0xff) * s, (c >> 24) * s };
+	}
+
+	inline Vec4 SampleTexture(const SoftSurface* texture, float u, float v)
+	{
+		if (!texture || texture->texels.empty())
+			return { 1.0f, 1.0f, 1.0f, 1.0f };
+
+		// nearest, wrap
+		int32_t w = static_cast<int32_t>(texture->width);
+		int32_t h = static_cast<int32_t>(texture->height);
+		int32_t x = static_cast<int32_t>(std::floor(u * w)) % w;
+		int32_t y = static_cast<int32_t>(std::floor(v * h)) % h;
+		if (x < 0) x += w;
+		if (y < 0) y += h;
+		return UnpackColor(texture->Row(y)[x]);
+	}
+
+	template <SoftCompare Func>
+	inline bool DepthPass(float z, float stored)
+	{
+		switch (Func)
+		{
+		case SoftCompare::Less: return z < stored;
+		case SoftCompare::LessEqual: return z <= stored;
+		case SoftCompare::Greater: return z > stored;
+		default: return true;
+		}
+	}
+
+	template <SoftShader Shader>
+	inline Vec4 ShadePixel(const SoftRasterContext& ctx, const Vec4& color, const Vec2& uv)
+	{
+		switch (Shader)
+		{
+		case SoftShader::VertexColor: return color;
+		case SoftShader::Texture: return SampleTexture(ctx.texture, uv.x, uv.y);
+		default: return SampleTexture(ctx.texture, uv.x, uv.y) * color;
+		}
+	}
+
+	template <SoftBlend Blend>
+	inline uint32_t BlendPixel(const Vec4& src, uint32_t dst)
+	{
+		switch (Blend)
+		{
+		case SoftBlend::Opaque:
+			return PackColor(src.x, src.y, src.z, src.w);
+		case SoftBlend::Alpha:
+		{
+			Vec4 d = UnpackColor(dst);
+			float a = src.w, ia = 1.0f - src.w;
+			return PackColor(src.x * a + d.x * ia, src.y * a + d.y * ia, src.z * a + d.z * ia, a + d.w * ia);
+		}
+		default:
+		{
+			Vec4 d = UnpackColor(dst);
+			float a = src.w;
+			return PackColor(src.x * a + d.x, src.y * a + d.y, src.z * a + d.z, d.w);
+		}
+		}
+	}
+
+	// width and height in pixels of the coarse pixels of a 4x4 block, from the draw's rate and the rate image tile
+	inline int32_t CoarsePixelSize(const SoftRasterContext& ctx, int32_t x, int32_t y)
+	{
+		SoftShadingRate rate = ctx.shadingRate;
+		const SoftSurface* image = ctx.shadingRateImage;
+		if (image && !image->texels.empty())
+		{
+			uint32_t tileX = (std::min)(static_cast<uint32_t>(x) / kShadingRateTileSize, image->width - 1);
+			uint32_t tileY = (std::min)(static_cast<uint32_t>(y) / kShadingRateTileSize, image->height - 1);
+			rate = (std::max)(rate, static_cast<SoftShadingRate>((std::min)(image->Row(tileY)[tileX], static_cast<uint32_t>(SoftShadingRate::Rate4x4))));
+		}
+		return 1 << static_cast<int32_t>(rate);
+	}
+
+	// The specialized raster kernel. Every branch on pipeline state is resolved at compile time.
+	// CullSign: +1 rejects clockwise triangles, -1 counter clockwise ones, 0 culls nothing
+	template <SoftShader Shader, SoftBlend Blend, SoftCompare DepthFunc, bool DepthTest, bool DepthWrite, int CullSign>
+	void RasterTriangles(const SoftRasterContext& ctx, const SoftRasterVertex* vertices, uint32_t triangleCount)
+	{
+		const bool needsColor = Shader != SoftShader::Texture;
+		const bool needsUV = Shader != SoftShader::VertexColor;
+
+		if ((DepthTest || DepthWrite) && !ctx.depth)
+			return;
+
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const SoftRasterVertex* v0 = &vertices[t * 3 + 0];
+			const SoftRasterVertex* v1 = &vertices[t * 3 + 1];
+			const SoftRasterVertex* v2 = &vertices[t * 3 + 2];
+
+			int64_t x0 = ToFixed(v0->x), y0 = ToFixed(v0->y);
+			int64_t x1 = ToFixed(v1->x), y1 = ToFixed(v1->y);
+			int64_t x2 = ToFixed(v2->x), y2 = ToFixed(v2->y);
+
+			// twice the signed area, positive for triangles that are clockwise on screen
+			int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+			if (area == 0)
+				continue;
+			if (CullSign > 0 && area > 0)
+				continue;
+			if (CullSign < 0 && area < 0)
+				continue;
+			if (area < 0)
+			{
+				std::swap(v1, v2);
+				std::swap(x1, x2);
+				std::swap(y1, y2);
+				area = -area;
+			}
+
+			// bounding box clipped to the target
+			int32_t minX = (std::max)(static_cast<int32_t>((std::min)({ x0, x1, x2 }) >> kSubPixelBits), 0);
+			int32_t minY = (std::max)(static_cast<int32_t>((std::min)({ y0, y1, y2 }) >> kSubPixelBits), 0);
+			int32_t maxX = (std::min)(static_cast<int32_t>((std::max)({ x0, x1, x2 }) >> kSubPixelBits), ctx.width - 1);
+			int32_t maxY = (std::min)(static_cast<int32_t>((std::max)({ y0, y1, y2 }) >> kSubPixelBits), ctx.height - 1);
+			if (minX > maxX || minY > maxY)
+				continue;
+
+			// edge functions evaluated at the first pixel center, w0 is the weight of v0 and so on
+			int64_t px = (static_cast<int64_t>(minX) << kSubPixelBits) + kSubPixel / 2;
+			int64_t py = (static_cast<int64_t>(minY) << kSubPixelBits) + kSubPixel / 2;
+			int64_t row0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1) + (IsTopLeft(x1, y1, x2, y2) ? 0 : -1);
+			int64_t row1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2) + (IsTopLeft(x2, y2, x0, y0) ? 0 : -1);
+			int64_t row2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0) + (IsTopLeft(x0, y0, x1, y1) ? 0 : -1);
+			const int64_t stepX0 = (y1 - y2) * kSubPixel, stepY0 = (x2 - x1) * kSubPixel;
+			const int64_t stepX1 = (y2 - y0) * kSubPixel, stepY1 = (x0 - x2) * kSubPixel;
+			const int64_t stepX2 = (y0 - y1) * kSubPixel, stepY2 = (x1 - x0) * kSubPixel;
+
+			// attribute deltas for barycentric interpolation
+			const float invArea = 1.0f / static_cast<float>(area);
+			const float dz1 = v1->z - v0->z, dz2 = v2->z - v0->z;
+			const float dw1 = v1->invW - v0->invW, dw2 = v2->invW - v0->invW;
+			const Vec4 dc1 = v1->color - v0->color, dc2 = v2->color - v0->color;
+			const Vec2 duv1 = { v1->uv.x - v0->uv.x, v1->uv.y - v0->uv.y };
+			const Vec2 duv2 = { v2->uv.x - v0->uv.x, v2->uv.y - v0->uv.y };
+
+			// perspective correct attributes at the point with the given edge weights
+			auto shade = [&](int64_t w1, int64_t w2) -> Vec4
+			{
+				float b1 = static_cast<float>(w1) * invArea;
+				float b2 = static_cast<float>(w2) * invArea;
+				float w = 1.0f / (v0->invW + b1 * dw1 + b2 * dw2);
+				Vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+				Vec2 uv = { 0.0f, 0.0f };
+				if (needsColor)
+					color = (v0->color + dc1 * b1 + dc2 * b2) * w;
+				if (needsUV)
+					uv = { (v0->uv.x + duv1.x * b1 + duv2.x * b2) * w, (v0->uv.y + duv1.y * b1 + duv2.y * b2) * w };
+				return ShadePixel<Shader>(ctx, color, uv);
+			};
+
+			if (ctx.shadingRate != SoftShadingRate::Rate1x1 || ctx.shadingRateImage)
+			{
+				// coarse shading walks 4x4 blocks aligned to the screen, so a block never straddles two rate image tiles.
+				// A coarse pixel is shaded once at its center when the first of its pixels passes coverage and depth
+				for (int32_t blockY = minY & ~3; blockY <= maxY; blockY += 4)
+				{
+					for (int32_t blockX = minX & ~3; blockX <= maxX; blockX += 4)
+					{
+						const int32_t size = CoarsePixelSize(ctx, blockX, blockY);
+						for (int32_t coarseY = blockY; coarseY < blockY + 4; coarseY += size)
+						{
+							for (int32_t coarseX = blockX; coarseX < blockX + 4; coarseX += size)
+							{
+								// the center is (size - 1) / 2 pixels from the first pixel center, the steps are multiples of kSubPixel so halving is exact
+								const int64_t offsetX = coarseX - minX, offsetY = coarseY - minY;
+								const int64_t center1 = row1 + offsetX * stepX1 + offsetY * stepY1 + (stepX1 + stepY1) * (size - 1) / 2;
+								const int64_t center2 = row2 + offsetX * stepX2 + offsetY * stepY2 + (stepX2 + stepY2) * (size - 1) / 2;
+								bool shaded = false;
+								Vec4 src;
+								for (int32_t y = (std::max)(coarseY, minY); y <= (std::min)(coarseY + size - 1, maxY); ++y)
+								{
+									uint32_t* colorRow = ctx.color + static_cast<size_t>(y) * ctx.pitch;
+									float* depthRow = (DepthTest || DepthWrite) ? ctx.depth + static_cast<size_t>(y) * ctx.pitch : nullptr;
+									for (int32_t x = (std::max)(coarseX, minX); x <= (std::min)(coarseX + size - 1, maxX); ++x)
+									{
+										int64_t w0 = row0 + (x - minX) * stepX0 + (y - minY) * stepY0;
+										int64_t w1 = row1 + (x - minX) * stepX1 + (y - minY) * stepY1;
+										int64_t w2 = row2 + (x - minX) * stepX2 + (y - minY) * stepY2;
+										if ((w0 | w1 | w2) < 0)
+											continue;
+
+										float z = v0->z + static_cast<float>(w1) * invArea * dz1 + static_cast<float>(w2) * invArea * dz2;
+										if (DepthTest && !DepthPass<DepthFunc>(z, depthRow[x]))
+											continue;
+
+										if (!shaded)
+										{
+											src = size == 1 ? shade(w1, w2) : shade(center1, center2);
+											shaded = true;
+										}
+										colorRow[x] = BlendPixel<Blend>(src, colorRow[x]);
+										if (DepthWrite)
+											depthRow[x] = z;
+									}
+								}
+							}
+						}
+					}
+				}
+				continue;
+			}
+
+			for (int32_t y = minY; y <= maxY; ++y)
+			{
+				int64_t w0 = row0, w1 = row1, w2 = row2;
+				uint32_t* colorRow = ctx.color + static_cast<size_t>(y) * ctx.pitch;
+				float* depthRow = (DepthTest || DepthWrite) ? ctx.depth + static_cast<size_t>(y) * ctx.pitch : nullptr;
+
+				for (int32_t x = minX; x <= maxX; ++x, w0 += stepX0, w1 += stepX1, w2 += stepX2)
+				{
+					if ((w0 | w1 | w2) < 0)
+						continue;
+
+					float b1 = static_cast<float>(w1) * invArea;
+					float b2 = static_cast<float>(w2) * invArea;
+					float z = v0->z + b1 * dz1 + b2 * dz2;
+					if (DepthTest && !DepthPass<DepthFunc>(z, depthRow[x]))
+						continue;
+
+					colorRow[x] = BlendPixel<Blend>(shade(w1, w2), colorRow[x]);
+					if (DepthWrite)
+						depthRow[x] = z;
+				}
+
+				row0 += stepY0;
+				row1 += stepY1;
+				row2 += stepY2;
+			}
+		}
+	}
+
+	template <SoftShader S, SoftBlend B, SoftCompare F, bool DepthTest, bool DepthWrite>
+	SoftRasterKernel SelectCull(int cullSign)
+	{
+		if (cullSign > 0) return &RasterTriangles<S, B, F, DepthTest, DepthWrite, 1>;
+		if (cullSign < 0) return &RasterTriangles<S, B, F, DepthTest, DepthWrite, -1>;
+		return &RasterTriangles<S, B, F, DepthTest, DepthWrite, 0>;
+	}
+
+	template <SoftShader S, SoftBlend B, SoftCompare F>
+	SoftRasterKernel SelectDepthWrite(bool depthWrite, int cullSign)
+	{
+		const bool test = F != SoftCompare::Always;
+		return depthWrite ? SelectCull<S, B, F, test, true>(cullSign) : SelectCull<S, B, F, test, false>(cullSign);
+	}
+
+	template <SoftShader S, SoftBlend B>
+	SoftRasterKernel SelectDepth(const SoftPipelineDesc& desc, int cullSign)
+	{
+		switch (desc.depthFunc)
+		{
+		case SoftCompare::Less: return SelectDepthWrite<S, B, SoftCompare::Less>(desc.depthWrite, cullSign);
+		case SoftCompare::LessEqual: return SelectDepthWrite<S, B, SoftCompare::LessEqual>(desc.depthWrite, cullSign);
+		case SoftCompare::Greater: return SelectDepthWrite<S, B, SoftCompare::Greater>(desc.depthWrite, cullSign);
+		default: return SelectDepthWrite<S, B, SoftCompare::Always>(desc.depthWrite, cullSign);
+		}
+	}
+
+	template <SoftShader S>
+	SoftRasterKernel SelectBlend(const SoftPipelineDesc& desc, int cullSign)
+	{
+		switch (desc.blend)
+		{
+		case SoftBlend::Opaque: return SelectDepth<S, SoftBlend::Opaque>(desc, cullSign);
+		case SoftBlend::Alpha: return SelectDepth<S, SoftBlend::Alpha>(desc, cullSign);
+		default: return SelectDepth<S, SoftBlend::Additive>(desc, cullSign);
+		}
+	}
+
+	inline void FetchAttributes(const SoftVertexPosColor& v, SoftClipVertex& out) { out.color = v.color; out.uv = { 0.0f, 0.0f }; }
+	inline void FetchAttributes(const SoftVertexPosColorUV& v, SoftClipVertex& out) { out.color = v.color; out.uv = v.uv; }
+	inline void FetchAttributes(const SoftVertexPosUV& v, SoftClipVertex& out) { out.color = { 1.0f, 1.0f, 1.0f, 1.0f }; out.uv = v.uv; }
+
+	template <class Vertex>
+	void FetchVertices(const void* vertices, uint32_t stride, uint32_t count, const Mat4& worldViewProj, SoftClipVertex* out)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(vertices);
+		for (uint32_t i = 0; i < count; ++i, src += stride)
+		{
+			const Vertex& v = *reinterpret_cast<const Vertex*>(src);
+			out[i].pos = Transform(v.pos, worldViewProj);
+			FetchAttributes(v, out[i]);
+		}
+	}
+
+	inline SoftClipVertex Lerp(const SoftClipVertex& a, const SoftClipVertex& b, float t)
+	{
+		SoftClipVertex r;
+		r.pos = a.pos + (b.pos - a.pos) * t;
+		r.color = a.color + (b.color - a.color) * t;
+		r.uv = { a.uv.x + (b.uv.x - a.uv.x) * t, a.uv.y + (b.uv.y - a.uv.y) * t };
+		return r;
+	}
+
+	// signed distance to each clip plane, inside when >= 0
+	inline float ClipDistance(const Vec4& p, int plane)
+	{
+		switch (plane)
+		{
+		case 0: return p.z;						// near
+		case 1: return p.w - p.z;				// far
+		case 2: return kGuardBand * p.w + p.x;
+		case 3: return kGuardBand * p.w - p.x;
+		case 4: return kGuardBand * p.w + p.y;
+		default: return kGuardBand * p.w - p.y;
+		}
+	}
+
+	const int kClipPlaneCount = 6;
+}
+
+uint32_t GetVertexStride(SoftVertexLayout layout)
+{
+	switch (layout)
+	{
+	case SoftVertexLayout::PosColor: return sizeof(SoftVertexPosColor);
+	case SoftVertexLayout::PosColorUV: return sizeof(SoftVertexPosColorUV);
+	default: return sizeof(SoftVertexPosUV);
+	}
+}
+
+SoftVertexFetch SelectVertexFetch(SoftVertexLayout layout)
+{
+	switch (layout)
+	{
+	case SoftVertexLayout::PosColor: return &FetchVertices<SoftVertexPosColor>;
+	case SoftVertexLayout::PosColorUV: return &FetchVertices<SoftVertexPosColorUV>;
+	default: return &FetchVertices<SoftVertexPosUV>;
+	}
+}
+
+SoftRasterKernel SelectRasterKernel(const SoftPipelineDesc& pipelineDesc)
+{
+	// a disabled depth test selects the Always/no write kernels
+	SoftPipelineDesc desc = CanonicalizePipelineDesc(pipelineDesc);
+
+	// clockwise triangles have a positive area on screen
+	int frontSign = desc.frontCounterClockwise ? -1 : 1;
+	int cullSign = desc.cull == SoftCull::Back ? -frontSign : desc.cull == SoftCull::Front ? frontSign : 0;
+
+	switch (desc.shader)
+	{
+	case SoftShader::VertexColor: return SelectBlend<SoftShader::VertexColor>(desc, cullSign);
+	case SoftShader::Texture: return SelectBlend<SoftShader::Texture>(desc, cullSign);
+	default: return SelectBlend<SoftShader::TextureModulate>(desc, cullSign);
+	}
+}
+
+void SoftRasterizer::DrawTriangles(const SoftPipelineState& state, const SoftRasterContext& ctx, const Mat4& worldViewProj,
+	const void* vertices, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	if (!ctx.color || vertexCount == 0)
+		return;
+
+	// vertex stage
+	clipVertices.resize(vertexCount);
+	state.fetch(vertices, stride, vertexCount, worldViewProj, clipVertices.data());
+
+	// primitive assembly and clipping
+	rasterVertices.clear();
+	uint32_t primitiveVertices = indices ? indexCount : vertexCount;
+	for (uint32_t i = 0; i + 2 < primitiveVertices; i += 3)
+	{
+		uint32_t i0 = indices ? indices[i + 0] : i + 0;
+		uint32_t i1 = indices ? indices[i + 1] : i + 1;
+		uint32_t i2 = indices ? indices[i + 2] : i + 2;
+		if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+			continue;
+		ClipTriangle(clipVertices[i0], clipVertices[i1], clipVertices[i2], ctx);
+	}
+
+	// raster stage
+	state.kernel(ctx, rasterVertices.data(), static_cast<uint32_t>(rasterVertices.size() / 3));
+}
+
+void SoftRasterizer::ClipTriangle(const SoftClipVertex& a, const SoftClipVertex& b, const SoftClipVertex& c, const SoftRasterContext& ctx)
+{
+	// trivial accept and reject
+	uint32_t outsideA = 0, outsideB = 0, outsideC = 0;
+	for (int plane = 0; plane < kClipPlaneCount; ++plane)
+	{
+		outsideA |= (ClipDistance(a.pos, plane) < 0.0f) << plane;
+		outsideB |= (ClipDistance(b.pos, plane) < 0.0f) << plane;
+		outsideC |= (ClipDistance(c.pos, plane) < 0.0f) << plane;
+	}
+	if (outsideA & outsideB & outsideC)
+		return;
+	if ((outsideA | outsideB | outsideC) == 0)
+	{
+		EmitVertex(a, ctx);
+		EmitVertex(b, ctx);
+		EmitVertex(c, ctx);
+		return;
+	}
+
+	// Sutherland-Hodgman, a triangle clipped by 6 planes has at most 9 vertices
+	SoftClipVertex polygon[2][12];
+	int count = 3;
+	polygon[0][0] = a; polygon[0][1] = b; polygon[0][2] = c;
+	int src = 0;
+	for (int plane = 0; plane < kClipPlaneCount && count > 0; ++plane)
+	{
+		if (!((outsideA | outsideB | outsideC) & (1u << plane)))
+			continue;
+
+		int dst = src ^ 1;
+		int outCount = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const SoftClipVertex& p = polygon[src][i];
+			const SoftClipVertex& q = polygon[src][(i + 1) % count];
+			float dp = ClipDistance(p.pos, plane);
+			float dq = ClipDistance(q.pos, plane);
+			if (dp >= 0.0f)
+				polygon[dst][outCount++] = p;
+			if ((dp >= 0.0f) != (dq >= 0.0f))
+				polygon[dst][outCount++] = Lerp(p, q, dp / (dp - dq));
+		}
+		count = outCount;
+		src = dst;
+	}
+
+	// triangle fan
+	for (int i = 1; i + 1 < count; ++i)
+	{
+		EmitVertex(polygon[src][0], ctx);
+		EmitVertex(polygon[src][i], ctx);
+		EmitVertex(polygon[src][i + 1], ctx);
+	}
+}
+
+void SoftRasterizer::EmitVertex(const SoftClipVertex& v, const SoftRasterContext& ctx)
+{
+	// perspective divide and viewport transform
+	float invW = 1.0f / v.pos.w;
+	SoftRasterVertex r;
+	r.x = (v.pos.x * invW * 0.5f + 0.5f) * ctx.width;
+	r.y = (0.5f - v.pos.y * invW * 0.5f) * ctx.height;
+	r.z = v.pos.z * invW;
+	r.invW = invW;
+	r.color = v.color * invW;
+	r.uv = { v.uv.x * invW, v.uv.y * invW };
+	rasterVertices.push_back(r);
+}
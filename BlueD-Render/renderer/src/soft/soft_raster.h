@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "soft_pipeline.h"
+
+uint32_t GetVertexStride(SoftVertexLayout layout);
+SoftVertexFetch SelectVertexFetch(SoftVertexLayout layout);
+// Picks the kernel instantiated for this combination of shader, blend, depth and cull state
+SoftRasterKernel SelectRasterKernel(const SoftPipelineDesc& desc);
+
+// Runs the fixed function part of a draw (vertex fetch, clipping, viewport transform)
+// and hands the resulting screen space triangles to the pipeline's kernel
+class SoftRasterizer
+{
+public:
+	void DrawTriangles(const SoftPipelineState& state, const SoftRasterContext& ctx, const Mat4& worldViewProj,
+		const void* vertices, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+private:
+	// reused between draws so steady state drawing does not allocate
+	std::vector<SoftClipVertex>		clipVertices;
+	std::vector<SoftRasterVertex>	rasterVertices;
+
+	void ClipTriangle(const SoftClipVertex& a, const SoftClipVertex& b, const SoftClipVertex& c, const SoftRasterContext& ctx);
+	void EmitVertex(const SoftClipVertex& v, const SoftRasterContext& ctx);
+};
@@ -0,0 +1,45 @@
+#include "soft_redraw.h"
+
+#include <algorithm>
+
+void RedrawScheduler::SetMinimumRefresh(float hz)
+{
+	minimumInterval = hz > 0.0f ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz)) : Clock::duration::zero();
+}
+
+void RedrawScheduler::ScheduleAt(Clock::time_point when)
+{
+	deadline = (std::min)(deadline, when);
+}
+
+bool RedrawScheduler::ShouldRender(Clock::time_point now) const
+{
+	if (dirty.load(std::memory_order_acquire) || animating || now >= deadline)
+		return true;
+	return minimumInterval > Clock::duration::zero() && now - lastFrame >= minimumInterval;
+}
+
+uint32_t RedrawScheduler::WaitTimeoutMs(Clock::time_point now) const
+{
+	if (ShouldRender(now))
+		return 0;
+
+	Clock::time_point wake = deadline;
+	if (minimumInterval > Clock::duration::zero())
+		wake = (std::min)(wake, lastFrame + minimumInterval);
+	if (wake == Clock::time_point::max())
+		return kWaitForever;
+
+	// rounded up, waking early would only spin through another wait
+	const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now + std::chrono::milliseconds(1) - Clock::duration(1)).count();
+	return static_cast<uint32_t>((std::min)(ms, static_cast<int64_t>(kWaitForever - 1)));
+}
+
+void RedrawScheduler::BeginFrame(Clock::time_point now)
+{
+	dirty.store(false, std::memory_order_release);
+	if (now >= deadline)
+		deadline = Clock::time_point::max();
+	lastFrame = now;
+	++frames;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Decides when an event driven main loop renders: once something changed, while an animation runs, at a
+// minimum refresh rate, or at a scheduled point like a debounced resize. In between, the loop blocks on
+// input and wake events for at most WaitTimeoutMs.
+class RedrawScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	// WaitTimeoutMs when only an event can make a frame due, same value as INFINITE
+	static const uint32_t kWaitForever = 0xffffffffu;
+
+	// the next frame is needed, e.g. after input or when an asset finished loading. Safe from any thread
+	void Invalidate() { dirty.store(true, std::memory_order_release); }
+	// while animating every loop iteration renders and presentation paces the frames
+	void SetAnimating(bool value) { animating = value; }
+	bool IsAnimating() const { return animating; }
+	// renders at least hz times a second even without changes, 0 turns it off
+	void SetMinimumRefresh(float hz);
+	// a frame is due at this point, the earliest one wins until a frame is rendered at or after it
+	void ScheduleAt(Clock::time_point when);
+
+	bool ShouldRender(Clock::time_point now = Clock::now()) const;
+	// how long the loop may block before ShouldRender turns true without an event
+	uint32_t WaitTimeoutMs(Clock::time_point now = Clock::now()) const;
+	// call right before rendering, clears the dirty state and the deadlines that passed. Invalidations
+	// during the frame make the next one due
+	void BeginFrame(Clock::time_point now = Clock::now());
+
+	uint64_t FrameCount() const { return frames; }
+
+private:
+	std::atomic<bool>			dirty{ true };	// the first frame is always rendered
+	bool						animating = false;
+	Clock::duration				minimumInterval = Clock::duration::zero();
+	Clock::time_point			lastFrame;
+	Clock::time_point			deadline = Clock::time_point::max();
+	uint64_t					frames = 0;
+};
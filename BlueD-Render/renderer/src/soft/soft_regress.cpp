@@ -0,0 +1,426 @@
+#include "soft_regress.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "soft_descriptors.h"
+#include "soft_fence.h"
+#include "soft_graph.h"
+#include "soft_image.h"
+#include "soft_renderer.h"
+
+namespace
+{
+	const uint32_t kWarmupFrames = 3;
+
+	struct Lab
+	{
+		float l, a, b;
+	};
+
+	struct LabTables
+	{
+		float	srgbToLinear[256];
+	};
+
+	const LabTables& GetLabTables()
+	{
+		static const LabTables tables = [] {
+			LabTables t;
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = i / 255.0f;
+				t.srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return t;
+		}();
+		return tables;
+	}
+
+	float LabF(float t)
+	{
+		return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f;
+	}
+
+	Lab ToLab(uint32_t texel)
+	{
+		const LabTables& tables = GetLabTables();
+		float r = tables.srgbToLinear[texel & 0xff];
+		float g = tables.srgbToLinear[(texel >> 8) & 0xff];
+		float b = tables.srgbToLinear[(texel >> 16) & 0xff];
+		// linear srgb to xyz, normalized by the D65 white point
+		float x = LabF((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+		float y = LabF(0.2126f * r + 0.7152f * g + 0.0722f * b);
+		float z = LabF((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+		return { 116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z) };
+	}
+
+	std::string GoldenPath(const SoftRegressionDesc& desc, SoftSceneId id, const char* suffix)
+	{
+		return desc.goldenDir + "/" + GetSceneName(id) + suffix;
+	}
+
+	std::string BaselinePath(const SoftRegressionDesc& desc)
+	{
+		return desc.goldenDir + "/baselines.txt";
+	}
+
+	// median frame time per scene, only for the resolution the suite runs at
+	void LoadBaselines(const SoftRegressionDesc& desc, double (&baselines)[static_cast<size_t>(SoftSceneId::Count)])
+	{
+		FILE* file = fopen(BaselinePath(desc).c_str(), "r");
+		if (!file)
+			return;
+		char line[256];
+		while (fgets(line, sizeof(line), file))
+		{
+			char name[64];
+			unsigned width = 0, height = 0;
+			double ms = 0.0;
+			if (sscanf(line, "%63s %ux%u %lf", name, &width, &height, &ms) != 4 || width != desc.width || height != desc.height)
+				continue;
+			for (uint32_t i = 0; i < static_cast<uint32_t>(SoftSceneId::Count); ++i)
+			{
+				if (strcmp(name, GetSceneName(static_cast<SoftSceneId>(i))) == 0)
+					baselines[i] = ms;
+			}
+		}
+		fclose(file);
+	}
+
+	void SaveBaselines(const SoftRegressionDesc& desc, const std::vector<SoftRegressionResult>& results)
+	{
+		FILE* file = fopen(BaselinePath(desc).c_str(), "w");
+		if (!file)
+			throw std::runtime_error("failed to write " + BaselinePath(desc));
+		fprintf(file, "# scene size median_ms, written by --regress --bless or --rebaseline\n");
+		for (const SoftRegressionResult& result : results)
+			fprintf(file, "%s %ux%u %.4f\n", GetSceneName(result.sceneId), desc.width, desc.height, result.medianMs);
+		fclose(file);
+	}
+
+	void Expect(SoftSelfCheckResult& result, bool condition, const char* what)
+	{
+		if (!condition && result.passed)
+		{
+			result.passed = false;
+			result.failure = what;
+		}
+	}
+
+	// a chain of three same sized transients where the third starts after the first was last read,
+	// plus a pass that only writes a transient nobody reads
+	SoftSelfCheckResult CheckRenderGraph()
+	{
+		SoftSelfCheckResult result;
+		result.name = "render graph";
+		FrameArena arena;
+		RenderGraph graph;
+		graph.Reset(&arena);
+
+		RenderGraphTextureDesc desc;
+		desc.width = 64;
+		desc.height = 32;
+		desc.format = SoftFormat::R8G8B8A8_UNORM;
+		RenderGraphResource output = graph.Import("output", SoftResourceState::Present, SoftResourceState::Present);
+		RenderGraphResource first = graph.CreateTransient("first", desc);
+		RenderGraphResource second = graph.CreateTransient("second", desc);
+		RenderGraphResource third = graph.CreateTransient("third", desc);
+		RenderGraphResource unused = graph.CreateTransient("unused", desc);
+
+		// the passes log their index when they run
+		std::vector<uint32_t> executed;
+		uint32_t passes[5];
+		const char* names[5] = { "first", "second", "third", "output", "unused" };
+		for (uint32_t i = 0; i < 5; ++i)
+			passes[i] = graph.AddPass(names[i], [&executed, i] { executed.push_back(i); });
+		graph.Write(passes[0], first);
+		graph.Read(passes[1], first);
+		graph.Write(passes[1], second);
+		graph.Read(passes[2], second);
+		graph.Write(passes[2], third);
+		graph.Read(passes[3], third);
+		graph.Write(passes[3], output);
+		graph.Write(passes[4], unused);
+		graph.Compile();
+
+		Expect(result, !graph.IsCulled(passes[0]) && !graph.IsCulled(passes[1]) && !graph.IsCulled(passes[2]) && !graph.IsCulled(passes[3]),
+			"a pass whose output reaches an imported resource was culled");
+		Expect(result, graph.IsCulled(passes[4]), "a pass writing only a transient nobody reads was not culled");
+		Expect(result, graph.GetStats().culledPasses == 1, "culled pass count");
+		Expect(result, graph.GetAliasSlotCount() == 2, "three transients of which two overlap should take two alias slots");
+		Expect(result, graph.GetAliasSlot(third) == graph.GetAliasSlot(first), "the third transient does not reuse the slot of the first");
+		Expect(result, graph.GetAliasSlot(second) != graph.GetAliasSlot(first), "overlapping transients share a slot");
+		Expect(result, graph.GetAliasSlot(unused) == kInvalidGraphResource, "the transient of a culled pass got a slot");
+		Expect(result, graph.GetStats().transientBytes == 3u * 64 * 32 * 4 && graph.GetStats().aliasedBytes == 2u * 64 * 32 * 4, "transient byte counts");
+
+		bool aliasBarrier = false;
+		graph.Execute([&](const RenderGraphBarrier* barriers, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				aliasBarrier = aliasBarrier || (barriers[i].resource == third && barriers[i].aliasedFrom == first);
+		});
+		Expect(result, aliasBarrier, "taking over the slot of the first transient has no aliasing barrier");
+		Expect(result, executed == std::vector<uint32_t>({ 0, 1, 2, 3 }), "the surviving passes did not run once each in order");
+
+		// reading a transient before anything wrote it is an error of the frame description
+		graph.Reset(&arena);
+		RenderGraphResource target = graph.Import("output", SoftResourceState::Present, SoftResourceState::Present);
+		RenderGraphResource unwritten = graph.CreateTransient("unwritten", desc);
+		uint32_t reader = graph.AddPass("reader", nullptr);
+		graph.Read(reader, unwritten);
+		graph.Write(reader, target);
+		bool threw = false;
+		try
+		{
+			graph.Compile();
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Expect(result, threw, "reading a transient before its first write did not throw");
+		graph.Reset();
+		return result;
+	}
+
+	template <typename Exception, typename Function>
+	bool Throws(Function function)
+	{
+		try
+		{
+			function();
+		}
+		catch (const Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	// 4 persistent handles and two frame slots of 8: [ 0..3 | 4..11 | 12..19 ]
+	SoftSelfCheckResult CheckDescriptorAllocator()
+	{
+		SoftSelfCheckResult result;
+		result.name = "descriptor allocator";
+		DescriptorAllocator allocator;
+		allocator.Init(4, 8, 2);
+		Expect(result, allocator.Capacity() == 20 && allocator.FrameRegionStart(0) == 4 && allocator.FrameRegionStart(1) == 12, "heap layout");
+
+		// persistent handles come from a free list, a freed one is handed out again
+		uint32_t first = allocator.AllocatePersistent();
+		uint32_t second = allocator.AllocatePersistent();
+		uint32_t third = allocator.AllocatePersistent();
+		Expect(result, first == 0 && second == 1 && third == 2, "persistent handles are not handed out in ascending order");
+		allocator.FreePersistent(second);
+		Expect(result, allocator.AllocatePersistent() == second, "a freed persistent handle is not reused");
+		Expect(result, allocator.AllocatePersistent() == 3, "the last persistent handle");
+		Expect(result, Throws<std::runtime_error>([&] { allocator.AllocatePersistent(); }), "a full persistent region did not throw");
+		allocator.FreePersistent(third);
+		Expect(result, Throws<std::logic_error>([&] { allocator.FreePersistent(third); }), "freeing a handle twice did not throw");
+		Expect(result, allocator.GetStats().persistentInUse == 3 && allocator.GetStats().persistentHighWater == 4, "persistent stats");
+
+		// frame handles are linear within the slot's region until it is full
+		allocator.BeginFrame(0, 0);
+		Expect(result, allocator.AllocateFrame(3) == 4 && allocator.AllocateFrame(5) == 7, "frame handles are not linear in the region of slot 0");
+		Expect(result, Throws<std::runtime_error>([&] { allocator.AllocateFrame(1); }), "a full frame region did not throw");
+		allocator.EndFrame(1);
+		allocator.BeginFrame(1, 0);
+		Expect(result, allocator.AllocateFrame(2) == 12, "slot 1 does not start at its own region");
+		allocator.EndFrame(2);
+
+		// slot 0 wraps around to the start of its region, but only once the fence passed its frame
+		Expect(result, Throws<std::logic_error>([&] { allocator.BeginFrame(0, 0); }), "a region still in flight was handed out again");
+		allocator.BeginFrame(0, 1);
+		Expect(result, allocator.AllocateFrame(8) == 4, "slot 0 did not start over at the beginning of its region");
+		allocator.EndFrame(3);
+		Expect(result, allocator.GetStats().frameHighWater == 8, "frame high water mark");
+		return result;
+	}
+
+	// FrameScheduler only sees the TimelineFence interface, the soft fence signaled from a second thread stands in for the queue
+	SoftSelfCheckResult CheckTimelineFence()
+	{
+		SoftSelfCheckResult result;
+		result.name = "timeline fence";
+		SoftTimelineFence fence;
+		Expect(result, !fence.WaitFor(1, 10), "waiting for a value nobody signals did not time out");
+
+		std::thread signaler([&fence]
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			fence.Signal(1);
+		});
+		fence.Wait(1);
+		signaler.join();
+		Expect(result, fence.GetCompletedValue() == 1, "a wait returned before the value was signaled");
+		fence.Signal(0);
+		Expect(result, fence.GetCompletedValue() == 1 && fence.WaitFor(1, 0), "the completed value went backwards");
+
+		// two frames in flight: frames 1 and 2 start without waiting, frame 3 waits for frame 1 to be signaled
+		FrameScheduler scheduler;
+		scheduler.Init(&fence, 2);
+		uint32_t firstSlot = scheduler.BeginFrame();
+		uint64_t firstValue = scheduler.EndFrame();
+		uint32_t secondSlot = scheduler.BeginFrame();
+		scheduler.EndFrame();
+		Expect(result, firstSlot != secondSlot && scheduler.StalledFrames() == 0, "a frame waited while fewer than two frames were pending");
+
+		signaler = std::thread([&fence, firstValue]
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			fence.Signal(firstValue);
+		});
+		uint32_t thirdSlot = scheduler.BeginFrame();
+		Expect(result, fence.GetCompletedValue() >= firstValue, "a frame started before the frame whose slot it reuses was signaled");
+		signaler.join();
+		Expect(result, thirdSlot == firstSlot && scheduler.StalledFrames() == 1, "the third frame did not wait for the slot of the first");
+		fence.Signal(scheduler.EndFrame());
+		scheduler.WaitIdle();
+		return result;
+	}
+}
+
+bool SoftImageDiff::Passes(const SoftImageTolerance& tolerance) const
+{
+	return pixelCount > 0 && failingPixels <= static_cast<uint32_t>(tolerance.failingFraction * pixelCount);
+}
+
+SoftImageDiff CompareImages(const SoftSurface& expected, const SoftSurface& actual, const SoftImageTolerance& tolerance, SoftSurface* heatmap)
+{
+	SoftImageDiff diff;
+	if (expected.width != actual.width || expected.height != actual.height)
+		return diff;
+
+	if (heatmap)
+		heatmap->Resize(actual.width, actual.height, SoftFormat::R8G8B8A8_UNORM);
+
+	double total = 0.0;
+	for (uint32_t y = 0; y < actual.height; ++y)
+	{
+		const uint32_t* expectedRow = expected.Row(y);
+		const uint32_t* actualRow = actual.Row(y);
+		for (uint32_t x = 0; x < actual.width; ++x)
+		{
+			float deltaE = 0.0f;
+			// identical rgb is the common case, skip the conversion
+			if (((expectedRow[x] ^ actualRow[x]) & 0x00ffffff) != 0)
+			{
+				Lab a = ToLab(expectedRow[x]);
+				Lab b = ToLab(actualRow[x]);
+				deltaE = std::sqrt((a.l - b.l) * (a.l - b.l) + (a.a - b.a) * (a.a - b.a) + (a.b - b.b) * (a.b - b.b));
+			}
+			total += deltaE;
+			diff.maxDeltaE = (std::max)(diff.maxDeltaE, deltaE);
+			bool failing = deltaE > tolerance.pixelDeltaE;
+			if (failing)
+				++diff.failingPixels;
+
+			if (heatmap)
+			{
+				float gray = (std::min)(deltaE / tolerance.pixelDeltaE, 1.0f) * 0.5f;
+				heatmap->Row(y)[x] = failing ? PackColor(1.0f, 0.0f, 0.0f, 1.0f) : PackColor(gray, gray, gray, 1.0f);
+			}
+		}
+	}
+	diff.pixelCount = actual.width * actual.height;
+	diff.meanDeltaE = diff.pixelCount ? static_cast<float>(total / diff.pixelCount) : 0.0f;
+	return diff;
+}
+
+std::vector<SoftRegressionResult> RunRegression(const SoftRegressionDesc& desc)
+{
+	double baselines[static_cast<size_t>(SoftSceneId::Count)] = {};
+	if (!desc.bless && !desc.rebaseline)
+		LoadBaselines(desc, baselines);
+
+	std::unique_ptr<SoftThreadPool> recordPool;
+	if (desc.recordThreads > 0)
+		recordPool.reset(new SoftThreadPool(desc.recordThreads));
+
+	std::vector<SoftRegressionResult> results;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(SoftSceneId::Count); ++i)
+	{
+		SoftRegressionResult result;
+		result.sceneId = static_cast<SoftSceneId>(i);
+
+		// a fresh renderer per scene so no state carries over between cases
+		SoftRenderer renderer;
+		renderer.Init(desc.width, desc.height);
+		renderer.sceneId = result.sceneId;
+		renderer.recordPool = recordPool.get();
+		for (uint32_t frame = 0; frame < kWarmupFrames; ++frame)
+		{
+			renderer.Render(desc.time);
+			renderer.Present();
+		}
+
+		std::vector<double> timings;
+		timings.reserve(desc.iterations);
+		for (uint32_t iteration = 0; iteration < desc.iterations; ++iteration)
+		{
+			auto start = std::chrono::steady_clock::now();
+			renderer.Render(desc.time);
+			auto end = std::chrono::steady_clock::now();
+			renderer.Present();
+			timings.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		if (!timings.empty())
+		{
+			std::sort(timings.begin(), timings.end());
+			result.medianMs = timings[timings.size() / 2];
+		}
+
+		// every frame renders the same time, so the last one is the image under test
+		renderer.Render(desc.time);
+		const SoftSurface& image = renderer.GetFrame();
+
+		if (desc.bless)
+		{
+			WriteImageFile(GoldenPath(desc, result.sceneId, ".png").c_str(), SoftImageFormat::Png, image);
+			result.hasGolden = true;
+			result.imagePassed = true;
+		}
+		else
+		{
+			SoftSurface golden;
+			result.hasGolden = ReadPngFile(GoldenPath(desc, result.sceneId, ".png").c_str(), golden);
+			if (result.hasGolden)
+			{
+				SoftSurface heatmap;
+				result.diff = CompareImages(golden, image, desc.imageTolerance, &heatmap);
+				result.imagePassed = result.diff.Passes(desc.imageTolerance);
+				if (!result.imagePassed)
+				{
+					WriteImageFile(GoldenPath(desc, result.sceneId, ".actual.png").c_str(), SoftImageFormat::Png, image);
+					if (heatmap.width == image.width && heatmap.height == image.height)
+						WriteImageFile(GoldenPath(desc, result.sceneId, ".diff.png").c_str(), SoftImageFormat::Png, heatmap);
+				}
+			}
+
+			result.baselineMs = baselines[i];
+			if (result.baselineMs > 0.0)
+				result.perfPassed = result.medianMs <= result.baselineMs * (1.0 + desc.perfTolerance);
+		}
+		results.push_back(result);
+	}
+
+	if (desc.bless || desc.rebaseline)
+		SaveBaselines(desc, results);
+	return results;
+}
+
+std::vector<SoftSelfCheckResult> RunSelfChecks()
+{
+	std::vector<SoftSelfCheckResult> results;
+	results.push_back(CheckRenderGraph());
+	results.push_back(CheckDescriptorAllocator());
+	results.push_back(CheckTimelineFence());
+	return results;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "soft_scene.h"
+#include "soft_surface.h"
+
+struct SoftImageTolerance
+{
+	float		pixelDeltaE = 2.3f;			// CIE76 difference a pixel may have, about one just noticeable difference
+	float		failingFraction = 0.001f;	// share of pixels allowed above pixelDeltaE, absorbs edge coverage changes
+};
+
+struct SoftImageDiff
+{
+	float		maxDeltaE = 0.0f;
+	float		meanDeltaE = 0.0f;
+	uint32_t	failingPixels = 0;
+	uint32_t	pixelCount = 0;
+
+	bool Passes(const SoftImageTolerance& tolerance) const;
+};
+
+// Perceptual difference of two color surfaces in CIELAB, alpha is ignored.
+// The heatmap, when given, shows the difference in gray and failing pixels in red.
+SoftImageDiff CompareImages(const SoftSurface& expected, const SoftSurface& actual, const SoftImageTolerance& tolerance, SoftSurface* heatmap);
+
+struct SoftRegressionDesc
+{
+	std::string				goldenDir;
+	uint32_t				width = 640;
+	uint32_t				height = 400;
+	uint32_t				iterations = 30;
+	float					time = 0.5f;			// animation time every image is taken at
+	float					perfTolerance = 0.25f;	// slower than the baseline by more than this fails
+	bool					bless = false;			// replaces the goldens and baselines with this run
+	bool					rebaseline = false;		// replaces only the baselines, they are specific to the machine
+	uint32_t				recordThreads = 0;		// records the scenes in slices on this many workers, 0 records on the calling thread
+	SoftImageTolerance		imageTolerance;
+};
+
+struct SoftRegressionResult
+{
+	SoftSceneId				sceneId;
+	bool					hasGolden = false;
+	bool					imagePassed = false;
+	SoftImageDiff			diff;
+	double					medianMs = 0.0;
+	double					baselineMs = 0.0;		// 0 when there is no baseline
+	bool					perfPassed = true;
+};
+
+struct SoftSelfCheckResult
+{
+	const char*				name = "";
+	bool					passed = true;
+	std::string				failure;				// the first expectation that did not hold
+};
+
+// Device free checks of the frame infrastructure the scenes only exercise in one configuration
+std::vector<SoftSelfCheckResult> RunSelfChecks();
+
+// Renders every scene headlessly, compares it with <goldenDir>/<scene>.png and times it against
+// <goldenDir>/baselines.txt. Failing scenes also get <scene>.actual.png and <scene>.diff.png.
+std::vector<SoftRegressionResult> RunRegression(const SoftRegressionDesc& desc);
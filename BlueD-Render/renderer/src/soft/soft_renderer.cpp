@@ -0,0 +1,173 @@
+#include "soft_renderer.h"
+
+#include <algorithm>
+#include <utility>
+
+void SoftRenderer::Init(uint32_t w, uint32_t h)
+{
+	scene.Init(pipelineCache);
+	frameArenas.Init(2);
+	graphSurfaces.pool = &targetPool;
+	Resize(w, h);
+	// the color target plays the back buffer, so it rests in the present state between frames
+	colorTarget.state = SoftResourceState::Present;
+	pendingUploads = true;
+}
+
+void SoftRenderer::Resize(uint32_t w, uint32_t h)
+{
+	width = w;
+	height = h;
+	ResizeTarget(colorTarget, w, h, SoftFormat::R8G8B8A8_UNORM);
+}
+
+void SoftRenderer::ResizeTarget(SoftSurface& target, uint32_t w, uint32_t h, SoftFormat format)
+{
+	if (target.width == w && target.height == h && target.format == format)
+		return;
+	// a pooled target keeps the state it was released in, the graph picks it up from there
+	SoftResourceState state = target.state;
+	if (!target.texels.empty())
+		targetPool.Release({ target.width, target.height, static_cast<uint32_t>(target.format) }, std::move(target));
+	target = SoftSurface();
+	if (!targetPool.Acquire({ w, h, static_cast<uint32_t>(format) }, target))
+	{
+		target.Resize(w, h, format);
+		target.state = state;
+	}
+}
+
+void SoftRenderer::Render(float time)
+{
+	float aspect = height ? static_cast<float>(width) / static_cast<float>(height) : 1.0f;
+	// the queue executes on this thread, so every earlier frame has finished by now
+	FrameArena& arena = frameArenas.BeginFrame(renderedFrames % frameArenas.FrameCount(), renderedFrames);
+
+	// no initial pipeline state, the scene sets one before every draw
+	commandList.Reset(nullptr);
+	currentList = &commandList;
+	submitLists.clear();
+	submitLists.push_back(&commandList);
+
+	frameRateImage = shadingRateImage;
+	if (frameRateImage == nullptr && scene.BuildShadingRateImage(sceneId, width, height, sceneRateImage))
+		frameRateImage = &sceneRateImage;
+
+	graph.Reset(&arena);
+	drawItems = ArenaVector<SoftDrawItem>(ArenaAllocator<SoftDrawItem>(&arena));
+	// the color target plays the back buffer and goes back to present. Depth is cleared by the scene
+	// and nobody reads it after the frame, so it is a transient in an alias slot of the graph
+	RenderGraphResource color = graph.Import("color", colorTarget.state, SoftResourceState::Present);
+	graphSurfaces.Bind(color, &colorTarget);
+	RenderGraphTextureDesc depthDesc;
+	depthDesc.width = width;
+	depthDesc.height = height;
+	depthDesc.format = SoftFormat::D32_FLOAT;
+	RenderGraphResource depth = graph.CreateTransient("depth", depthDesc);
+
+	if (pendingUploads)
+	{
+		uint32_t uploadPass = graph.AddPass("uploads", [this] { scene.RecordUploads(*currentList); });
+		graph.KeepAlive(uploadPass);
+		pendingUploads = false;
+	}
+
+	uint32_t scenePass = graph.AddPass("scene", [this, aspect, time] { RecordScene(aspect, time); });
+	graph.Write(scenePass, color, SoftResourceState::RenderTarget);
+	graph.Write(scenePass, depth, SoftResourceState::DepthWrite);
+
+	graph.Compile();
+	graphSurfaces.Realize(graph);
+	depthTarget = graphSurfaces.Get(depth);
+	graph.Execute([this](const RenderGraphBarrier* barriers, size_t count)
+	{
+		graphSurfaces.RecordBarriers(*currentList, barriers, count);
+	});
+	currentList->Close();
+
+	commandQueue.ExecuteCommandLists(static_cast<uint32_t>(submitLists.size()), submitLists.data());
+	depthTarget = nullptr;
+	frameArenas.EndFrame(++renderedFrames);
+}
+
+void SoftRenderer::RecordScene(float aspect, float time)
+{
+	commandList.OMSetRenderTargets(&colorTarget, depthTarget);
+	if (frameRateImage)
+		commandList.RSSetShadingRateImage(frameRateImage);
+	commandList.ClearRenderTargetView(&colorTarget, clearColor);
+	commandList.ClearDepthStencilView(depthTarget, 1.0f);
+
+	scene.BuildDrawItems(sceneId, camera.ViewProj(aspect), time, drawItems);
+
+	uint32_t sliceCount = 1;
+	if (recordPool && minDrawsPerSlice > 0)
+		sliceCount = (std::max)(1u, (std::min)(static_cast<uint32_t>(drawItems.size() / minDrawsPerSlice), recordPool->ThreadCount() + 1));
+
+	if (sliceCount == 1)
+	{
+		scene.RecordDrawItems(commandList, drawItems.data(), drawItems.size());
+		return;
+	}
+
+	commandList.Close();
+	while (sliceLists.size() < sliceCount)
+		sliceLists.emplace_back(new SoftCommandList());
+
+	recordPool->ParallelFor(sliceCount, [this, sliceCount](uint32_t slice)
+	{
+		size_t begin = drawItems.size() * slice / sliceCount;
+		size_t end = drawItems.size() * (slice + 1) / sliceCount;
+		SoftCommandList& list = *sliceLists[slice];
+		list.Reset(nullptr);
+		list.OMSetRenderTargets(&colorTarget, depthTarget);
+		if (frameRateImage)
+			list.RSSetShadingRateImage(frameRateImage);
+		scene.RecordDrawItems(list, drawItems.data() + begin, end - begin);
+		list.Close();
+	});
+	for (uint32_t slice = 0; slice < sliceCount; ++slice)
+		submitLists.push_back(sliceLists[slice].get());
+
+	// whatever the graph records after this pass goes into the end list
+	endList.Reset(nullptr);
+	submitLists.push_back(&endList);
+	currentList = &endList;
+}
+
+void SoftRenderer::Present()
+{
+	if (captureFramesLeft)
+	{
+		capture.RecordFrameEnd();
+		if (--captureFramesLeft == 0)
+		{
+			capture.End();
+			commandQueue.capture = nullptr;
+		}
+	}
+
+	if (exporter)
+	{
+		exporter->Submit(std::move(colorTarget), frameIndex);
+		colorTarget = exporter->AcquireSurface(width, height, SoftFormat::R8G8B8A8_UNORM);
+		colorTarget.state = SoftResourceState::Present;
+	}
+	else if (swapChain)
+	{
+		swapChain->Present(std::move(colorTarget));
+		colorTarget = swapChain->AcquireBuffer(width, height, SoftFormat::R8G8B8A8_UNORM);
+		colorTarget.state = SoftResourceState::Present;
+	}
+	targetPool.EndFrame();
+	++frameIndex;
+}
+
+void SoftRenderer::CaptureFrames(const char* path, uint32_t frameCount)
+{
+	if (frameCount == 0)
+		return;
+	capture.Begin(path);
+	captureFramesLeft = frameCount;
+	commandQueue.capture = &capture;
+}
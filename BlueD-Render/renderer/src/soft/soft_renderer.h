@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "soft_arena.h"
+#include "soft_capture.h"
+#include "soft_command.h"
+#include "soft_export.h"
+#include "soft_graph.h"
+#include "soft_jobs.h"
+#include "soft_pipeline.h"
+#include "soft_pool.h"
+#include "soft_scene.h"
+#include "soft_surface.h"
+#include "soft_swapchain.h"
+
+// The software render path: owns the targets and records and executes one frame of the scene
+class SoftRenderer
+{
+public:
+	uint32_t					width = 0;
+	uint32_t					height = 0;
+	SoftPipelineCache			pipelineCache;
+	SoftCommandQueue			commandQueue;
+	SoftCommandList				commandList;
+	SoftSurface					colorTarget;
+	// depth only lives within a frame, it is a graph transient. Set while the frame is recorded
+	SoftSurface*				depthTarget = nullptr;
+	SoftScene					scene;
+	SoftSceneId					sceneId = SoftSceneId::All;
+	SoftCamera					camera;
+	float						clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
+	// one SoftShadingRate per kShadingRateTileSize square tile, combined with the rate of each draw. Without one
+	// the scene's own rate image is used, if it has one
+	const SoftSurface*			shadingRateImage = nullptr;
+	SoftSurface					sceneRateImage;
+	// the rate image of the frame being recorded
+	const SoftSurface*			frameRateImage = nullptr;
+	bool						pendingUploads = true;
+	SoftCaptureWriter			capture;
+	uint32_t					captureFramesLeft = 0;
+	SoftFrameExporter*			exporter = nullptr;
+	// without an exporter, finished frames are presented to this swap chain and rendering continues in its next buffer
+	SoftSwapChain*				swapChain = nullptr;
+	uint32_t					frameIndex = 0;
+	// transient cpu data of a frame: the graph, the draw items. Frames finish within Render, two slots
+	// keep the previous frame's data alive until the graph drops it
+	FrameArenas					frameArenas;
+	uint64_t					renderedFrames = 0;
+	// with a pool the scene is recorded in slices of at least minDrawsPerSlice draws on its workers,
+	// the slices are submitted in scene order so the image does not depend on the thread count
+	SoftThreadPool*				recordPool = nullptr;
+	uint32_t					minDrawsPerSlice = 64;
+	std::vector<std::unique_ptr<SoftCommandList>>	sliceLists;
+	SoftCommandList				endList;
+	ArenaVector<SoftDrawItem>	drawItems;
+	std::vector<const SoftCommandList*>	submitLists;
+	// the frame is declared as a render graph, it derives every transition of the targets
+	RenderGraph					graph;
+	SoftGraphSurfaces			graphSurfaces;
+	SoftCommandList*			currentList = nullptr;
+	// targets given up by resizes and graph slots, reused when the same size and format come back
+	RenderTargetPool<SoftSurface>	targetPool;
+
+	void Init(uint32_t w, uint32_t h);
+	void Resize(uint32_t w, uint32_t h);
+	void Render(float time);
+	// ends the frame, with an exporter or a swap chain attached the finished color target is handed over to it
+	// and rendering continues on recycled storage, so read GetFrame before presenting
+	void Present();
+	// records the next frames into a capture file for offline replay
+	void CaptureFrames(const char* path, uint32_t frameCount);
+
+	const SoftSurface& GetFrame() const { return colorTarget; }
+
+private:
+	void RecordScene(float aspect, float time);
+	void ResizeTarget(SoftSurface& target, uint32_t w, uint32_t h, SoftFormat format);
+};
@@ -0,0 +1,22 @@
+#include "soft_resize.h"
+
+void ResizeDebouncer::Request(uint32_t width, uint32_t height, Clock::time_point now)
+{
+	pendingWidth = width;
+	pendingHeight = height;
+	lastRequest = now;
+	pending = true;
+	++requests;
+}
+
+bool ResizeDebouncer::Poll(uint32_t& width, uint32_t& height, Clock::time_point now)
+{
+	if (!pending || (!flushed && now - lastRequest < debounce))
+		return false;
+	width = pendingWidth;
+	height = pendingHeight;
+	pending = false;
+	flushed = false;
+	++applies;
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Collapses a burst of resize requests into one. The last requested size is handed out once no new
+// request came in for debounceMs, or on the next poll after Flush, e.g. when the user lets go of the border.
+class ResizeDebouncer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	explicit ResizeDebouncer(uint32_t debounceMs = 100) : debounce(debounceMs) {}
+
+	void Request(uint32_t width, uint32_t height, Clock::time_point now = Clock::now());
+	void Flush() { flushed = pending; }
+	// true once per burst, with the size to reallocate for
+	bool Poll(uint32_t& width, uint32_t& height, Clock::time_point now = Clock::now());
+
+	bool IsPending() const { return pending; }
+	// when a pending request is handed out at the latest, for loops that sleep until then
+	Clock::time_point Deadline() const { return flushed ? lastRequest : lastRequest + debounce; }
+	uint64_t RequestCount() const { return requests; }
+	// reallocations the requests were collapsed into
+	uint64_t ApplyCount() const { return applies; }
+
+private:
+	std::chrono::milliseconds	debounce;
+	Clock::time_point			lastRequest;
+	uint32_t					pendingWidth = 0;
+	uint32_t					pendingHeight = 0;
+	bool						pending = false;
+	bool						flushed = false;
+	uint64_t					requests = 0;
+	uint64_t					applies = 0;
+};
@@ -0,0 +1,57 @@
+#include "soft_ring.h"
+
+#include <algorithm>
+
+void RingAllocator::Init(uint64_t ringCapacity)
+{
+	capacity = ringCapacity;
+	head = 0;
+	used = 0;
+	frameBytes = 0;
+	frames.clear();
+	stats = RingAllocatorStats();
+	stats.capacity = capacity;
+}
+
+uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	uint64_t offset = (head + alignment - 1) & ~(alignment - 1);
+	uint64_t needed = offset - head + size;
+	// a range never wraps, the tail end of the ring is skipped instead and counts as used until the frame retires
+	if (offset + size > capacity)
+	{
+		offset = 0;
+		needed = capacity - head + size;
+	}
+	if (size > capacity || used + needed > capacity)
+	{
+		++stats.failedAllocations;
+		return kInvalidOffset;
+	}
+
+	head = offset + size == capacity ? 0 : offset + size;
+	used += needed;
+	frameBytes += needed;
+	++stats.allocations;
+	stats.used = used;
+	stats.highWater = (std::max)(stats.highWater, used);
+	return offset;
+}
+
+void RingAllocator::EndFrame(uint64_t fenceValue)
+{
+	stats.frameHighWater = (std::max)(stats.frameHighWater, frameBytes);
+	if (frameBytes > 0)
+		frames.push_back({ fenceValue, frameBytes });
+	frameBytes = 0;
+}
+
+void RingAllocator::Retire(uint64_t completedFenceValue)
+{
+	while (!frames.empty() && frames.front().fenceValue <= completedFenceValue)
+	{
+		used -= frames.front().bytes;
+		frames.pop_front();
+	}
+	stats.used = used;
+}
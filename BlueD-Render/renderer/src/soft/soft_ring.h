@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+struct RingAllocatorStats
+{
+	uint64_t	capacity = 0;
+	uint64_t	used = 0;				// bytes held by frames the gpu has not retired yet
+	uint64_t	highWater = 0;			// the most that was ever held at once
+	uint64_t	frameHighWater = 0;		// the largest single frame
+	uint64_t	allocations = 0;
+	uint64_t	failedAllocations = 0;	// allocations that found the ring full
+};
+
+// Hands out byte ranges of a fixed size ring for per frame data. Everything allocated between two EndFrame calls
+// is tagged with that frame's fence value and reclaimed as a whole once Retire sees the fence pass it.
+// The ring only does the bookkeeping, the memory behind the offsets belongs to the caller. Not thread safe.
+class RingAllocator
+{
+public:
+	static const uint64_t kInvalidOffset = ~0ull;
+
+	void Init(uint64_t capacity);
+	// kInvalidOffset when the range does not fit until older frames retire, alignment is a power of two
+	uint64_t Allocate(uint64_t size, uint64_t alignment);
+	// closes the current frame, its ranges come back once the fence reaches fenceValue
+	void EndFrame(uint64_t fenceValue);
+	void Retire(uint64_t completedFenceValue);
+
+	bool HasPendingFrames() const { return !frames.empty(); }
+	// the fence value to wait for to free the oldest frame
+	uint64_t OldestPendingFence() const { return frames.empty() ? 0 : frames.front().fenceValue; }
+	const RingAllocatorStats& GetStats() const { return stats; }
+
+private:
+	struct Frame
+	{
+		uint64_t	fenceValue;
+		uint64_t	bytes;
+	};
+
+	uint64_t			capacity = 0;
+	uint64_t			head = 0;
+	uint64_t			used = 0;
+	uint64_t			frameBytes = 0;
+	std::deque<Frame>	frames;
+	RingAllocatorStats	stats;
+};
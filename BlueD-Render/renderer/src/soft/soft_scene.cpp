@@ -0,0 +1,320 @@
+#include "soft_scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const Vec4 kFaceColors[6] = {
+		{ 0.90f, 0.30f, 0.25f, 1.0f },
+		{ 0.30f, 0.75f, 0.35f, 1.0f },
+		{ 0.25f, 0.45f, 0.90f, 1.0f },
+		{ 0.95f, 0.80f, 0.25f, 1.0f },
+		{ 0.70f, 0.35f, 0.85f, 1.0f },
+		{ 0.30f, 0.80f, 0.85f, 1.0f },
+	};
+
+	const Vec4 kQuadColors[3] = {
+		{ 1.0f, 0.2f, 0.2f, 0.5f },
+		{ 0.2f, 1.0f, 0.2f, 0.5f },
+		{ 0.2f, 0.2f, 1.0f, 0.5f },
+	};
+
+	// Appends the 4 corners of a unit box face, clockwise when seen from outside
+	template <class Vertex, class MakeVertex>
+	void AppendFace(std::vector<Vertex>& vertices, std::vector<uint32_t>* indices, const Vec3& normal, const Vec3& up, MakeVertex makeVertex)
+	{
+		Vec3 right = Cross(up, normal * -1.0f);
+		const Vec3 corners[4] = {
+			normal - right + up,	// top left
+			normal + right + up,	// top right
+			normal + right - up,	// bottom right
+			normal - right - up,	// bottom left
+		};
+		const Vec2 uvs[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+		uint32_t base = static_cast<uint32_t>(vertices.size());
+		for (int i = 0; i < 4; ++i)
+			vertices.push_back(makeVertex(corners[i] * 0.5f, uvs[i]));
+
+		if (indices)
+		{
+			const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+			for (uint32_t index : quad)
+				indices->push_back(base + index);
+		}
+	}
+
+	const Vec3 kFaceNormals[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 } };
+	const Vec3 kFaceUps[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0, 0, 1 } };
+}
+
+const char* GetSceneName(SoftSceneId id)
+{
+	switch (id)
+	{
+	case SoftSceneId::Box: return "box";
+	case SoftSceneId::DepthTest: return "depth_test";
+	case SoftSceneId::Culling: return "culling";
+	case SoftSceneId::Blending: return "blending";
+	case SoftSceneId::Texture: return "texture";
+	case SoftSceneId::All: return "all";
+	case SoftSceneId::Crowd: return "crowd";
+	case SoftSceneId::Coarse: return "coarse";
+	case SoftSceneId::Foveated: return "foveated";
+	default: return "unknown";
+	}
+}
+
+Mat4 SoftCamera::ViewProj(float aspect) const
+{
+	return Mat4::LookAtLH(eye, target, up) * Mat4::PerspectiveFovLH(fovY, aspect, zNear, zFar);
+}
+
+void SoftScene::Init(SoftPipelineCache& pipelineCache)
+{
+	// meshes
+	boxVertices.clear();
+	texturedBoxVertices.clear();
+	boxIndices.clear();
+	for (int face = 0; face < 6; ++face)
+	{
+		Vec4 color = kFaceColors[face];
+		AppendFace(boxVertices, &boxIndices, kFaceNormals[face], kFaceUps[face],
+			[color](const Vec3& pos, const Vec2&) { return SoftVertexPosColor{ pos, color }; });
+		AppendFace(texturedBoxVertices, nullptr, kFaceNormals[face], kFaceUps[face],
+			[color](const Vec3& pos, const Vec2& uv) { return SoftVertexPosColorUV{ pos, color, uv }; });
+	}
+
+	quadVertices.clear();
+	quadIndices = { 0, 1, 2, 0, 2, 3 };
+	for (const Vec4& color : kQuadColors)
+	{
+		AppendFace(quadVertices, nullptr, { 0, 0, -1 }, { 0, 1, 0 },
+			[color](const Vec3& pos, const Vec2&) { return SoftVertexPosColor{ { pos.x, pos.y, 0.0f }, color }; });
+	}
+
+	// checker texture
+	const uint32_t size = 64, cell = 8;
+	checkerTexture.Resize(size, size, SoftFormat::R8G8B8A8_UNORM);
+	checkerPixels.resize(static_cast<size_t>(size) * size);
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+			checkerPixels[y * size + x] = ((x / cell + y / cell) & 1) ? PackColor(1.0f, 1.0f, 1.0f, 1.0f) : PackColor(0.15f, 0.15f, 0.2f, 1.0f);
+	}
+
+	// pipeline states
+	SoftPipelineDesc desc;
+	opaqueState = pipelineCache.GetPipelineState(desc);
+
+	desc.cull = SoftCull::Front;
+	cullFrontState = pipelineCache.GetPipelineState(desc);
+
+	desc.cull = SoftCull::None;
+	desc.blend = SoftBlend::Alpha;
+	desc.depthWrite = false;
+	blendState = pipelineCache.GetPipelineState(desc);
+
+	desc = SoftPipelineDesc();
+	desc.shader = SoftShader::TextureModulate;
+	desc.layout = SoftVertexLayout::PosColorUV;
+	textureState = pipelineCache.GetPipelineState(desc);
+}
+
+void SoftScene::RecordUploads(SoftCommandList& commandList)
+{
+	commandList.ResourceBarrier(&checkerTexture, checkerTexture.state, SoftResourceState::CopyDest);
+	commandList.UpdateSubresource(&checkerTexture, checkerPixels.data());
+	commandList.ResourceBarrier(&checkerTexture, SoftResourceState::CopyDest, SoftResourceState::ShaderResource);
+}
+
+void SoftScene::DrawBox(SoftCommandList& commandList, const Mat4& worldViewProj) const
+{
+	commandList.SetWorldViewProj(worldViewProj);
+	commandList.IASetVertexBuffer(boxVertices.data(), static_cast<uint32_t>(boxVertices.size() * sizeof(SoftVertexPosColor)), sizeof(SoftVertexPosColor));
+	commandList.IASetIndexBuffer(boxIndices.data(), static_cast<uint32_t>(boxIndices.size()));
+	commandList.DrawIndexed(static_cast<uint32_t>(boxIndices.size()), 0, 0);
+}
+
+void SoftScene::DrawTexturedBox(SoftCommandList& commandList, const Mat4& worldViewProj) const
+{
+	commandList.SetWorldViewProj(worldViewProj);
+	commandList.SetTexture(&checkerTexture);
+	commandList.IASetVertexBuffer(texturedBoxVertices.data(), static_cast<uint32_t>(texturedBoxVertices.size() * sizeof(SoftVertexPosColorUV)), sizeof(SoftVertexPosColorUV));
+	commandList.IASetIndexBuffer(boxIndices.data(), static_cast<uint32_t>(boxIndices.size()));
+	commandList.DrawIndexed(static_cast<uint32_t>(boxIndices.size()), 0, 0);
+}
+
+void SoftScene::DrawQuad(SoftCommandList& commandList, const Mat4& worldViewProj, uint32_t colorIndex) const
+{
+	commandList.SetWorldViewProj(worldViewProj);
+	commandList.IASetVertexBuffer(quadVertices.data(), static_cast<uint32_t>(quadVertices.size() * sizeof(SoftVertexPosColor)), sizeof(SoftVertexPosColor));
+	commandList.IASetIndexBuffer(quadIndices.data(), static_cast<uint32_t>(quadIndices.size()));
+	commandList.DrawIndexed(static_cast<uint32_t>(quadIndices.size()), 0, static_cast<int32_t>(colorIndex * 4));
+}
+
+SoftMeshData SoftScene::GetMesh(SoftMesh mesh) const
+{
+	switch (mesh)
+	{
+	case SoftMesh::TexturedBox:
+		return { texturedBoxVertices.data(), static_cast<uint32_t>(texturedBoxVertices.size() * sizeof(SoftVertexPosColorUV)), sizeof(SoftVertexPosColorUV), boxIndices.data(), static_cast<uint32_t>(boxIndices.size()) };
+	case SoftMesh::Quad:
+		return { quadVertices.data(), static_cast<uint32_t>(quadVertices.size() * sizeof(SoftVertexPosColor)), sizeof(SoftVertexPosColor), quadIndices.data(), static_cast<uint32_t>(quadIndices.size()) };
+	default:
+		return { boxVertices.data(), static_cast<uint32_t>(boxVertices.size() * sizeof(SoftVertexPosColor)), sizeof(SoftVertexPosColor), boxIndices.data(), static_cast<uint32_t>(boxIndices.size()) };
+	}
+}
+
+void SoftScene::BuildDrawItems(SoftSceneId id, const Mat4& viewProj, float time, ArenaVector<SoftDrawItem>& items) const
+{
+	const Mat4 spin = Mat4::RotationX(0.5f) * Mat4::RotationY(time);
+	auto draw = [&items](const SoftPipelineState* state, SoftMesh mesh, const Mat4& worldViewProj, uint32_t colorIndex)
+	{
+		SoftDrawItem item = { state, mesh, colorIndex, worldViewProj, SoftShadingRate::Rate1x1 };
+		items.push_back(item);
+	};
+
+	switch (id)
+	{
+	case SoftSceneId::Box:
+		draw(opaqueState, SoftMesh::Box, Mat4::Scale(2.0f, 2.0f, 2.0f) * spin * viewProj, 0);
+		break;
+
+	case SoftSceneId::DepthTest:
+		// two boxes pushed through each other, the intersection is resolved per pixel
+		draw(opaqueState, SoftMesh::Box, Mat4::Scale(2.0f, 2.0f, 2.0f) * spin * viewProj, 0);
+		draw(opaqueState, SoftMesh::Box, Mat4::Scale(3.5f, 0.8f, 0.8f) * Mat4::RotationY(-time * 0.5f + 0.6f) * viewProj, 0);
+		break;
+
+	case SoftSceneId::Culling:
+		// back faces culled on the left, front faces culled on the right so the inside shows
+		draw(opaqueState, SoftMesh::Box, Mat4::Scale(1.8f, 1.8f, 1.8f) * spin * Mat4::Translation(-1.4f, 0.0f, 0.0f) * viewProj, 0);
+		draw(cullFrontState, SoftMesh::Box, Mat4::Scale(1.8f, 1.8f, 1.8f) * spin * Mat4::Translation(1.4f, 0.0f, 0.0f) * viewProj, 0);
+		break;
+
+	case SoftSceneId::Blending:
+		// opaque first, then the translucent quads back to front without depth writes
+		draw(opaqueState, SoftMesh::Box, Mat4::Scale(1.5f, 1.5f, 1.5f) * spin * Mat4::Translation(0.0f, 0.0f, 1.5f) * viewProj, 0);
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			float offset = (static_cast<float>(i) - 1.0f) * 0.8f;
+			draw(blendState, SoftMesh::Quad, Mat4::Scale(2.0f, 2.0f, 1.0f) * Mat4::Translation(offset, offset * 0.5f, -0.5f - i * 0.4f) * viewProj, i);
+		}
+		break;
+
+	case SoftSceneId::Texture:
+		draw(textureState, SoftMesh::TexturedBox, Mat4::Scale(2.0f, 2.0f, 2.0f) * spin * viewProj, 0);
+		break;
+
+	case SoftSceneId::All:
+	{
+		// every scene, shrunk into a grid
+		const Vec3 cells[5] = { { -3.0f, 1.4f, 0.0f }, { 0.0f, 1.4f, 0.0f }, { 3.0f, 1.4f, 0.0f }, { -1.5f, -1.4f, 0.0f }, { 1.5f, -1.4f, 0.0f } };
+		for (uint32_t i = 0; i < 5; ++i)
+		{
+			Mat4 cell = Mat4::Scale(0.45f, 0.45f, 0.45f) * Mat4::Translation(cells[i].x, cells[i].y, cells[i].z);
+			BuildDrawItems(static_cast<SoftSceneId>(i), cell * viewProj, time, items);
+		}
+	} break;
+
+	case SoftSceneId::Crowd:
+	{
+		// 40 x 25 boxes on a wavy sheet, each turning at its own rate
+		const uint32_t columns = 40, rows = 25;
+		for (uint32_t row = 0; row < rows; ++row)
+		{
+			for (uint32_t column = 0; column < columns; ++column)
+			{
+				float x = (static_cast<float>(column) - (columns - 1) * 0.5f) * 0.2f;
+				float y = (static_cast<float>(row) - (rows - 1) * 0.5f) * 0.2f;
+				float z = 0.15f * std::sin(x * 2.0f + time) * std::cos(y * 2.0f);
+				uint32_t index = row * columns + column;
+				float rate = 0.5f + static_cast<float>(index % 4) * 0.25f;
+				float offset = static_cast<float>(index) * 0.37f;
+				Mat4 world = Mat4::Scale(0.12f, 0.12f, 0.12f) * Mat4::RotationX(0.5f + offset) * Mat4::RotationY(time * rate + offset) * Mat4::Translation(x, y, z);
+				draw(opaqueState, SoftMesh::Box, world * viewProj, 0);
+			}
+		}
+	} break;
+
+	case SoftSceneId::Coarse:
+	{
+		// left to right 1x1, 2x2 and 4x4, with translucent quads over them at 4x4
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			Mat4 world = Mat4::Scale(1.4f, 1.4f, 1.4f) * spin * Mat4::Translation((static_cast<float>(i) - 1.0f) * 2.2f, 0.0f, 0.0f);
+			draw(textureState, SoftMesh::TexturedBox, world * viewProj, 0);
+			items.back().shadingRate = static_cast<SoftShadingRate>(i);
+		}
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			float offset = (static_cast<float>(i) - 1.0f) * 2.2f;
+			draw(blendState, SoftMesh::Quad, Mat4::Scale(1.2f, 1.2f, 1.0f) * Mat4::Translation(offset, -1.2f, -1.5f) * viewProj, i);
+			items.back().shadingRate = SoftShadingRate::Rate4x4;
+		}
+	} break;
+
+	case SoftSceneId::Foveated:
+		BuildDrawItems(SoftSceneId::All, viewProj, time, items);
+		break;
+
+	default:
+		break;
+	}
+}
+
+bool SoftScene::BuildShadingRateImage(SoftSceneId id, uint32_t width, uint32_t height, SoftSurface& image) const
+{
+	if (id != SoftSceneId::Foveated)
+		return false;
+
+	// rings around the center of the target, measured in tiles relative to the shorter half extent
+	const uint32_t tilesX = (width + kShadingRateTileSize - 1) / kShadingRateTileSize;
+	const uint32_t tilesY = (height + kShadingRateTileSize - 1) / kShadingRateTileSize;
+	image.Resize(tilesX, tilesY, SoftFormat::R8G8B8A8_UNORM);
+	const float centerX = static_cast<float>(width) * 0.5f, centerY = static_cast<float>(height) * 0.5f;
+	const float radius = (std::min)(centerX, centerY);
+	for (uint32_t y = 0; y < tilesY; ++y)
+	{
+		uint32_t* row = image.Row(y);
+		for (uint32_t x = 0; x < tilesX; ++x)
+		{
+			const float dx = ((static_cast<float>(x) + 0.5f) * kShadingRateTileSize - centerX) / radius;
+			const float dy = ((static_cast<float>(y) + 0.5f) * kShadingRateTileSize - centerY) / radius;
+			const float distance = std::sqrt(dx * dx + dy * dy);
+			const SoftShadingRate rate = distance < 0.5f ? SoftShadingRate::Rate1x1 : distance < 1.0f ? SoftShadingRate::Rate2x2 : SoftShadingRate::Rate4x4;
+			row[x] = static_cast<uint32_t>(rate);
+		}
+	}
+	return true;
+}
+
+void SoftScene::RecordDrawItems(SoftCommandList& commandList, const SoftDrawItem* items, size_t count) const
+{
+	const SoftPipelineState* boundState = nullptr;
+	// every command list starts out at 1x1
+	SoftShadingRate boundRate = SoftShadingRate::Rate1x1;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const SoftDrawItem& item = items[i];
+		if (item.state != boundState)
+		{
+			commandList.SetPipelineState(item.state);
+			boundState = item.state;
+		}
+		if (item.shadingRate != boundRate)
+		{
+			commandList.RSSetShadingRate(item.shadingRate);
+			boundRate = item.shadingRate;
+		}
+		switch (item.mesh)
+		{
+		case SoftMesh::Box: DrawBox(commandList, item.worldViewProj); break;
+		case SoftMesh::TexturedBox: DrawTexturedBox(commandList, item.worldViewProj); break;
+		case SoftMesh::Quad: DrawQuad(commandList, item.worldViewProj, item.colorIndex); break;
+		default: break;
+		}
+	}
+}
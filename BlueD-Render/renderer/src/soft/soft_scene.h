@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "soft_arena.h"
+#include "soft_command.h"
+#include "soft_math.h"
+#include "soft_pipeline.h"
+#include "soft_surface.h"
+
+// The test scenes from the README TODO list
+enum class SoftSceneId : uint8_t
+{
+	Box,
+	DepthTest,
+	Culling,
+	Blending,
+	Texture,
+	All,
+	Crowd,		// a thousand small boxes, the many draws case for parallel recording
+	Coarse,		// the same textured box at 1x1, 2x2 and 4x4 shading rates
+	Foveated,	// the all scene through a shading rate image: 1x1 in the middle, 2x2 around it, 4x4 at the edges
+	Count,
+};
+
+const char* GetSceneName(SoftSceneId id);
+
+struct SoftCamera
+{
+	Vec3	eye = { 0.0f, 2.0f, -6.0f };
+	Vec3	target = { 0.0f, 0.0f, 0.0f };
+	Vec3	up = { 0.0f, 1.0f, 0.0f };
+	float	fovY = 0.7853982f;
+	float	zNear = 0.1f;
+	float	zFar = 100.0f;
+
+	Mat4 ViewProj(float aspect) const;
+};
+
+enum class SoftMesh : uint8_t
+{
+	Box,
+	TexturedBox,
+	Quad,
+	Count,
+};
+
+// One draw of a scene, recorded into a command list later so a frame can be split across lists
+struct SoftDrawItem
+{
+	const SoftPipelineState*	state;
+	SoftMesh					mesh;
+	uint32_t					colorIndex;		// quads only
+	Mat4						worldViewProj;
+	SoftShadingRate				shadingRate;
+};
+
+// Geometry of a mesh, for renderers that draw the items themselves. Quad items start at vertex colorIndex * 4
+struct SoftMeshData
+{
+	const void*			vertices;
+	uint32_t			vertexBytes;
+	uint32_t			stride;
+	const uint32_t*		indices;
+	uint32_t			indexCount;
+};
+
+// The texture of the textured meshes, R8G8B8A8_UNORM texels
+struct SoftTextureData
+{
+	const uint32_t*		texels;
+	uint32_t			width;
+	uint32_t			height;
+};
+
+class SoftScene
+{
+public:
+	void Init(SoftPipelineCache& pipelineCache);
+	// uploads the textures, recorded once before the first frame
+	void RecordUploads(SoftCommandList& commandList);
+	// appends the draws of a scene in submission order, time drives the animation
+	void BuildDrawItems(SoftSceneId id, const Mat4& viewProj, float time, ArenaVector<SoftDrawItem>& items) const;
+	// fills the shading rate image a scene is drawn through for a width x height target, false when it has none
+	bool BuildShadingRateImage(SoftSceneId id, uint32_t width, uint32_t height, SoftSurface& image) const;
+	// records a contiguous range of draw items. Bound state does not carry over between command lists,
+	// so the range sets everything it needs itself apart from the render targets.
+	void RecordDrawItems(SoftCommandList& commandList, const SoftDrawItem* items, size_t count) const;
+	SoftMeshData GetMesh(SoftMesh mesh) const;
+	SoftTextureData GetTexture() const { return { checkerPixels.data(), checkerTexture.width, checkerTexture.height }; }
+
+private:
+	std::vector<SoftVertexPosColor>		boxVertices;
+	std::vector<SoftVertexPosColorUV>	texturedBoxVertices;
+	std::vector<uint32_t>				boxIndices;
+	std::vector<SoftVertexPosColor>		quadVertices;
+	std::vector<uint32_t>				quadIndices;
+	std::vector<uint32_t>				checkerPixels;
+	SoftSurface							checkerTexture;
+
+	const SoftPipelineState*			opaqueState = nullptr;
+	const SoftPipelineState*			cullFrontState = nullptr;
+	const SoftPipelineState*			blendState = nullptr;
+	const SoftPipelineState*			textureState = nullptr;
+
+	void DrawBox(SoftCommandList& commandList, const Mat4& worldViewProj) const;
+	void DrawTexturedBox(SoftCommandList& commandList, const Mat4& worldViewProj) const;
+	void DrawQuad(SoftCommandList& commandList, const Mat4& worldViewProj, uint32_t colorIndex) const;
+};
@@ -0,0 +1,203 @@
+#include "soft_sequence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "soft_export.h"
+#include "soft_renderer.h"
+
+namespace
+{
+	const uint32_t kSequenceFramesInFlight = 4;
+
+	Vec3 CatmullRom(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3& p3, float u)
+	{
+		float u2 = u * u;
+		float u3 = u2 * u;
+		return (p1 * 2.0f + (p2 - p0) * u + (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * u2 + (p1 * 3.0f - p0 - p2 * 3.0f + p3) * u3) * 0.5f;
+	}
+
+	uint32_t ParseCount(const char* flag, const char* value)
+	{
+		char* end = nullptr;
+		unsigned long count = strtoul(value, &end, 10);
+		if (end == value || *end != '\0' || count == 0)
+			throw std::runtime_error(std::string("invalid value for ") + flag + ": " + value);
+		return static_cast<uint32_t>(count);
+	}
+}
+
+void SoftCameraPath::Load(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+		throw std::runtime_error(std::string("failed to open camera path ") + path);
+
+	keys.clear();
+	char line[256];
+	while (fgets(line, sizeof(line), file))
+	{
+		if (char* comment = strchr(line, '#'))
+			*comment = '\0';
+		SoftCameraKey key;
+		int fields = sscanf(line, "%f %f %f %f %f %f %f", &key.time, &key.eye.x, &key.eye.y, &key.eye.z, &key.target.x, &key.target.y, &key.target.z);
+		if (fields <= 0)
+			continue;
+		if (fields != 7 || (!keys.empty() && key.time < keys.back().time))
+		{
+			fclose(file);
+			throw std::runtime_error(std::string("malformed camera key in ") + path);
+		}
+		keys.push_back(key);
+	}
+	fclose(file);
+
+	if (keys.empty())
+		throw std::runtime_error(std::string("camera path has no keys: ") + path);
+}
+
+SoftCameraPath SoftCameraPath::Orbit(float radius, float height, float duration)
+{
+	const uint32_t segments = 16;
+	SoftCameraPath path;
+	for (uint32_t i = 0; i <= segments; ++i)
+	{
+		float angle = 6.2831853f * i / segments;
+		// starts behind the scene like the default camera
+		SoftCameraKey key = { duration * i / segments, { -radius * std::sin(angle), height, -radius * std::cos(angle) }, { 0.0f, 0.0f, 0.0f } };
+		path.keys.push_back(key);
+	}
+	return path;
+}
+
+void SoftCameraPath::Apply(float time, SoftCamera& camera) const
+{
+	if (keys.empty())
+		return;
+	if (keys.size() == 1 || time <= keys.front().time)
+	{
+		camera.eye = keys.front().eye;
+		camera.target = keys.front().target;
+		return;
+	}
+	if (time >= keys.back().time)
+	{
+		camera.eye = keys.back().eye;
+		camera.target = keys.back().target;
+		return;
+	}
+
+	size_t i = 0;
+	while (keys[i + 1].time <= time)
+		++i;
+	const SoftCameraKey& k0 = keys[i ? i - 1 : 0];
+	const SoftCameraKey& k1 = keys[i];
+	const SoftCameraKey& k2 = keys[i + 1];
+	const SoftCameraKey& k3 = keys[(std::min)(i + 2, keys.size() - 1)];
+	float span = k2.time - k1.time;
+	float u = span > 0.0f ? (time - k1.time) / span : 0.0f;
+	camera.eye = CatmullRom(k0.eye, k1.eye, k2.eye, k3.eye, u);
+	camera.target = CatmullRom(k0.target, k1.target, k2.target, k3.target, u);
+}
+
+bool ParseSequenceArgs(int argc, char** argv, SoftSequenceDesc& desc)
+{
+	bool found = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--sequence") == 0)
+			found = true;
+	}
+	if (!found)
+		return false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* flag = argv[i];
+		if (i + 1 >= argc)
+			throw std::runtime_error(std::string("missing value for ") + flag);
+		const char* value = argv[++i];
+
+		if (strcmp(flag, "--sequence") == 0)
+		{
+			desc.frameCount = ParseCount(flag, value);
+		}
+		else if (strcmp(flag, "--format") == 0)
+		{
+			if (strcmp(value, "y4m") == 0)
+				desc.format = SoftImageFormat::Yuv420;
+			else if (strcmp(value, "rgba") == 0)
+				desc.format = SoftImageFormat::Raw;
+			else
+				throw std::runtime_error(std::string("unknown stream format ") + value);
+		}
+		else if (strcmp(flag, "--size") == 0)
+		{
+			unsigned width = 0, height = 0;
+			if (sscanf(value, "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+				throw std::runtime_error(std::string("invalid size ") + value);
+			desc.width = width;
+			desc.height = height;
+		}
+		else if (strcmp(flag, "--fps") == 0)
+		{
+			desc.framesPerSecond = ParseCount(flag, value);
+		}
+		else if (strcmp(flag, "--scene") == 0)
+		{
+			desc.sceneId = SoftSceneId::Count;
+			for (uint32_t id = 0; id < static_cast<uint32_t>(SoftSceneId::Count); ++id)
+			{
+				if (strcmp(value, GetSceneName(static_cast<SoftSceneId>(id))) == 0)
+					desc.sceneId = static_cast<SoftSceneId>(id);
+			}
+			if (desc.sceneId == SoftSceneId::Count)
+				throw std::runtime_error(std::string("unknown scene ") + value);
+		}
+		else if (strcmp(flag, "--camera") == 0)
+		{
+			desc.cameraPath = value;
+		}
+		else if (strcmp(flag, "--threads") == 0)
+		{
+			desc.threadCount = ParseCount(flag, value);
+		}
+		else
+		{
+			throw std::runtime_error(std::string("unknown argument ") + flag);
+		}
+	}
+	return true;
+}
+
+void RenderSequence(const SoftSequenceDesc& desc, FILE* out)
+{
+	float duration = static_cast<float>(desc.frameCount) / desc.framesPerSecond;
+	SoftCameraPath path;
+	if (desc.cameraPath.empty())
+		path = SoftCameraPath::Orbit(6.0f, 2.0f, duration);
+	else
+		path.Load(desc.cameraPath.c_str());
+
+	// color conversion and writing run on the exporter's workers while the next frames render
+	SoftFrameExporter exporter(desc.threadCount, kSequenceFramesInFlight);
+	exporter.StartStream(out, desc.format, desc.framesPerSecond);
+
+	SoftThreadPool recordPool(desc.threadCount);
+	SoftRenderer renderer;
+	renderer.Init(desc.width, desc.height);
+	renderer.sceneId = desc.sceneId;
+	renderer.exporter = &exporter;
+	renderer.recordPool = &recordPool;
+	for (uint32_t frame = 0; frame < desc.frameCount; ++frame)
+	{
+		float time = static_cast<float>(frame) / desc.framesPerSecond;
+		path.Apply(time, renderer.camera);
+		renderer.Render(time);
+		renderer.Present();
+	}
+	exporter.Flush();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "soft_image.h"
+#include "soft_math.h"
+#include "soft_scene.h"
+
+struct SoftCameraKey
+{
+	float	time;
+	Vec3	eye;
+	Vec3	target;
+};
+
+// Scripted camera for offline sequences, keys are interpolated with a Catmull-Rom spline
+class SoftCameraPath
+{
+public:
+	std::vector<SoftCameraKey>	keys;
+
+	// one key per line: time eye.x eye.y eye.z target.x target.y target.z, '#' starts a comment
+	void Load(const char* path);
+	// circles the origin once over duration seconds
+	static SoftCameraPath Orbit(float radius, float height, float duration);
+
+	float Duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+	void Apply(float time, SoftCamera& camera) const;
+};
+
+struct SoftSequenceDesc
+{
+	uint32_t			frameCount = 0;
+	uint32_t			width = 1280;
+	uint32_t			height = 720;
+	uint32_t			framesPerSecond = 60;
+	SoftImageFormat		format = SoftImageFormat::Yuv420;
+	SoftSceneId			sceneId = SoftSceneId::All;
+	std::string			cameraPath;		// empty uses an orbit over the whole sequence
+	uint32_t			threadCount = 0;
+};
+
+// Parses --sequence <frames> [--format y4m|rgba] [--size <w>x<h>] [--fps <n>] [--scene <name>] [--camera <file>] [--threads <n>].
+// Returns false when --sequence is not on the command line, throws on malformed arguments.
+bool ParseSequenceArgs(int argc, char** argv, SoftSequenceDesc& desc);
+
+// Renders the sequence without a window and streams the frames to out, which has to be in binary mode
+void RenderSequence(const SoftSequenceDesc& desc, FILE* out);
@@ -0,0 +1,17 @@
+#include "soft_surface.h"
+
+#include <algorithm>
+
+void SoftSurface::Resize(uint32_t w, uint32_t h, SoftFormat fmt)
+{
+	width = w;
+	height = h;
+	format = fmt;
+	// keep the capacity around so shrinking and growing back does not reallocate
+	texels.resize(static_cast<size_t>(w) * h);
+}
+
+void SoftSurface::Fill(uint32_t value)
+{
+	std::fill(texels.begin(), texels.end(), value);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Texel formats of the software path. Every format is 32 bits per texel.
+enum class SoftFormat : uint8_t
+{
+	Unknown,
+	R8G8B8A8_UNORM,		// same memory layout as DXGI_FORMAT_R8G8B8A8_UNORM
+	D32_FLOAT,
+};
+
+// Mirrors the D3D12_RESOURCE_STATES the d3d path transitions between
+enum class SoftResourceState : uint8_t
+{
+	Common,
+	RenderTarget,
+	DepthWrite,
+	ShaderResource,
+	CopyDest,
+	Present,
+};
+
+// A 2D image in system memory, used for render targets, depth buffers and textures
+class SoftSurface
+{
+public:
+	uint32_t				width = 0;
+	uint32_t				height = 0;
+	SoftFormat				format = SoftFormat::Unknown;
+	SoftResourceState		state = SoftResourceState::Common;
+	std::vector<uint32_t>	texels;
+
+	void Resize(uint32_t w, uint32_t h, SoftFormat fmt);
+	void Fill(uint32_t value);
+
+	uint32_t* Row(uint32_t y) { return texels.data() + static_cast<size_t>(y) * width; }
+	const uint32_t* Row(uint32_t y) const { return texels.data() + static_cast<size_t>(y) * width; }
+	float* DepthRow(uint32_t y) { return reinterpret_cast<float*>(Row(y)); }
+
+	size_t SizeInBytes() const { return texels.size() * sizeof(uint32_t); }
+};
+
+inline uint32_t PackColor(float r, float g, float b, float a)
+{
+	auto toByte = [](float v) -> uint32_t { return v <= 0.0f ? 0u : v >= 1.0f ? 255u : static_cast<uint32_t>(v * 255.0f + 0.5f); };
+	return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16) | (toByte(a) << 24);
+}
+
+inline uint32_t FloatBits(float f)
+{
+	union { float f; uint32_t u; } bits;
+	bits.f = f;
+	return bits.u;
+}
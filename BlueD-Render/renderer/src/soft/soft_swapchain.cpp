@@ -0,0 +1,171 @@
+#include "soft_swapchain.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+const char* GetPresentModeName(SoftPresentMode mode)
+{
+	switch (mode)
+	{
+	case SoftPresentMode::Fifo: return "fifo";
+	case SoftPresentMode::Mailbox: return "mailbox";
+	case SoftPresentMode::Immediate: return "immediate";
+	default: return "unknown";
+	}
+}
+
+SoftSwapChain::SoftSwapChain(const SoftSwapChainDesc& swapChainDesc)
+	: desc(swapChainDesc)
+{
+	if (desc.bufferCount < 2)
+		throw std::runtime_error("swap chain: at least two buffers are needed");
+	if (desc.refreshRate == 0)
+		throw std::runtime_error("swap chain: refresh rate must not be 0");
+	latencies.resize(kLatencyWindow);
+	display = std::thread(&SoftSwapChain::DisplayLoop, this);
+}
+
+SoftSwapChain::~SoftSwapChain()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	display.join();
+}
+
+SoftSurface SoftSwapChain::AcquireBuffer(uint32_t width, uint32_t height, SoftFormat format)
+{
+	SoftSurface surface;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (freeSurfaces.empty() && buffersCreated >= desc.bufferCount)
+		{
+			Clock::time_point start = Clock::now();
+			changed.wait(lock, [this] { return !freeSurfaces.empty(); });
+			++stats.stalls;
+			stats.stallMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+		if (!freeSurfaces.empty())
+		{
+			surface = std::move(freeSurfaces.back());
+			freeSurfaces.pop_back();
+		}
+		else
+			++buffersCreated;
+		++buffersAcquired;
+	}
+	// a resize reallocates the buffers as they come around
+	if (surface.width != width || surface.height != height || surface.format != format)
+		surface.Resize(width, height, format);
+	return surface;
+}
+
+void SoftSwapChain::Present(SoftSurface&& frame)
+{
+	QueuedFrame queued = { std::move(frame), Clock::now() };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++stats.presented;
+		if (buffersAcquired > 0)
+			--buffersAcquired;
+		else
+			++buffersCreated;
+		switch (desc.mode)
+		{
+		case SoftPresentMode::Immediate:
+			Show(queued, queued.submitted);
+			break;
+		case SoftPresentMode::Mailbox:
+			// the waiting frame has not been seen, its buffer is free again right away
+			while (!queue.empty())
+			{
+				freeSurfaces.push_back(std::move(queue.front().surface));
+				queue.pop_front();
+				++stats.dropped;
+			}
+			queue.push_back(std::move(queued));
+			break;
+		default:
+			queue.push_back(std::move(queued));
+			break;
+		}
+	}
+	changed.notify_all();
+}
+
+void SoftSwapChain::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this] { return queue.empty(); });
+}
+
+SoftSwapChainStats SoftSwapChain::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+SoftPresentLatency SoftSwapChain::GetLatency() const
+{
+	std::vector<double> sorted;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sorted.assign(latencies.begin(), latencies.begin() + (std::min)(latencyCount, kLatencyWindow));
+	}
+	SoftPresentLatency latency;
+	if (sorted.empty())
+		return latency;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (double ms : sorted)
+		total += ms;
+	latency.frames = static_cast<uint32_t>(sorted.size());
+	latency.meanMs = total / sorted.size();
+	latency.p50Ms = sorted[sorted.size() / 2];
+	latency.p99Ms = sorted[(std::min)(sorted.size() - 1, sorted.size() * 99 / 100)];
+	latency.maxMs = sorted.back();
+	return latency;
+}
+
+void SoftSwapChain::DisplayLoop()
+{
+	const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / desc.refreshRate));
+	Clock::time_point vblank = Clock::now() + period;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stopping)
+	{
+		changed.wait_until(lock, vblank, [this] { return stopping; });
+		if (stopping)
+			break;
+		Clock::time_point now = Clock::now();
+		if (now < vblank)
+			continue;
+		// one frame per refresh, a late wake up does not catch up on the refreshes it missed
+		if (!queue.empty())
+		{
+			Show(queue.front(), now);
+			queue.pop_front();
+			lock.unlock();
+			changed.notify_all();
+			lock.lock();
+		}
+		vblank += period;
+		if (vblank < now)
+			vblank = now + period;
+	}
+}
+
+void SoftSwapChain::Show(QueuedFrame& frame, Clock::time_point now)
+{
+	latencies[latencyCount++ % kLatencyWindow] = std::chrono::duration<double, std::milli>(now - frame.submitted).count();
+	if (hasOnScreen)
+		freeSurfaces.push_back(std::move(onScreen));
+	onScreen = std::move(frame.surface);
+	hasOnScreen = true;
+	++stats.displayed;
+	if (scanout)
+		scanout(onScreen);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "soft_surface.h"
+
+// How presented frames reach the emulated display, after the vulkan present modes
+enum class SoftPresentMode : uint8_t
+{
+	Fifo,		// every frame is shown for at least one refresh, presenting blocks once all buffers are queued
+	Mailbox,	// a newer frame replaces the one waiting for the next refresh, the older one is dropped
+	Immediate,	// frames go on screen as they are presented without waiting for a refresh
+};
+
+const char* GetPresentModeName(SoftPresentMode mode);
+
+struct SoftSwapChainDesc
+{
+	SoftPresentMode		mode = SoftPresentMode::Fifo;
+	uint32_t			bufferCount = 3;		// at least 2, one on screen and one to render into
+	uint32_t			refreshRate = 60;		// of the emulated display, in Hz
+};
+
+struct SoftSwapChainStats
+{
+	uint64_t	presented = 0;
+	uint64_t	displayed = 0;
+	uint64_t	dropped = 0;			// replaced in the mailbox before they were shown
+	uint64_t	stalls = 0;				// AcquireBuffer calls that had to wait for a free buffer
+	double		stallMs = 0.0;
+};
+
+// submit to scanout time over the most recently displayed frames
+struct SoftPresentLatency
+{
+	uint32_t	frames = 0;
+	double		meanMs = 0.0;
+	double		p50Ms = 0.0;
+	double		p99Ms = 0.0;
+	double		maxMs = 0.0;
+};
+
+// Emulates a swap chain for the software path. Buffers are handed over by move like with the frame exporter,
+// a display thread latches queued frames at the refresh rate and measures how long each one waited.
+class SoftSwapChain
+{
+public:
+	explicit SoftSwapChain(const SoftSwapChainDesc& desc);
+	~SoftSwapChain();
+	SoftSwapChain(const SoftSwapChain&) = delete;
+	SoftSwapChain& operator=(const SoftSwapChain&) = delete;
+
+	// called on the display thread with the frame that goes on screen, the swap chain is locked meanwhile
+	std::function<void(const SoftSurface&)>	scanout;
+
+	// a buffer for the next frame, blocks while every buffer is queued or on screen
+	SoftSurface AcquireBuffer(uint32_t width, uint32_t height, SoftFormat format);
+	// a frame that was not acquired from the swap chain is adopted as one of its buffers
+	void Present(SoftSurface&& frame);
+	// blocks until every presented frame was displayed or dropped
+	void WaitIdle();
+
+	const SoftSwapChainDesc& GetDesc() const { return desc; }
+	SoftSwapChainStats GetStats() const;
+	SoftPresentLatency GetLatency() const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct QueuedFrame
+	{
+		SoftSurface			surface;
+		Clock::time_point	submitted;
+	};
+
+	static const size_t					kLatencyWindow = 256;
+
+	SoftSwapChainDesc					desc;
+	std::thread							display;
+	mutable std::mutex					mutex;
+	std::condition_variable				changed;
+	bool								stopping = false;
+
+	std::deque<QueuedFrame>				queue;
+	SoftSurface							onScreen;
+	bool								hasOnScreen = false;
+	std::vector<SoftSurface>			freeSurfaces;
+	uint32_t							buffersCreated = 0;
+	uint32_t							buffersAcquired = 0;
+	SoftSwapChainStats					stats;
+	std::vector<double>					latencies;		// ring of the last kLatencyWindow frames
+	size_t								latencyCount = 0;
+
+	void DisplayLoop();
+	// called with the mutex held
+	void Show(QueuedFrame& frame, Clock::time_point now);
+};
@@ -0,0 +1,592 @@
+#include "gui/gui_font_cache.h"
+#include "gui/imgui_impl_soft.h"
+#include "imgui.h"
+#include "soft/soft_capture.h"
+#include "soft/soft_image.h"
+#include "soft/soft_jobs.h"
+#include "soft/soft_regress.h"
+#include "soft/soft_renderer.h"
+#include "soft/soft_swapchain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// Headless capture tool for the software path
+//   replay <capture> [iterations]                         replays a capture and reports timings
+//   replay --record <capture> [scene] [frames] [w] [h]    renders the built in scene into a capture
+//   replay --regress <golden dir> [options]               checks every scene against its golden image and frame time baseline, then runs the self checks
+//   replay --present <mode> [options]                     renders through the emulated swap chain and reports its latency
+//   replay --ui <png> [options]                           composites a docked ImGui UI over the scene with the software backend,
+//                                                         or with --glyph-cache checks glyphs rasterized on demand against baked ones
+
+namespace
+{
+	void PrintUsage()
+	{
+		printf("usage: replay <capture> [iterations]\n");
+		printf("       replay --record <capture> [box|depth_test|culling|blending|texture|all|crowd|coarse|foveated] [frames] [width] [height]\n");
+		printf("       replay --regress <golden dir> [--bless | --rebaseline] [--iterations n] [--record-threads n] [--perf-tolerance fraction] [--size wxh]\n");
+		printf("       replay --present <fifo|mailbox|immediate> [--buffers n] [--refresh hz] [--frames n] [--scene name] [--size wxh]\n");
+		printf("       replay --ui <png> [--frames n] [--threads n] [--static] [--scene name] [--size wxh] [--font-cache file]\n");
+		printf("              [--sdf-font ttf] [--font-scale s] [--glyph-cache]\n");
+	}
+
+	uint64_t HashSurface(const SoftSurface* surface)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		if (!surface)
+			return 0;
+		for (uint32_t texel : surface->texels)
+		{
+			hash ^= texel;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool ParseScene(const char* name, SoftSceneId& sceneId)
+	{
+		for (uint32_t i = 0; i < static_cast<uint32_t>(SoftSceneId::Count); ++i)
+		{
+			if (strcmp(name, GetSceneName(static_cast<SoftSceneId>(i))) == 0)
+			{
+				sceneId = static_cast<SoftSceneId>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int Record(int argc, char** argv)
+	{
+		const char* path = argv[2];
+		SoftSceneId sceneId = SoftSceneId::All;
+		if (argc > 3)
+		{
+			if (!ParseScene(argv[3], sceneId))
+			{
+				printf("unknown scene %s\n", argv[3]);
+				return EXIT_FAILURE;
+			}
+		}
+		uint32_t frames = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 1;
+		uint32_t width = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 1280;
+		uint32_t height = argc > 6 ? static_cast<uint32_t>(atoi(argv[6])) : 800;
+
+		SoftRenderer renderer;
+		renderer.Init(width, height);
+		renderer.sceneId = sceneId;
+		renderer.CaptureFrames(path, frames);
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			renderer.Render(i / 60.0f);
+			renderer.Present();
+		}
+
+		printf("recorded %u frame(s) of %s at %ux%u into %s\n", frames, GetSceneName(sceneId), width, height, path);
+		return EXIT_SUCCESS;
+	}
+
+	struct GlyphCacheCheck
+	{
+		uint32_t frames = 0;
+		int evictions = 0;
+		size_t differingPixels = 0;
+		SoftSurface lastFrame;
+
+		// glyphs rasterized on demand have to come out as the baked ones, through evictions of every page
+		bool Passed() const { return evictions > 0 && differingPixels == 0; }
+	};
+
+	// draws a line of Latin-1 text in a few sizes, moving on by kGlyphsPerFrame codepoints every frame. With onDemand
+	// only ASCII is baked and the rest goes through two cache pages of one glyph row, which the text outgrows
+	std::vector<SoftSurface> RenderGlyphCacheFrames(bool onDemand, uint32_t frames, int& evictions)
+	{
+		static const ImWchar asciiRanges[] = { 0x0020, 0x007E, 0 };
+		static const ImWchar latinRanges[] = { 0x0020, 0x00FF, 0 };
+		const uint32_t kGlyphsPerFrame = 8;
+		const uint32_t width = 320;
+		const uint32_t height = 96;
+
+		ImGuiContext* context = ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+		io.IniFilename = nullptr;
+		io.DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
+		io.DeltaTime = 1.0f / 60.0f;
+		ImFontConfig config;
+		config.GlyphRanges = onDemand ? asciiRanges : latinRanges;
+		config.GlyphRangesOnDemand = onDemand ? latinRanges : nullptr;
+		io.Fonts->AddFontDefault(&config);
+		io.Fonts->TexDesiredWidth = 256;
+		io.Fonts->GlyphCachePageCount = 2;
+		io.Fonts->GlyphCachePageHeight = 16;
+		ImGui_ImplSoft_Init(nullptr);
+
+		std::vector<SoftSurface> targets(frames);
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			char text[kGlyphsPerFrame * 2 + 1];
+			char* write = text;
+			for (uint32_t n = 0; n < kGlyphsPerFrame; ++n)
+			{
+				const uint32_t codepoint = 0xA0 + (i * kGlyphsPerFrame + n) % 0x60;
+				*write++ = static_cast<char>(0xC0 | (codepoint >> 6));
+				*write++ = static_cast<char>(0x80 | (codepoint & 0x3F));
+			}
+			*write = 0;
+
+			ImGui_ImplSoft_NewFrame();
+			ImGui::NewFrame();
+			ImDrawList* drawList = ImGui::GetForegroundDrawList();
+			drawList->AddRectFilled(ImVec2(0.0f, 0.0f), io.DisplaySize, IM_COL32(24, 24, 32, 255));
+			drawList->AddText(ImVec2(4.0f, 4.0f), IM_COL32_WHITE, text);
+			drawList->AddText(nullptr, 26.0f, ImVec2(4.0f, 24.0f), IM_COL32(255, 200, 80, 255), text);
+			drawList->AddText(nullptr, 39.0f, ImVec2(4.0f, 52.0f), IM_COL32(120, 220, 255, 255), text);
+			ImGui::Render();
+
+			// an eviction clears its whole page, the glyphs only their rectangles
+			for (const ImVec4& rect : io.Fonts->TexDirtyRects)
+				if (rect.z - rect.x == static_cast<float>(io.Fonts->TexWidth) && rect.w - rect.y == static_cast<float>(io.Fonts->GlyphCachePageHeight))
+					++evictions;
+			targets[i].Resize(width, height, SoftFormat::R8G8B8A8_UNORM);
+			ImGui_ImplSoft_RenderDrawData(ImGui::GetDrawData(), &targets[i]);
+		}
+
+		ImGui_ImplSoft_Shutdown();
+		ImGui::DestroyContext(context);
+		return targets;
+	}
+
+	GlyphCacheCheck CheckGlyphCache(uint32_t frames)
+	{
+		GlyphCacheCheck check;
+		int bakedEvictions = 0;
+		std::vector<SoftSurface> baked = RenderGlyphCacheFrames(false, frames, bakedEvictions);
+		std::vector<SoftSurface> onDemand = RenderGlyphCacheFrames(true, frames, check.evictions);
+		check.frames = frames;
+		for (uint32_t i = 0; i < frames; ++i)
+			for (size_t t = 0; t < baked[i].texels.size(); ++t)
+				check.differingPixels += onDemand[i].texels[t] != baked[i].texels[t] ? 1 : 0;
+		check.lastFrame = std::move(onDemand.back());
+		return check;
+	}
+
+	int Regress(int argc, char** argv)
+	{
+		SoftRegressionDesc desc;
+		desc.goldenDir = argv[2];
+		for (int i = 3; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--bless") == 0)
+				desc.bless = true;
+			else if (strcmp(argv[i], "--rebaseline") == 0)
+				desc.rebaseline = true;
+			else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+				desc.iterations = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc)
+				desc.recordThreads = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--perf-tolerance") == 0 && i + 1 < argc)
+				desc.perfTolerance = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[++i], "%ux%u", &desc.width, &desc.height) == 2)
+				continue;
+			else
+			{
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+
+		std::vector<SoftRegressionResult> results = RunRegression(desc);
+
+		printf("%-12s %-8s %10s %10s %8s %10s %10s %-6s\n", "scene", "image", "max dE", "mean dE", "failing", "median ms", "baseline", "perf");
+		bool passed = true;
+		for (const SoftRegressionResult& result : results)
+		{
+			const char* image = desc.bless ? "blessed" : !result.hasGolden ? "missing" : result.imagePassed ? "ok" : "FAIL";
+			const char* perf = result.baselineMs <= 0.0 ? "-" : result.perfPassed ? "ok" : "SLOWER";
+			printf("%-12s %-8s %10.3f %10.4f %8u %10.3f %10.3f %-6s\n", GetSceneName(result.sceneId), image,
+				result.diff.maxDeltaE, result.diff.meanDeltaE, result.diff.failingPixels, result.medianMs, result.baselineMs, perf);
+			passed = passed && result.hasGolden && result.imagePassed && result.perfPassed;
+		}
+
+		// the parts of the frame the scenes cannot reach are checked on their own
+		for (const SoftSelfCheckResult& check : RunSelfChecks())
+		{
+			printf("%-21s %s%s\n", check.name, check.passed ? "ok" : "FAIL ", check.failure.c_str());
+			passed = passed && check.passed;
+		}
+		const GlyphCacheCheck glyphCache = CheckGlyphCache(48);
+		if (glyphCache.Passed())
+			printf("%-21s ok\n", "glyph cache");
+		else
+			printf("%-21s FAIL %d evictions, %zu pixels differ from the baked atlas\n", "glyph cache", glyphCache.evictions, glyphCache.differingPixels);
+		passed = passed && glyphCache.Passed();
+
+		if (desc.bless)
+			printf("blessed %zu golden image(s) and baselines into %s\n", results.size(), desc.goldenDir.c_str());
+		else if (desc.rebaseline)
+			printf("wrote frame time baselines into %s\n", desc.goldenDir.c_str());
+		else
+			printf(passed ? "all scenes passed\n" : "regression detected, see the failing checks and the .actual.png and .diff.png files in %s\n", desc.goldenDir.c_str());
+		return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	int PresentLatency(int argc, char** argv)
+	{
+		SoftSwapChainDesc desc;
+		if (strcmp(argv[2], "fifo") == 0)
+			desc.mode = SoftPresentMode::Fifo;
+		else if (strcmp(argv[2], "mailbox") == 0)
+			desc.mode = SoftPresentMode::Mailbox;
+		else if (strcmp(argv[2], "immediate") == 0)
+			desc.mode = SoftPresentMode::Immediate;
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+
+		uint32_t frames = 300;
+		uint32_t width = 1280;
+		uint32_t height = 800;
+		SoftSceneId sceneId = SoftSceneId::All;
+		for (int i = 3; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc)
+				desc.bufferCount = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--refresh") == 0 && i + 1 < argc)
+				desc.refreshRate = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+				frames = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc && ParseScene(argv[++i], sceneId))
+				continue;
+			else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[++i], "%ux%u", &width, &height) == 2)
+				continue;
+			else
+			{
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+
+		SoftSwapChain swapChain(desc);
+		SoftRenderer renderer;
+		renderer.Init(width, height);
+		renderer.sceneId = sceneId;
+		renderer.swapChain = &swapChain;
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			renderer.Render(i / 60.0f);
+			renderer.Present();
+		}
+		auto end = std::chrono::steady_clock::now();
+		swapChain.WaitIdle();
+		renderer.swapChain = nullptr;
+
+		double seconds = std::chrono::duration<double>(end - start).count();
+		SoftSwapChainStats stats = swapChain.GetStats();
+		SoftPresentLatency latency = swapChain.GetLatency();
+		printf("%s, %u buffers at %u Hz, %s at %ux%u\n", GetPresentModeName(desc.mode), desc.bufferCount, desc.refreshRate, GetSceneName(sceneId), width, height);
+		printf("  throughput %8.1f fps\n", seconds > 0.0 ? frames / seconds : 0.0);
+		printf("  presented %llu, displayed %llu, dropped %llu\n", static_cast<unsigned long long>(stats.presented),
+			static_cast<unsigned long long>(stats.displayed), static_cast<unsigned long long>(stats.dropped));
+		printf("  stalled %llu times, %.3f ms in total\n", static_cast<unsigned long long>(stats.stalls), stats.stallMs);
+		printf("  submit to scanout over the last %u frames\n", latency.frames);
+		printf("    mean %8.3f ms\n", latency.meanMs);
+		printf("    p50  %8.3f ms\n", latency.p50Ms);
+		printf("    p99  %8.3f ms\n", latency.p99Ms);
+		printf("    max  %8.3f ms\n", latency.maxMs);
+		return EXIT_SUCCESS;
+	}
+
+	int UiOverlay(int argc, char** argv)
+	{
+		const char* path = argv[2];
+		uint32_t frames = 60;
+		uint32_t threads = 0;
+		bool staticScene = false;
+		uint32_t width = 1280;
+		uint32_t height = 800;
+		SoftSceneId sceneId = SoftSceneId::All;
+		const char* fontCache = nullptr;
+		const char* sdfFont = nullptr;
+		float fontScale = 1.0f;
+		bool glyphCache = false;
+		for (int i = 3; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+				frames = (std::max)(1, atoi(argv[++i]));
+			else if (strcmp(argv[i], "--glyph-cache") == 0)
+				glyphCache = true;
+			else if (strcmp(argv[i], "--font-cache") == 0 && i + 1 < argc)
+				fontCache = argv[++i];
+			else if (strcmp(argv[i], "--sdf-font") == 0 && i + 1 < argc)
+				sdfFont = argv[++i];
+			else if (strcmp(argv[i], "--font-scale") == 0 && i + 1 < argc)
+				fontScale = static_cast<float>(atof(argv[++i]));
+			else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+				threads = static_cast<uint32_t>(atoi(argv[++i]));
+			else if (strcmp(argv[i], "--static") == 0)
+				staticScene = true;
+			else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc && ParseScene(argv[++i], sceneId))
+				continue;
+			else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[++i], "%ux%u", &width, &height) == 2)
+				continue;
+			else
+			{
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+		}
+
+		// text through on-demand glyphs and evicted cache pages against a baked atlas, instead of the docked ui
+		if (glyphCache)
+		{
+			const GlyphCacheCheck check = CheckGlyphCache(frames);
+			WriteImageFile(path, SoftImageFormat::Png, check.lastFrame);
+			printf("glyph cache: %u frame(s), %d page evictions, %zu pixels differ from the baked atlas\n", check.frames, check.evictions, check.differingPixels);
+			return check.Passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+		io.IniFilename = nullptr;
+		io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+		io.DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
+		io.DeltaTime = 1.0f / 60.0f;
+		ImGui::StyleColorsDark();
+
+		// the ui is drawn in bands on these threads, 0 draws on this one
+		std::unique_ptr<SoftThreadPool> pool;
+		if (threads > 0)
+			pool.reset(new SoftThreadPool(threads));
+		ImGui_ImplSoft_Init(pool.get());
+		// one distance field font for all the text, it stays sharp at any --font-scale
+		if (sdfFont != nullptr)
+		{
+			ImFontConfig config;
+			config.SDF = true;
+			if (io.Fonts->AddFontFromFileTTF(sdfFont, 16.0f, &config) == nullptr)
+			{
+				fprintf(stderr, "could not load %s\n", sdfFont);
+				return EXIT_FAILURE;
+			}
+		}
+		io.FontGlobalScale = fontScale;
+		// otherwise the backend builds the atlas with the first frame
+		if (fontCache != nullptr)
+		{
+			bool loaded = false;
+			const auto start = std::chrono::steady_clock::now();
+			BuildFontAtlasCached(io.Fonts, fontCache, &loaded);
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			printf("font atlas %s %s in %.3f ms\n", loaded ? "loaded from" : "built and written to", fontCache, ms);
+		}
+
+		SoftRenderer renderer;
+		renderer.Init(width, height);
+		renderer.sceneId = sceneId;
+
+		// every frame the ui goes over the scene three ways: with the quad path, with triangles only and
+		// retained, in a rotating order. With --static the scene is rendered once, like behind a dashboard
+		enum { Quads, Triangles, Retained, ModeCount };
+		const char* modeNames[ModeCount] = { "quads", "triangles", "retained" };
+		std::vector<double> timings[ModeCount];
+		SoftSurface scene;
+		SoftSurface targets[ModeCount];
+		ImGui_ImplSoft_Stats stats = {};
+		uint64_t dirtyLists = 0;
+		uint64_t lists = 0;
+		uint64_t dirtyPixels = 0;
+		int drawCommands = 0;
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			const bool backgroundChanged = !staticScene || i == 0;
+			if (backgroundChanged)
+			{
+				renderer.Render(i / 60.0f);
+				scene = renderer.GetFrame();
+			}
+
+			ImGui_ImplSoft_NewFrame();
+			ImGui::NewFrame();
+			ImGui::DockSpaceOverViewport(nullptr, ImGuiDockNodeFlags_PassthruCentralNode);
+			// the demo window places itself at the right, the others go next to it
+			ImGui::ShowDemoWindow();
+			ImGui::SetNextWindowPos(ImVec2(20.0f, 470.0f), ImGuiCond_FirstUseEver);
+			ImGui::ShowMetricsWindow();
+			ImGui::SetNextWindowPos(ImVec2(20.0f, 320.0f), ImGuiCond_FirstUseEver);
+			ImGui::ShowAboutWindow();
+			ImGui::SetNextWindowPos(ImVec2(20.0f, 20.0f), ImGuiCond_FirstUseEver);
+			ImGui::SetNextWindowSize(ImVec2(600.0f, 280.0f), ImGuiCond_FirstUseEver);
+			ImGui::Begin("Style Editor");
+			ImGui::ShowStyleEditor();
+			ImGui::End();
+			ImGui::Render();
+
+			// the retained target keeps its contents, the others start from the scene
+			ImDrawData* drawData = ImGui::GetDrawData();
+			// every command is a scissor and texture bind plus a draw on a gpu backend
+			drawCommands = 0;
+			for (int n = 0; n < drawData->CmdListsCount; ++n)
+				drawCommands += drawData->CmdLists[n]->CmdBuffer.Size;
+			targets[Quads] = scene;
+			targets[Triangles] = scene;
+			if (backgroundChanged)
+				targets[Retained] = scene;
+			for (uint32_t m = 0; m < ModeCount; ++m)
+			{
+				const uint32_t mode = (i + m) % ModeCount;
+				ImGui_ImplSoft_SetQuadFastPath(mode != Triangles);
+				auto start = std::chrono::steady_clock::now();
+				// halfway through the retained state is dropped, the whole target is put back from the scene
+				if (mode == Retained && i == frames / 2)
+					ImGui_ImplSoft_InvalidateRetained();
+				if (mode == Retained)
+					ImGui_ImplSoft_RenderDrawDataRetained(drawData, &targets[mode], backgroundChanged ? &scene : nullptr);
+				else
+					ImGui_ImplSoft_RenderDrawData(drawData, &targets[mode]);
+				auto end = std::chrono::steady_clock::now();
+				timings[mode].push_back(std::chrono::duration<double, std::milli>(end - start).count());
+				if (mode == Quads)
+					stats = ImGui_ImplSoft_GetStats();
+				if (mode == Retained)
+				{
+					ImGui_ImplSoft_Stats retained = ImGui_ImplSoft_GetStats();
+					dirtyLists += static_cast<uint64_t>(retained.DirtyLists);
+					lists += static_cast<uint64_t>(retained.Lists);
+					dirtyPixels += static_cast<uint64_t>(retained.DirtyPixels);
+				}
+			}
+		}
+		WriteImageFile(path, SoftImageFormat::Png, targets[Quads]);
+
+		// the triangles and the retained target have to match the quads exactly
+		size_t triangleDiffering = 0;
+		size_t retainedDiffering = 0;
+		for (size_t i = 0; i < targets[Quads].texels.size(); ++i)
+		{
+			const uint32_t expected = targets[Quads].texels[i];
+			triangleDiffering += targets[Triangles].texels[i] != expected ? 1 : 0;
+			retainedDiffering += targets[Retained].texels[i] != expected ? 1 : 0;
+		}
+
+		ImGui_ImplSoft_Shutdown();
+		ImGui::DestroyContext();
+
+		double medians[ModeCount];
+		for (uint32_t m = 0; m < ModeCount; ++m)
+		{
+			std::sort(timings[m].begin(), timings[m].end());
+			medians[m] = timings[m][timings[m].size() / 2];
+		}
+		const int triangles = stats.Triangles + stats.Quads * 2;
+		printf("%s%s at %ux%u, %d ui triangles, %u thread(s)\n", GetSceneName(sceneId), staticScene ? " (static)" : "", width, height, triangles, threads);
+		printf("  %d quads caught, %.1f%% of the triangles\n", stats.Quads, triangles ? 200.0 * stats.Quads / triangles : 0.0);
+		printf("  %d draw commands in the last frame\n", drawCommands);
+		printf("                     ");
+		for (uint32_t m = 0; m < ModeCount; ++m)
+			printf(" %9s", modeNames[m]);
+		printf("\n  ui composite min   ");
+		for (uint32_t m = 0; m < ModeCount; ++m)
+			printf(" %9.3f", timings[m].front());
+		printf(" ms\n  ui composite median");
+		for (uint32_t m = 0; m < ModeCount; ++m)
+			printf(" %9.3f", medians[m]);
+		printf(" ms\n  ui composite max   ");
+		for (uint32_t m = 0; m < ModeCount; ++m)
+			printf(" %9.3f", timings[m].back());
+		printf(" ms\n");
+		printf("  quad path speedup %.2fx, %zu pixels differ from the triangles\n", medians[Quads] > 0.0 ? medians[Triangles] / medians[Quads] : 0.0, triangleDiffering);
+		printf("  retained speedup %.2fx, %.1f of %.1f lists and %.1f%% of the pixels dirty per frame\n",
+			medians[Retained] > 0.0 ? medians[Quads] / medians[Retained] : 0.0, static_cast<double>(dirtyLists) / frames,
+			static_cast<double>(lists) / frames, 100.0 * static_cast<double>(dirtyPixels) / frames / (static_cast<double>(width) * height));
+		printf("  %zu pixels differ from the retained target\n", retainedDiffering);
+		printf("  wrote %s\n", path);
+		return triangleDiffering == 0 && retainedDiffering == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	int Replay(int argc, char** argv)
+	{
+		const char* path = argv[1];
+		uint32_t iterations = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 100;
+		if (iterations == 0)
+			iterations = 1;
+
+		SoftCaptureReplay capture;
+		capture.Load(path);
+		printf("%s: %u frame(s), %zu commands\n", path, capture.FrameCount(), capture.CommandCount());
+
+		SoftCommandQueue queue;
+		std::vector<double> timings;
+		timings.reserve(iterations);
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			// restoring the captured contents is not part of the measurement
+			capture.Reset();
+			auto start = std::chrono::steady_clock::now();
+			capture.Replay(queue);
+			auto end = std::chrono::steady_clock::now();
+			timings.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+
+		std::vector<double> sorted = timings;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (double t : timings)
+			total += t;
+		double frames = capture.FrameCount() ? static_cast<double>(capture.FrameCount()) : 1.0;
+
+		printf("iterations %u\n", iterations);
+		printf("  min    %8.3f ms\n", sorted.front());
+		printf("  median %8.3f ms\n", sorted[sorted.size() / 2]);
+		printf("  mean   %8.3f ms\n", total / iterations);
+		printf("  max    %8.3f ms\n", sorted.back());
+		printf("  mean per frame %8.3f ms\n", total / iterations / frames);
+		printf("  output hash %016llx\n", static_cast<unsigned long long>(HashSurface(capture.LastRenderTarget())));
+		return EXIT_SUCCESS;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || ((strcmp(argv[1], "--record") == 0 || strcmp(argv[1], "--regress") == 0 || strcmp(argv[1], "--present") == 0 ||
+		strcmp(argv[1], "--ui") == 0) && argc < 3))
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		if (strcmp(argv[1], "--record") == 0)
+			return Record(argc, argv);
+		if (strcmp(argv[1], "--regress") == 0)
+			return Regress(argc, argv);
+		if (strcmp(argv[1], "--present") == 0)
+			return PresentLatency(argc, argv);
+		if (strcmp(argv[1], "--ui") == 0)
+			return UiOverlay(argc, argv);
+		// anything else starting with -- is a misspelled mode, not a capture path
+		if (strncmp(argv[1], "--", 2) == 0)
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		return Replay(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		printf("error: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+}